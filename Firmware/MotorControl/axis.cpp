@@ -27,7 +27,11 @@ Axis::Axis(const AxisHardwareConfig_t& hw_config,
     motor_.axis_ = this;
     trap_.axis_ = this;
 
+    // needs the motor config, so it can only run once the axis is wired up
+    encoder_.update_cpr_params();
+
     decode_step_dir_pins();
+    update_step_dir_gains();
 }
 
 static void step_cb_wrapper(void* ctx) {
@@ -56,7 +60,9 @@ void Axis::start_thread() {
 // @brief Unblocks the control loop thread.
 // This is called from the current sense interrupt handler.
 void Axis::signal_current_meas() {
-    if (thread_id_valid_)
+    if (isr_control_active_)
+        run_isr_control_cycle();
+    else if (thread_id_valid_)
         osSignalSet(thread_id_, M_SIGNAL_PH_CURRENT_MEAS);
 }
 
@@ -66,15 +72,50 @@ bool Axis::wait_for_current_meas() {
     return osSignalWait(M_SIGNAL_PH_CURRENT_MEAS, PH_CURRENT_MEAS_TIMEOUT).status == osEventSignal;
 }
 
+// @brief One cycle of run_control_loop with the closed loop update handler,
+// executed directly in the current measurement interrupt.
+// When the loop ends, the axis thread is woken up to continue the state machine.
+void Axis::run_isr_control_cycle() {
+    bool keep_running = requested_state_ == AXIS_STATE_UNDEFINED;
+    if (keep_running) {
+        // Note: updates run even if checks fail
+        bool checks_ok = do_checks(true);
+        bool updates_ok = do_updates();
+        keep_running = checks_ok && updates_ok;
+    }
+    if (keep_running) {
+        controller_.apply_pending_commands(control_tick);
+        keep_running = closed_loop_update();
+        ++loop_counter_;
+    }
+    if (!keep_running) {
+        isr_control_active_ = false;
+        osSignalSet(thread_id_, M_SIGNAL_PH_CURRENT_MEAS);
+    }
+}
+
 // step/direction interface
+// Only counts the step, the control loop applies it in update_step_dir()
 void Axis::step_cb() {
     if (step_dir_active_) {
-        GPIO_PinState dir_pin = HAL_GPIO_ReadPin(dir_port_, dir_pin_);
-        float dir = (dir_pin == GPIO_PIN_SET) ? 1.0f : -1.0f;
-        controller_.pos_setpoint_ += dir * config_.counts_per_step;
+        step_counter_.count_step(HAL_GPIO_ReadPin(dir_port_, dir_pin_) == GPIO_PIN_SET);
     }
 };
 
+// @brief Applies the steps since the last control cycle to the position
+// setpoint and feeds the estimated step rate forward
+void Axis::update_step_dir() {
+    int32_t steps = step_counter_.update(current_meas_period, step_dir_gains_);
+    controller_.pos_setpoint_ += (float)steps * config_.counts_per_step;
+    if (config_.step_dir_vel_feed_forward && controller_.config_.control_mode == Controller::CTRL_MODE_POSITION_CONTROL)
+        controller_.vel_setpoint_ = step_counter_.get_vel() * config_.counts_per_step;
+}
+
+void Axis::update_step_dir_gains() {
+    // An unstable bandwidth only makes the feedforward useless, the position still follows the steps
+    step_dir_gains_.set_bandwidth(config_.step_dir_vel_bandwidth, current_meas_period);
+}
+
 void Axis::load_default_step_dir_pin_config(
         const AxisHardwareConfig_t& hw_config, Config_t* config) {
     config->step_gpio_pin = hw_config.step_gpio_pin;
@@ -98,6 +139,8 @@ void Axis::set_step_dir_active(bool active) {
         GPIO_InitStruct.Pull = GPIO_NOPULL;
         HAL_GPIO_Init(dir_port_, &GPIO_InitStruct);
 
+        step_counter_.reset();
+
         // Subscribe to rising edges of the step GPIO
         GPIO_subscribe(step_port_, step_pin_, GPIO_PULLDOWN,
                 step_cb_wrapper, this);
@@ -113,7 +156,8 @@ void Axis::set_step_dir_active(bool active) {
 
 // @brief Do axis level checks and call subcomponent do_checks
 // Returns true if everything is ok.
-bool Axis::do_checks() {
+// @param in_isr: Called from an interrupt, so nothing may block
+bool Axis::do_checks(bool in_isr) {
     if (!brake_resistor_armed)
         error_ |= ERROR_BRAKE_RESISTOR_DISARMED;
     if ((current_state_ != AXIS_STATE_IDLE) && (motor_.armed_state_ == Motor::ARMED_STATE_DISARMED))
@@ -125,7 +169,7 @@ bool Axis::do_checks() {
         error_ |= ERROR_DC_BUS_OVER_VOLTAGE;
 
     // Sub-components should use set_error which will propegate to this error_
-    motor_.do_checks();
+    motor_.do_checks(in_isr);
     encoder_.do_checks();
     // sensorless_estimator_.do_checks();
     // controller_.do_checks();
@@ -137,7 +181,9 @@ bool Axis::do_checks() {
 bool Axis::do_updates() {
     // Sub-components should use set_error which will propegate to this error_
     encoder_.update();
+    motor_.log_timing(Motor::TIMING_LOG_ENCODER);
     sensorless_estimator_.update();
+    motor_.log_timing(Motor::TIMING_LOG_SENSORLESS);
     return check_for_errors();
 }
 
@@ -184,6 +230,7 @@ bool Axis::run_sensorless_control_loop() {
         float current_setpoint;
         if (!controller_.update(sensorless_estimator_.pll_pos_, sensorless_estimator_.vel_estimate_, &current_setpoint))
             return error_ |= ERROR_CONTROLLER_FAILED, false;
+        motor_.log_timing(Motor::TIMING_LOG_CONTROLLER);
         if (!motor_.update(current_setpoint, sensorless_estimator_.phase_))
             return false; // set_error should update axis.error_
         return true;
@@ -191,19 +238,52 @@ bool Axis::run_sensorless_control_loop() {
     return check_for_errors();
 }
 
+bool Axis::closed_loop_update() {
+    if (step_dir_active_)
+        update_step_dir();
+
+    // Note that all estimators are updated in the loop prefix in run_control_loop
+    float current_setpoint;
+    if (!controller_.update(encoder_.pos_estimate_, encoder_.vel_estimate_, &current_setpoint))
+        return error_ |= ERROR_CONTROLLER_FAILED, false; //TODO: Make controller.set_error
+    motor_.log_timing(Motor::TIMING_LOG_CONTROLLER);
+    if (!motor_.update(current_setpoint, encoder_.phase_))
+        return false; // set_error should update axis.error_
+    return true;
+}
+
 bool Axis::run_closed_loop_control_loop() {
     // To avoid any transient on startup, we intialize the setpoint to be the current position
     controller_.pos_setpoint_ = encoder_.pos_estimate_;
+    controller_.gearing_.disengage(); // the follower starts from the new setpoint
+    controller_.enable_loaded_anticogging();
     set_step_dir_active(config_.enable_step_dir);
+#ifdef CONTROL_IN_ISR
+    // The control cycles run in the current measurement interrupt, which
+    // saves the thread wakeup. This thread only watches that they keep coming.
+    isr_control_active_ = true;
+    while (isr_control_active_) {
+        uint32_t last_loop_counter = loop_counter_;
+        // Returns early when the interrupt ends the loop
+        if (!wait_for_current_meas() && isr_control_active_ && loop_counter_ == last_loop_counter) {
+            // maybe the interrupt handler is dead, let's be
+            // safe and float the phases
+            isr_control_active_ = false;
+            safety_critical_disarm_motor_pwm(motor_);
+            update_brake_current();
+            error_ |= ERROR_CURRENT_MEASUREMENT_TIMEOUT;
+        }
+    }
+    // the interrupt only sampled the fault line
+    if (motor_.error_ & Motor::ERROR_DRV_FAULT)
+        motor_.read_DRV_fault();
+#else
     run_control_loop([this](){
-        // Note that all estimators are updated in the loop prefix in run_control_loop
-        float current_setpoint;
-        if (!controller_.update(encoder_.pos_estimate_, encoder_.vel_estimate_, &current_setpoint))
-            return error_ |= ERROR_CONTROLLER_FAILED, false; //TODO: Make controller.set_error
-        if (!motor_.update(current_setpoint, encoder_.phase_))
-            return false; // set_error should update axis.error_
-        return true;
+        return closed_loop_update();
     });
+#endif
+    // a sweep can't continue without the control loop
+    controller_.end_anticogging_sweep();
     set_step_dir_active(false);
     return check_for_errors();
 }
@@ -223,12 +303,13 @@ void Axis::run_state_machine_loop() {
 
     // Allocate the map for anti-cogging algorithm and initialize all values to 0.0f
     // TODO: Move this somewhere else
-    // TODO: respect changes of CPR
-    int encoder_cpr = encoder_.config_.cpr;
-    controller_.anticogging_.cogging_map = (float*)malloc(encoder_cpr * sizeof(float));
-    if (controller_.anticogging_.cogging_map != NULL) {
-        for (int i = 0; i < encoder_cpr; i++) {
-            controller_.anticogging_.cogging_map[i] = 0.0f;
+    // TODO: respect changes of CPR, stride and scale
+    if (controller_.anticogging_.cogging_map.allocate(encoder_.config_.cpr,
+            controller_.config_.anticogging_stride, controller_.config_.anticogging_scale)) {
+        // Restore the map from a previous calibration if there is one
+        for (uint32_t i = 0; i < AXIS_COUNT; ++i) {
+            if (axes[i] == this)
+                controller_.load_anticogging_map(i);
         }
     }
 
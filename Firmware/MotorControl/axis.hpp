@@ -46,6 +46,8 @@ public:
         bool enable_step_dir = false; //<! enable step/dir input after calibration
                                     //   For M0 this has no effect if enable_uart is true
         float counts_per_step = 2.0f;
+        bool step_dir_vel_feed_forward = true; //<! in position control, feed the step rate forward as vel_setpoint
+        float step_dir_vel_bandwidth = 100.0f; //<! [rad/s] bandwidth of the step rate estimate
 
         // Defaults loaded from hw_config in load_configuration in main.cpp
         uint16_t step_gpio_pin = 0;
@@ -75,16 +77,19 @@ public:
     void start_thread();
     void signal_current_meas();
     bool wait_for_current_meas();
+    void run_isr_control_cycle();
 
     void step_cb();
     void set_step_dir_active(bool enable);
     void decode_step_dir_pins();
+    void update_step_dir_gains();
+    void update_step_dir();
     static void load_default_step_dir_pin_config(
         const AxisHardwareConfig_t& hw_config, Config_t* config);
 
     bool check_DRV_fault();
     bool check_PSU_brownout();
-    bool do_checks();
+    bool do_checks(bool in_isr);
     bool do_updates();
 
 
@@ -117,7 +122,7 @@ public:
     void run_control_loop(const T& update_handler) {
         while (requested_state_ == AXIS_STATE_UNDEFINED) {
             // look for errors at axis level and also all subcomponents
-            bool checks_ok = do_checks();
+            bool checks_ok = do_checks(false);
             // Update all estimators
             // Note: updates run even if checks fail
             bool updates_ok = do_updates(); 
@@ -129,6 +134,8 @@ public:
                     break;
             }
 
+            controller_.apply_pending_commands(control_tick);
+
             // Run main loop function, defer quitting for after wait
             // TODO: change arming logic to arm after waiting
             bool main_continue = update_handler();
@@ -153,6 +160,7 @@ public:
 
     bool run_sensorless_spin_up();
     bool run_sensorless_control_loop();
+    bool closed_loop_update();
     bool run_closed_loop_control_loop();
     bool run_idle_loop();
 
@@ -169,10 +177,15 @@ public:
 
     osThreadId thread_id_;
     volatile bool thread_id_valid_ = false;
+    // Set while the closed loop control runs in the current measurement
+    // interrupt (CONTROL_IN_ISR builds only)
+    volatile bool isr_control_active_ = false;
 
     // variables exposed on protocol
     Error_t error_ = ERROR_NONE;
     bool step_dir_active_ = false; // auto enabled after calibration, based on config.enable_step_dir
+    StepCounter step_counter_;
+    PllGains step_dir_gains_;
 
     // updated from config in constructor, and on protocol hook
     GPIO_TypeDef* step_port_;
@@ -190,6 +203,7 @@ public:
         return make_protocol_member_list(
             make_protocol_property("error", &error_),
             make_protocol_ro_property("step_dir_active", &step_dir_active_),
+            make_protocol_ro_property("step_count", &step_counter_.last_count_),
             make_protocol_ro_property("current_state", &current_state_),
             make_protocol_property("requested_state", &requested_state_),
             make_protocol_ro_property("loop_counter", &loop_counter_),
@@ -201,6 +215,9 @@ public:
                 make_protocol_property("startup_sensorless_control", &config_.startup_sensorless_control),
                 make_protocol_property("enable_step_dir", &config_.enable_step_dir),
                 make_protocol_property("counts_per_step", &config_.counts_per_step),
+                make_protocol_property("step_dir_vel_feed_forward", &config_.step_dir_vel_feed_forward),
+                make_protocol_property("step_dir_vel_bandwidth", &config_.step_dir_vel_bandwidth,
+                    [](void* ctx) { static_cast<Axis*>(ctx)->update_step_dir_gains(); }, this),
                 make_protocol_property("step_gpio_pin", &config_.step_gpio_pin,
                     [](void* ctx) { static_cast<Axis*>(ctx)->decode_step_dir_pins(); }, this),
                 make_protocol_property("dir_gpio_pin", &config_.dir_gpio_pin,
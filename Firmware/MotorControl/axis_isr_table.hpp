@@ -0,0 +1,103 @@
+#ifndef _AXIS_ISR_TABLE_H
+#define _AXIS_ISR_TABLE_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+// @brief Describes which peripherals and interrupts belong to each axis, so
+// that the interrupt handlers find the axis of a callback by looking it up
+// instead of hardcoding two axes.
+//
+// The PWM timer of each axis triggers a conversion on a pair of ADCs that
+// measure the phase B and C currents. Axes that share the ADC pair must use
+// different conversion types (injected or regular). The ADCs sample at both
+// ends of the PWM period: while the timer counts up, in SVM vector 0, they
+// measure the phase currents, while it counts down, in SVM vector 7, they
+// take the zero current sample for the DC calibration.
+//
+// The PWM timings of an axis must be loaded at a time in the period of its
+// timer when no update is pending, which is offset from the own measurements
+// because the timers run phase shifted. Therefore the phase B callback of
+// one axis loads the timings of timings_axis, either at the current
+// measurement or at the DC calibration sample (load_on_dc_cal). The SPI
+// transaction of the absolute encoder of the axis starts at the same time.
+//
+// The template parameters are the handle types of the HAL (or mock types in tests).
+template<typename TTimer, typename TAdc, typename TSpi, size_t N>
+class AxisIsrTable {
+public:
+    struct Descriptor_t {
+        TTimer* timer;          // PWM timer, its update interrupt samples the GPIOs
+        TAdc* adc_phB;
+        TAdc* adc_phC;
+        bool injected;          // the timer triggers injected (true) or regular (false) conversions
+        bool load_on_dc_cal;    // load the timings of timings_axis at the DC calibration sample instead of the current measurement
+        size_t timings_axis;
+        TSpi* spi;              // SPI of the absolute encoder
+    };
+
+    // @brief What the ADC callback has to do for a conversion
+    struct AdcEvent_t {
+        size_t axis;
+        bool phB;               // true: phase B, false: phase C
+        bool current_meas;      // true: phase current, false: DC calibration sample
+        bool load_timings;      // load the PWM timings of timings_axis and start the SPI transaction of axis
+        size_t timings_axis;
+        bool meas_complete;     // both phases of the current measurement are done, the axis can run its control cycle
+        bool control_tick;      // advance control_tick, once per period on the first axis
+    };
+
+    const Descriptor_t descriptors[N];
+
+    // @brief Finds the axis of an ADC conversion
+    // @returns false if no axis uses this ADC with this conversion type
+    bool find_adc(const TAdc* adc, bool injected, size_t* axis) const {
+        for (size_t i = 0; i < N; ++i) {
+            const Descriptor_t& desc = descriptors[i];
+            if (desc.injected == injected && (adc == desc.adc_phB || adc == desc.adc_phC)) {
+                *axis = i;
+                return true;
+            }
+        }
+        return false;
+    }
+
+    // @brief Decodes a conversion of an axis found by find_adc()
+    // @param counting_down: Direction of the PWM timer of the axis
+    AdcEvent_t get_adc_event(size_t axis, const TAdc* adc, bool counting_down) const {
+        const Descriptor_t& desc = descriptors[axis];
+        AdcEvent_t event;
+        event.axis = axis;
+        event.phB = adc == desc.adc_phB;
+        event.current_meas = !counting_down;
+        event.load_timings = event.phB && counting_down == desc.load_on_dc_cal;
+        event.timings_axis = desc.timings_axis;
+        event.meas_complete = event.current_meas && !event.phB;
+        event.control_tick = event.meas_complete && axis == 0;
+        return event;
+    }
+
+    // @returns the axis with this PWM timer or -1
+    int find_timer(const TTimer* timer) const {
+        for (size_t i = 0; i < N; ++i) {
+            if (descriptors[i].timer == timer)
+                return (int)i;
+        }
+        return -1;
+    }
+
+    // @brief Finds the axis of a completed SPI transfer. Several encoders
+    // can share an SPI, so the receive buffer tells them apart.
+    // @param get_rx_buffer: Returns the receive buffer of an axis
+    // @returns the axis or -1
+    template<typename TGetRxBuffer>
+    int find_spi_transfer(const TSpi* spi, const void* rx_buffer, const TGetRxBuffer& get_rx_buffer) const {
+        for (size_t i = 0; i < N; ++i) {
+            if (descriptors[i].spi == spi && get_rx_buffer(i) == rx_buffer)
+                return (int)i;
+        }
+        return -1;
+    }
+};
+
+#endif
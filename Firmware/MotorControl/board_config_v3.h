@@ -6,6 +6,7 @@
 #define __BOARD_CONFIG_H
 
 // STM specific includes
+#include <adc.h>
 #include <gpio.h>
 #include <spi.h>
 #include <tim.h>
@@ -60,7 +61,14 @@ typedef struct {
     GateDriverHardwareConfig_t gate_driver_config;
 } BoardHardwareConfig_t;
 
-extern const BoardHardwareConfig_t hw_configs[2];
+#ifdef __cplusplus
+constexpr size_t AXIS_COUNT = 2;
+
+typedef AxisIsrTable<TIM_HandleTypeDef, ADC_HandleTypeDef, SPI_HandleTypeDef, AXIS_COUNT> BoardAxisIsrTable_t;
+
+extern const BoardHardwareConfig_t hw_configs[AXIS_COUNT];
+extern const BoardAxisIsrTable_t axis_isr_table;
+#endif
 extern const float thermistor_poly_coeffs[];
 extern const size_t thermistor_num_coeffs;
 
@@ -70,7 +78,7 @@ const float thermistor_poly_coeffs[] =
     {363.93910201f, -462.15369634f, 307.55129571f, -27.72569531f};
 const size_t thermistor_num_coeffs = sizeof(thermistor_poly_coeffs)/sizeof(thermistor_poly_coeffs[1]);
 
-const BoardHardwareConfig_t hw_configs[2] = { {
+const BoardHardwareConfig_t hw_configs[AXIS_COUNT] = { {
     //M0
     .axis_config = {
         .step_gpio_pin = 1,
@@ -150,6 +158,32 @@ const BoardHardwareConfig_t hw_configs[2] = { {
         .nFAULT_pin = nFAULT_Pin,
     }
 } };
+
+// Motor 0 is on Timer 1, which triggers ADC 2 and 3 on an injected conversion
+// Motor 1 is on Timer 8, which triggers ADC 2 and 3 on a regular conversion
+// The timers run half a period apart, so the timings of M1 are loaded at the
+// current measurement of M0 and the timings of M0 at the DC calibration sample of M1.
+const BoardAxisIsrTable_t axis_isr_table = { {
+    {
+        //M0
+        .timer = &htim1,
+        .adc_phB = &hadc2,
+        .adc_phC = &hadc3,
+        .injected = true,
+        .load_on_dc_cal = false,
+        .timings_axis = 1,
+        .spi = &hspi3,
+    },{
+        //M1
+        .timer = &htim8,
+        .adc_phB = &hadc2,
+        .adc_phC = &hadc3,
+        .injected = false,
+        .load_on_dc_cal = true,
+        .timings_axis = 0,
+        .spi = &hspi3,
+    }
+} };
 #endif
 
 
@@ -0,0 +1,181 @@
+#ifndef __CALIBRATION_STORE_HPP
+#define __CALIBRATION_STORE_HPP
+
+#include <stdint.h>
+#include <stddef.h>
+#include <string.h>
+
+#include <fibre/crc.hpp>
+
+#define CALIBRATION_CRC16_INIT 0x1d0f
+#define CALIBRATION_CRC16_POLYNOMIAL 0x3d65
+
+// @brief Manages large calibration artifacts (e.g. anti-cogging maps) in a
+// flash region of their own, separate from the configuration NVM.
+//
+// Layout of the region:
+//   RegionHeader_t
+//   RecordHeader_t, payload, padding to 8 bytes
+//   RecordHeader_t, payload, padding to 8 bytes
+//   ...
+//   erased flash (0xff)
+//
+// A store operation erases the region, appends all records and programs the
+// region header last. The region header therefore only becomes valid once
+// all records are complete, and an interrupted store leaves an empty region.
+//
+// Records are read in place (the region is memory mapped), so nothing is
+// loaded at boot; each owner looks up its record when it needs it.
+// Each record has a CRC over its header and another one over its payload.
+class CalibrationStore {
+public:
+    // IMPORTANT: if you change the layout of the headers below, make sure to
+    // increment this number. Changes to a payload format are versioned by the
+    // record version instead.
+    static constexpr uint16_t kFormatVersion = 0x0001;
+    static constexpr uint32_t kRegionMagic = 0x4c41434f; // "OCAL"
+    static constexpr uint32_t kRecordMagic = 0x4345524f; // "OREC"
+
+    enum RecordType_t : uint16_t {
+        RECORD_TYPE_COGGING_MAP = 1,
+        RECORD_TYPE_ENCODER_LINEARIZATION = 2, // reserved
+    };
+
+    struct RegionHeader_t {
+        uint32_t magic;
+        uint16_t format_version;
+        uint16_t crc16;         // over the preceding fields
+    };
+
+    struct RecordHeader_t {
+        uint32_t magic;
+        uint16_t type;          // see RecordType_t
+        uint16_t version;       // version of the payload format
+        uint32_t key;           // distinguishes records of the same type, e.g. the axis number
+        uint32_t length;        // payload length [bytes]
+        uint16_t payload_crc16;
+        uint16_t crc16;         // over the preceding fields
+    };
+
+    // @brief Hardware access
+    // erase: Sets the whole region to 0xff. Returns 0 on success.
+    // program: Writes data at a byte offset into erased memory. Returns 0 on success.
+    typedef int (*erase_fn_t)(void);
+    typedef int (*program_fn_t)(size_t offset, const uint8_t* data, size_t length);
+
+    CalibrationStore(const uint8_t* base, size_t size, erase_fn_t erase, program_fn_t program) :
+        base_(base), size_(size), erase_(erase), program_(program) {}
+
+    // @brief Returns true if the region contains a completely written store
+    // of the current format version.
+    bool is_valid() const {
+        RegionHeader_t header;
+        memcpy(&header, base_, sizeof(header));
+        return header.magic == kRegionMagic
+            && header.format_version == kFormatVersion
+            && header.crc16 == calc_crc(&header, offsetof(RegionHeader_t, crc16));
+    }
+
+    // @brief Looks up a record.
+    // @param length: Set to the payload length if the record is found.
+    // @returns A pointer to the payload or nullptr if there is no intact
+    //          record with the given type, key and version.
+    const uint8_t* find(uint16_t type, uint32_t key, uint16_t version, size_t* length) const {
+        if (!is_valid())
+            return nullptr;
+        size_t offset = align(sizeof(RegionHeader_t));
+        while (offset + sizeof(RecordHeader_t) <= size_) {
+            RecordHeader_t header;
+            memcpy(&header, base_ + offset, sizeof(header));
+            if (header.magic != kRecordMagic
+                    || header.crc16 != calc_crc(&header, offsetof(RecordHeader_t, crc16))
+                    || header.length > size_ - offset - sizeof(RecordHeader_t))
+                return nullptr; // end of the records (or corruption)
+            const uint8_t* payload = base_ + offset + sizeof(RecordHeader_t);
+            if (header.type == type && header.key == key && header.version == version) {
+                if (header.payload_crc16 != calc_crc(payload, header.length))
+                    return nullptr;
+                *length = header.length;
+                return payload;
+            }
+            offset += align(sizeof(RecordHeader_t) + header.length);
+        }
+        return nullptr;
+    }
+
+    // @brief Erases the region and starts a new store operation.
+    // @returns 0 on success
+    int begin_store() {
+        write_offset_ = align(sizeof(RegionHeader_t));
+        return erase_();
+    }
+
+    // @brief Appends a record. The payload may be passed in two parts
+    // (e.g. a fixed header and a sample array) to avoid a temporary copy.
+    // @returns 0 on success
+    int append(uint16_t type, uint32_t key, uint16_t version,
+               const void* data0, size_t length0, const void* data1 = nullptr, size_t length1 = 0) {
+        size_t length = length0 + length1;
+        if (write_offset_ + sizeof(RecordHeader_t) + length > size_)
+            return -1;
+        uint16_t payload_crc = calc_crc(data0, length0);
+        payload_crc = calc_crc16<CALIBRATION_CRC16_POLYNOMIAL>(payload_crc, (const uint8_t*)data1, length1);
+        RecordHeader_t header = {
+            .magic = kRecordMagic,
+            .type = type,
+            .version = version,
+            .key = key,
+            .length = (uint32_t)length,
+            .payload_crc16 = payload_crc,
+            .crc16 = 0,
+        };
+        header.crc16 = calc_crc(&header, offsetof(RecordHeader_t, crc16));
+
+        size_t offset = write_offset_;
+        int status;
+        if ((status = program_(offset, (const uint8_t*)&header, sizeof(header))))
+            return status;
+        offset += sizeof(header);
+        if (length0 && (status = program_(offset, (const uint8_t*)data0, length0)))
+            return status;
+        offset += length0;
+        if (length1 && (status = program_(offset, (const uint8_t*)data1, length1)))
+            return status;
+        write_offset_ = align(offset + length1);
+        return 0;
+    }
+
+    // @brief Completes the store operation by writing the region header.
+    // @returns 0 on success
+    int commit() {
+        RegionHeader_t header = {
+            .magic = kRegionMagic,
+            .format_version = kFormatVersion,
+            .crc16 = 0,
+        };
+        header.crc16 = calc_crc(&header, offsetof(RegionHeader_t, crc16));
+        return program_(0, (const uint8_t*)&header, sizeof(header));
+    }
+
+    // @brief Erases all records
+    int erase() {
+        return erase_();
+    }
+
+private:
+    static size_t align(size_t offset) {
+        return (offset + 7) & ~(size_t)7;
+    }
+
+    static uint16_t calc_crc(const void* data, size_t length) {
+        return calc_crc16<CALIBRATION_CRC16_POLYNOMIAL>(CALIBRATION_CRC16_INIT, (const uint8_t*)data, length);
+    }
+
+    const uint8_t* base_;
+    size_t size_;
+    erase_fn_t erase_;
+    program_fn_t program_;
+    size_t write_offset_ = 0;
+};
+
+#endif // __CALIBRATION_STORE_HPP
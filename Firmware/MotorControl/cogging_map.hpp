@@ -0,0 +1,206 @@
+#ifndef __COGGING_MAP_HPP
+#define __COGGING_MAP_HPP
+
+#include <stdint.h>
+#include <stdlib.h>
+#include <math.h>
+
+#include "utils.h"
+#include "calibration_store.hpp"
+
+// @brief Compact anti-cogging current map.
+//
+// The map stores the cogging current at evenly spaced encoder positions
+// as int16_t samples (scale_ amps per LSB) and interpolates linearly
+// in between. With a stride of 4 counts this takes 1/8 of the memory
+// of one float per count.
+//
+// The harmonic (Fourier) form, as produced by
+// analysis/cogging_torque/cogging_harmonics.py, is not evaluated at
+// runtime: add_harmonic() expands each harmonic into the samples, so both
+// forms cost the same single lookup in the control loop.
+//
+// The samples can be saved to and restored from a CalibrationStore.
+class CoggingMap {
+public:
+    static constexpr int32_t kSampleMax = 32767;
+    static constexpr uint16_t kRecordVersion = 1;
+
+    // @brief Precedes the samples in the CalibrationStore record
+    struct RecordHeader_t {
+        int32_t cpr;
+        uint32_t n_samples;
+        float scale;    // [A/LSB]
+    };
+
+    CoggingMap() = default;
+    CoggingMap(const CoggingMap&) = delete;
+    CoggingMap& operator=(const CoggingMap&) = delete;
+    ~CoggingMap() {
+        free(samples_);
+    }
+
+    // @brief Allocates and clears the map.
+    // @param cpr: Encoder counts per revolution
+    // @param stride: Desired sample spacing [counts]. The actual stride is
+    //        adjusted so that an integer number of samples covers one revolution.
+    // @param scale: Current per LSB [A]
+    // @returns false if the allocation failed
+    bool allocate(int32_t cpr, float stride, float scale) {
+        free(samples_);
+        samples_ = nullptr;
+        n_samples_ = 0;
+        if (cpr <= 0 || !(stride >= 1.0f) || !(scale > 0.0f))
+            return false;
+
+        uint32_t n = (uint32_t)((float)cpr / stride + 0.5f);
+        if (n < 1)
+            n = 1;
+        samples_ = (int16_t*)malloc((n + 1) * sizeof(int16_t));
+        if (!samples_)
+            return false;
+
+        n_samples_ = n;
+        cpr_ = cpr;
+        stride_ = (float)cpr / (float)n;
+        inv_stride_ = (float)n / (float)cpr;
+        n_samples_float_ = (float)n;
+        scale_ = scale;
+        inv_scale_ = 1.0f / scale;
+        clear();
+        return true;
+    }
+
+    void clear() {
+        if (!samples_)
+            return; // not allocated
+        for (uint32_t i = 0; i <= n_samples_; ++i)
+            samples_[i] = 0;
+    }
+
+    // @brief Returns the interpolated cogging current [A] at an encoder position [counts].
+    // The control loop passes a position within one revolution of [0, cpr),
+    // which is wrapped with a single add or subtract. Any other position is
+    // accepted as well but takes the slower fmodf() path.
+    float eval(float pos) const {
+        float x = pos * inv_stride_;
+        if (x < 0.0f)
+            x += n_samples_float_;
+        else if (x >= n_samples_float_)
+            x -= n_samples_float_;
+        if (!(x >= 0.0f && x < n_samples_float_)) {
+            // far outside, this also keeps the int32_t cast below in range
+            if (!(x == x))
+                return 0.0f; // NaN
+            x = fmodf(x, n_samples_float_);
+            if (x < 0.0f)
+                x += n_samples_float_;
+            if (!(x < n_samples_float_))
+                x = 0.0f; // a tiny negative x rounded up to n_samples_float_
+        }
+        int32_t i = (int32_t)x; // x >= 0, so this is floor(x)
+        float frac = x - (float)i;
+        // samples_[n_samples_] mirrors samples_[0], so i + 1 needs no wrapping
+        float y0 = (float)samples_[i];
+        float y1 = (float)samples_[i + 1];
+        return scale_ * (y0 + frac * (y1 - y0));
+    }
+
+    // @brief Encoder position [counts] of a sample
+    float get_sample_pos(uint32_t index) const {
+        return stride_ * (float)index;
+    }
+
+    // @brief Returns the current [A] stored at a sample, 0 if out of range
+    float get_sample(uint32_t index) {
+        if (index >= n_samples_)
+            return 0.0f;
+        return scale_ * (float)samples_[index];
+    }
+
+    // @brief Stores a current [A] at a sample, saturating to the int16_t range
+    void set_sample(uint32_t index, float current) {
+        if (index >= n_samples_)
+            return;
+        samples_[index] = quantize(current * inv_scale_);
+        samples_[n_samples_] = samples_[0];
+    }
+
+    // @brief Adds one harmonic to the map:
+    // current(pos) += cos_amplitude * cos(h * theta) + sin_amplitude * sin(h * theta)
+    // where theta is the mechanical angle and h the harmonic number [cycles/turn].
+    // Amplitudes are in [A]. Call clear() first to replace the map.
+    void add_harmonic(uint32_t harmonic, float cos_amplitude, float sin_amplitude) {
+        if (!n_samples_)
+            return;
+        float dtheta = 2.0f * M_PI / (float)n_samples_;
+        for (uint32_t i = 0; i < n_samples_; ++i) {
+            // reduce the angle in integer arithmetic to keep the float argument small
+            uint32_t k = (uint32_t)(((uint64_t)harmonic * i) % n_samples_);
+            float theta = dtheta * (float)k;
+            float current = cos_amplitude * cosf(theta) + sin_amplitude * sinf(theta);
+            samples_[i] = quantize((float)samples_[i] + current * inv_scale_);
+        }
+        samples_[n_samples_] = samples_[0];
+    }
+
+    // @brief Saves the samples as a CalibrationStore record
+    // @returns 0 on success
+    int store(CalibrationStore& store, uint32_t key) const {
+        if (!n_samples_)
+            return -1;
+        RecordHeader_t header = { .cpr = cpr_, .n_samples = n_samples_, .scale = scale_ };
+        return store.append(CalibrationStore::RECORD_TYPE_COGGING_MAP, key, kRecordVersion,
+                &header, sizeof(header), samples_, n_samples_ * sizeof(int16_t));
+    }
+
+    // @brief Restores the samples from a CalibrationStore record.
+    // The record is only used if it was made with the same cpr, stride and scale.
+    // @returns true if the samples were restored
+    bool load(const CalibrationStore& store, uint32_t key) {
+        size_t length = 0;
+        const uint8_t* payload = store.find(CalibrationStore::RECORD_TYPE_COGGING_MAP, key, kRecordVersion, &length);
+        if (!payload || !n_samples_ || length != sizeof(RecordHeader_t) + n_samples_ * sizeof(int16_t))
+            return false;
+        RecordHeader_t header;
+        memcpy(&header, payload, sizeof(header));
+        if (header.cpr != cpr_ || header.n_samples != n_samples_ || header.scale != scale_)
+            return false;
+        memcpy(samples_, payload + sizeof(header), n_samples_ * sizeof(int16_t));
+        samples_[n_samples_] = samples_[0];
+        return true;
+    }
+
+    // @brief A restored map was recorded against the encoder zero of an
+    // earlier boot. It only lines up with the cogging if the encoder has the
+    // same zero again: it is absolute or its index was found. Otherwise the
+    // map would be applied at an arbitrary phase.
+    static bool is_aligned(bool absolute_encoder, bool index_found) {
+        return absolute_encoder || index_found;
+    }
+
+    // @brief Must be called after samples_ was written directly
+    void samples_written() {
+        if (n_samples_)
+            samples_[n_samples_] = samples_[0];
+    }
+
+    uint32_t n_samples_ = 0;
+    float stride_ = 1.0f;       // [counts]
+    float scale_ = 0.001f;      // [A/LSB]
+    int16_t* samples_ = nullptr; // n_samples_ + 1 entries, the last one is a copy of the first
+
+private:
+    static int16_t quantize(float x) {
+        if (x >= (float)kSampleMax) return kSampleMax;
+        if (x <= -(float)kSampleMax) return -kSampleMax;
+        return (int16_t)(x >= 0.0f ? x + 0.5f : x - 0.5f); // round to nearest
+    }
+
+    int32_t cpr_ = 0;           // [counts]
+    float inv_stride_ = 1.0f;   // [1/counts]
+    float n_samples_float_ = 1.0f;
+    float inv_scale_ = 1000.0f; // [LSB/A]
+};
+
+#endif // __COGGING_MAP_HPP
@@ -0,0 +1,187 @@
+#ifndef __COGGING_SWEEP_HPP
+#define __COGGING_SWEEP_HPP
+
+#include <stdint.h>
+#include <math.h>
+
+#include "cogging_map.hpp"
+
+// @brief Anti-cogging calibration by sweeping at constant velocity.
+//
+// The owner runs the axis in velocity control at the direction returned by
+// get_direction() and feeds the resulting current command to update() once
+// per control cycle. Each map sample collects the mean current over the
+// positions closest to it (a "bin"), first during one revolution forward, then
+// during one revolution backward. The forward means are parked in the map
+// itself, so no memory beyond the map is needed.
+//
+// Per bin, forward = cogging + friction and backward = cogging - friction,
+// so the average of both is the cogging current and half the difference is
+// the friction. Averaging both directions also cancels most of the lag of
+// the velocity loop, which shifts the two passes in opposite directions.
+class CoggingSweep {
+public:
+    enum State_t {
+        STATE_IDLE = 0,
+        STATE_SETTLE_FORWARD = 1,
+        STATE_FORWARD = 2,
+        STATE_SETTLE_BACKWARD = 3,
+        STATE_BACKWARD = 4,
+        STATE_DONE = 5,
+    };
+
+    // @brief Clears the map and starts a new sweep at the given position [counts]
+    void start(CoggingMap* map, float pos) {
+        map_ = map;
+        map_->clear();
+        n_bins_ = (int32_t)map_->n_samples_;
+        inv_stride_ = 1.0f / map_->stride_;
+        settle_bins_ = n_bins_ / 16 + 1;
+
+        bins_done_ = 0;
+        missed_bins_ = 0;
+        progress_ = 0.0f;
+        friction_ = 0.0f;
+        asymmetry_ = 0.0f;
+        ripple_ = 0.0f;
+        friction_sum_ = 0.0f;
+        friction_sqr_sum_ = 0.0f;
+        cogging_min_ = INFINITY;
+        cogging_max_ = -INFINITY;
+
+        start_bin_ = get_bin(pos);
+        state_ = STATE_SETTLE_FORWARD;
+    }
+
+    void abort() {
+        state_ = STATE_IDLE;
+    }
+
+    bool is_running() const {
+        return state_ != STATE_IDLE && state_ != STATE_DONE;
+    }
+
+    // @brief Sweep direction to command: 1, -1 or 0 if not running
+    float get_direction() const {
+        switch (state_) {
+            case STATE_SETTLE_FORWARD:
+            case STATE_FORWARD: return 1.0f;
+            case STATE_SETTLE_BACKWARD:
+            case STATE_BACKWARD: return -1.0f;
+            default: return 0.0f;
+        }
+    }
+
+    // @brief Processes one control cycle.
+    // @param pos: Position estimate [counts]
+    // @param current: Current command of the velocity loop [A]
+    // @returns true in the cycle in which the sweep completes
+    bool update(float pos, float current) {
+        int32_t bin = get_bin(pos);
+        switch (state_) {
+            case STATE_SETTLE_FORWARD:
+            case STATE_SETTLE_BACKWARD: {
+                // let the velocity loop settle after starting or reversing
+                int32_t travelled = (bin - start_bin_) * (int32_t)get_direction();
+                if (travelled >= settle_bins_) {
+                    state_ = (state_ == STATE_SETTLE_FORWARD) ? STATE_FORWARD : STATE_BACKWARD;
+                    bins_in_pass_ = 0;
+                    start_bin(bin, current);
+                }
+            } break;
+
+            case STATE_FORWARD:
+            case STATE_BACKWARD: {
+                int32_t step = (bin - bin_) * (int32_t)get_direction();
+                if (step == 0) {
+                    current_sum_ += current;
+                    ++current_count_;
+                } else if (step > 0) {
+                    float mean = current_sum_ / (float)current_count_;
+                    // bins that were skipped over get the value of the last complete bin
+                    for (int32_t i = 0; i < step && bins_in_pass_ < n_bins_; ++i) {
+                        finish_bin(bin_ + i * (int32_t)get_direction(), mean);
+                        if (i > 0)
+                            ++missed_bins_;
+                    }
+                    if (bins_in_pass_ >= n_bins_) {
+                        return finish_pass(bin);
+                    }
+                    start_bin(bin, current);
+                }
+                // step < 0: position noise at a bin boundary, drop the sample
+            } break;
+
+            default: break;
+        }
+        return false;
+    }
+
+    State_t state_ = STATE_IDLE;
+    float progress_ = 0.0f;     // [0, 1]
+    float friction_ = 0.0f;     // [A] mean friction current
+    float asymmetry_ = 0.0f;    // [A] RMS deviation of the per-bin friction from friction_
+    float ripple_ = 0.0f;       // [A] peak-to-peak cogging current
+    uint32_t missed_bins_ = 0;  // bins skipped because the sweep was too fast
+
+private:
+    int32_t get_bin(float pos) const {
+        return (int32_t)floorf(pos * inv_stride_ + 0.5f);
+    }
+
+    void start_bin(int32_t bin, float current) {
+        bin_ = bin;
+        current_sum_ = current;
+        current_count_ = 1;
+    }
+
+    void finish_bin(int32_t bin, float mean) {
+        uint32_t index = (uint32_t)(((bin % n_bins_) + n_bins_) % n_bins_);
+        if (state_ == STATE_FORWARD) {
+            map_->set_sample(index, mean);
+        } else {
+            float forward = map_->get_sample(index);
+            float cogging = 0.5f * (forward + mean);
+            float friction = 0.5f * (forward - mean);
+            map_->set_sample(index, cogging);
+            friction_sum_ += friction;
+            friction_sqr_sum_ += friction * friction;
+            if (cogging < cogging_min_) cogging_min_ = cogging;
+            if (cogging > cogging_max_) cogging_max_ = cogging;
+        }
+        ++bins_in_pass_;
+        ++bins_done_;
+        progress_ = (float)bins_done_ / (float)(2 * n_bins_);
+    }
+
+    bool finish_pass(int32_t bin) {
+        if (state_ == STATE_FORWARD) {
+            start_bin_ = bin;
+            state_ = STATE_SETTLE_BACKWARD;
+            return false;
+        }
+        friction_ = friction_sum_ / (float)n_bins_;
+        float variance = friction_sqr_sum_ / (float)n_bins_ - friction_ * friction_;
+        asymmetry_ = variance > 0.0f ? sqrtf(variance) : 0.0f;
+        ripple_ = cogging_max_ - cogging_min_;
+        state_ = STATE_DONE;
+        return true;
+    }
+
+    CoggingMap* map_ = nullptr;
+    int32_t n_bins_ = 0;
+    int32_t settle_bins_ = 0;
+    float inv_stride_ = 1.0f;   // [1/counts]
+    int32_t start_bin_ = 0;     // bin where the current settle phase started
+    int32_t bin_ = 0;           // bin being accumulated, not wrapped to one revolution
+    int32_t bins_in_pass_ = 0;
+    uint32_t bins_done_ = 0;
+    float current_sum_ = 0.0f;  // [A]
+    uint32_t current_count_ = 0;
+    float friction_sum_ = 0.0f;
+    float friction_sqr_sum_ = 0.0f;
+    float cogging_min_ = 0.0f;
+    float cogging_max_ = 0.0f;
+};
+
+#endif // __COGGING_SWEEP_HPP
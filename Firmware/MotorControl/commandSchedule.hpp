@@ -0,0 +1,113 @@
+#ifndef _COMMAND_SCHEDULE_H
+#define _COMMAND_SCHEDULE_H
+
+#include <stdint.h>
+#include <atomic>
+
+// @brief Queue of commands that are applied at a given control tick.
+//
+// The producer queues commands in the order of their ticks. The control
+// loop calls apply_due() once per cycle, which hands all commands whose tick
+// has come to the given function. Ticks are compared as a signed difference,
+// so they may wrap around, but a command must not be scheduled more than
+// 2^31 ticks ahead.
+//
+// push() and apply_due() may run in different threads: the queue is a single
+// producer, single consumer ring buffer. If several threads push, the caller
+// must serialize them.
+//
+// @tparam TCommand: Copyable command type
+// @tparam kCapacity: Maximum number of pending commands, must be a power of 2
+template<typename TCommand, uint32_t kCapacity>
+class CommandSchedule {
+public:
+    // @brief Queues a command. Called by the producer.
+    // @returns false if the queue is full or the tick lies before the tick
+    //          of the last pending command
+    bool push(uint32_t tick, const TCommand& command) {
+        uint32_t head = head_.load(std::memory_order_relaxed);
+        uint32_t depth = head - tail_.load(std::memory_order_acquire);
+        if (depth >= kCapacity)
+            return false;
+        if (depth && (int32_t)(tick - last_tick_) < 0)
+            return false;
+        entries_[head & (kCapacity - 1)] = { .tick = tick, .command = command };
+        last_tick_ = tick;
+        head_.store(head + 1, std::memory_order_release);
+        return true;
+    }
+
+    // @brief Applies all commands that are due at the tick now. Called by the consumer.
+    // Commands whose tick already passed are applied as well and counted as late.
+    // @param apply: Called with each due command, in order
+    template<typename TFunc>
+    void apply_due(uint32_t now, const TFunc& apply) {
+        for (;;) {
+            uint32_t tail = tail_.load(std::memory_order_relaxed);
+            if (head_.load(std::memory_order_acquire) == tail)
+                return;
+            const Entry_t& entry = entries_[tail & (kCapacity - 1)];
+            int32_t lateness = (int32_t)(now - entry.tick);
+            if (lateness < 0)
+                return;
+            if (lateness > 0) {
+                ++late_count_;
+                if ((uint32_t)lateness > max_lateness_)
+                    max_lateness_ = (uint32_t)lateness;
+            }
+            apply(entry.command);
+            ++applied_count_;
+            tail_.store(tail + 1, std::memory_order_release);
+        }
+    }
+
+    // @brief Discards all commands that are due at the tick now without
+    // applying them. Called by the consumer instead of apply_due() while the
+    // commands can't take effect.
+    void drop_due(uint32_t now) {
+        for (;;) {
+            uint32_t tail = tail_.load(std::memory_order_relaxed);
+            if (head_.load(std::memory_order_acquire) == tail)
+                return;
+            if ((int32_t)(now - entries_[tail & (kCapacity - 1)].tick) < 0)
+                return;
+            ++dropped_count_;
+            tail_.store(tail + 1, std::memory_order_release);
+        }
+    }
+
+    // @brief Number of pending commands
+    uint32_t get_depth() {
+        return head_.load(std::memory_order_acquire) - tail_.load(std::memory_order_acquire);
+    }
+
+    // @brief Number of commands pushed so far, wraps around
+    uint32_t get_push_count() {
+        return head_.load(std::memory_order_acquire);
+    }
+
+    // @brief Number of commands applied or dropped so far, wraps around.
+    // A producer can wait for its command to be applied by comparing this
+    // with get_push_count() right after its push.
+    uint32_t get_pop_count() {
+        return tail_.load(std::memory_order_acquire);
+    }
+
+    uint32_t applied_count_ = 0;
+    uint32_t late_count_ = 0;       // commands applied after their tick
+    uint32_t max_lateness_ = 0;     // [ticks]
+    uint32_t dropped_count_ = 0;    // commands discarded by drop_due()
+
+private:
+    struct Entry_t {
+        uint32_t tick;
+        TCommand command;
+    };
+
+    Entry_t entries_[kCapacity];
+    std::atomic<uint32_t> head_{0};
+    std::atomic<uint32_t> tail_{0};
+    uint32_t last_tick_ = 0;    // tick of the last queued command, producer only
+};
+
+#endif
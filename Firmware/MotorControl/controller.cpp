@@ -3,7 +3,9 @@
 
 
 Controller::Controller(Config_t& config) :
-    config_(config)
+    config_(config),
+    timed_setpoint_(config.timed_setpoint),
+    gearing_(config.gearing)
 {}
 
 void Controller::reset() {
@@ -32,6 +34,18 @@ void Controller::set_pos_setpoint(float pos_setpoint, float vel_feed_forward, fl
 #endif
 }
 
+// @brief Queues a position setpoint for the timed position control mode and
+// enters that mode if necessary, starting from the current setpoint.
+// @param timestamp: [us] host time of the setpoint, or 0 to use the time it arrives
+// @returns false if the queue is full or the control loop didn't enter the mode
+bool Controller::set_pos_setpoint_timed(float pos_setpoint, uint32_t timestamp) {
+    // Entering the mode restarts the queue, so it must be done before the push
+    if (config_.control_mode != CTRL_MODE_TIMED_POSITION_CONTROL
+            && !submit_command({ Command_t::TYPE_START_TIMED_POSITION, { 0.0f, 0.0f, 0.0f } }))
+        return false;
+    return timed_setpoint_.push(pos_setpoint, timestamp);
+}
+
 void Controller::set_vel_setpoint(float vel_setpoint, float current_feed_forward) {
     vel_setpoint_ = vel_setpoint;
     current_setpoint_ = current_feed_forward;
@@ -49,38 +63,309 @@ void Controller::set_current_setpoint(float current_setpoint) {
 #endif
 }
 
+// @brief Plans a trajectory from the current setpoint and starts it.
+// Only call from the control loop.
 void Controller::move_to_pos(float goal_point) {
-    axis_->trap_.planTrapezoidal(goal_point, pos_setpoint_, vel_setpoint_,
-                                 axis_->trap_.config_.vel_limit,
-                                 axis_->trap_.config_.accel_limit,
-                                 axis_->trap_.config_.decel_limit);
-    traj_start_loop_count_ = axis_->loop_counter_;
+    plan_move_to_pos(axis_->trap_, goal_point, pos_setpoint_, vel_setpoint_, 1.0f);
+    start_trajectory();
+}
+
+// @brief Plans a trajectory with the limits of this axis without starting it.
+// @param traj: Receives the plan, axis_->trap_ or a staging copy
+// @param time_scale: Stretches the move in time by lowering the limits:
+//        velocity by time_scale, acceleration by time_scale^2 and jerk by
+//        time_scale^3. From standstill this makes the move exactly time_scale
+//        times longer.
+// @returns the duration of the planned move [s]
+float Controller::plan_move_to_pos(TrapezoidalTrajectory& traj, float goal_point,
+                                   float start_pos, float start_vel, float time_scale) {
+    TrapezoidalTrajectory::Config_t& traj_config = axis_->trap_.config_;
+    float inv_scale = 1.0f / time_scale;
+    float inv_scale_sq = inv_scale * inv_scale;
+    bool planned = false;
+    if (traj_config.profile_type == TrapezoidalTrajectory::PROFILE_SCURVE) {
+        planned = traj.planSCurve(goal_point, start_pos, start_vel,
+                                  traj_config.vel_limit * inv_scale,
+                                  traj_config.accel_limit * inv_scale_sq,
+                                  traj_config.decel_limit * inv_scale_sq,
+                                  traj_config.jerk_limit * inv_scale_sq * inv_scale);
+    }
+    if (!planned) {
+        traj.planTrapezoidal(goal_point, start_pos, start_vel,
+                             traj_config.vel_limit * inv_scale,
+                             traj_config.accel_limit * inv_scale_sq,
+                             traj_config.decel_limit * inv_scale_sq);
+    }
+    return traj.Tf_;
+}
+
+// @brief Starts the planned trajectory in the next control cycle
+void Controller::start_trajectory() {
+    axis_->trap_.stepper_.restart();
     config_.control_mode = CTRL_MODE_TRAJECTORY_CONTROL;
 }
 
+// @brief Queues a PVT point. The communication threads (USB, UART and the
+// GCode interpreter) may push concurrently, so the pushes are serialized here.
+// @returns false if the queue is full or dt is not positive
+bool Controller::push_pvt(float pos, float vel, float dt) {
+    uint32_t mask = cpu_enter_critical();
+    bool queued = pvt_.push(pos, vel, dt);
+    cpu_exit_critical(mask);
+    return queued;
+}
+
+// @brief Starts playing the queued PVT points from the current setpoint.
+// Points may be queued before or after starting. Does nothing if the points
+// are already being played.
+void Controller::start_pvt() {
+    submit_command({ Command_t::TYPE_START_PVT, { 0.0f, 0.0f, 0.0f } });
+}
+
+// @brief Drops all queued PVT points. If they were being played, the axis
+// stops and holds the current position setpoint.
+void Controller::clear_pvt() {
+    submit_command({ Command_t::TYPE_CLEAR_PVT, { 0.0f, 0.0f, 0.0f } });
+}
+
+// @brief Queues a command for the control_tick tick. The communication
+// threads (USB, UART, CAN) may schedule concurrently, so the pushes are
+// serialized here.
+// @returns false if the schedule is full or tick lies before the last scheduled command
+bool Controller::schedule_command(uint32_t tick, const Command_t& command) {
+    uint32_t mask = cpu_enter_critical();
+    bool queued = schedule_.push(tick, command);
+    cpu_exit_critical(mask);
+    return queued;
+}
+
+bool Controller::schedule_pos_setpoint(uint32_t tick, float pos_setpoint, float vel_feed_forward, float current_feed_forward) {
+    return schedule_command(tick, { Command_t::TYPE_POS_SETPOINT, { pos_setpoint, vel_feed_forward, current_feed_forward } });
+}
+
+bool Controller::schedule_vel_setpoint(uint32_t tick, float vel_setpoint, float current_feed_forward) {
+    return schedule_command(tick, { Command_t::TYPE_VEL_SETPOINT, { vel_setpoint, current_feed_forward, 0.0f } });
+}
+
+bool Controller::schedule_current_setpoint(uint32_t tick, float current_setpoint) {
+    return schedule_command(tick, { Command_t::TYPE_CURRENT_SETPOINT, { current_setpoint, 0.0f, 0.0f } });
+}
+
+bool Controller::schedule_move_to_pos(uint32_t tick, float goal_point) {
+    return schedule_command(tick, { Command_t::TYPE_MOVE_TO_POS, { goal_point, 0.0f, 0.0f } });
+}
+
+// @brief Hands a command to the control loop, which applies it as a whole
+// at the start of its next cycle. A command that is posted before the previous
+// one was applied replaces it.
+void Controller::post_command(const Command_t& command) {
+    // another communication thread is posting, let it finish
+    while (!mailbox_.try_post(command))
+        osDelay(1);
+}
+
+void Controller::post_pos_setpoint(float pos_setpoint, float vel_feed_forward, float current_feed_forward) {
+    post_command({ Command_t::TYPE_POS_SETPOINT, { pos_setpoint, vel_feed_forward, current_feed_forward } });
+}
+
+// @brief Sets the position setpoint together with the velocity and current
+// limits, without changing the control mode
+void Controller::post_pos_setpoint_with_limits(float pos_setpoint, float vel_limit, float current_lim) {
+    post_command({ Command_t::TYPE_POS_SETPOINT_WITH_LIMITS, { pos_setpoint, vel_limit, current_lim } });
+}
+
+void Controller::post_vel_setpoint(float vel_setpoint, float current_feed_forward) {
+    post_command({ Command_t::TYPE_VEL_SETPOINT, { vel_setpoint, current_feed_forward, 0.0f } });
+}
+
+void Controller::post_current_setpoint(float current_setpoint) {
+    post_command({ Command_t::TYPE_CURRENT_SETPOINT, { current_setpoint, 0.0f, 0.0f } });
+}
+
+void Controller::post_move_to_pos(float goal_point) {
+    post_command({ Command_t::TYPE_MOVE_TO_POS, { goal_point, 0.0f, 0.0f } });
+}
+
+// @brief Hands a command to the control loop and waits until it was applied.
+// Unlike post_command(), commands are never replaced by later ones and are
+// applied in order, in any axis state. Several threads may submit.
+// @returns false if the control loop didn't apply the command within
+//          SUBMIT_TIMEOUT. It is still applied when the loop runs again.
+bool Controller::submit_command(const Command_t& command) {
+    uint32_t mask = cpu_enter_critical();
+    bool queued = submitted_.push(control_tick, command);
+    uint32_t count = submitted_.get_push_count();
+    cpu_exit_critical(mask);
+    if (!queued)
+        return false;
+    for (uint32_t waited = 0; (int32_t)(submitted_.get_pop_count() - count) < 0; ++waited) {
+        if (waited >= SUBMIT_TIMEOUT)
+            return false;
+        osDelay(1);
+    }
+    return true;
+}
+
+void Controller::apply_command(const Command_t& command) {
+    switch (command.type) {
+        case Command_t::TYPE_POS_SETPOINT:
+            set_pos_setpoint(command.args[0], command.args[1], command.args[2]);
+            break;
+        case Command_t::TYPE_VEL_SETPOINT:
+            set_vel_setpoint(command.args[0], command.args[1]);
+            break;
+        case Command_t::TYPE_CURRENT_SETPOINT:
+            set_current_setpoint(command.args[0]);
+            break;
+        case Command_t::TYPE_MOVE_TO_POS:
+            move_to_pos(command.args[0]);
+            break;
+        case Command_t::TYPE_POS_SETPOINT_WITH_LIMITS:
+            pos_setpoint_ = command.args[0];
+            config_.vel_limit = command.args[1];
+            axis_->motor_.config_.current_lim = command.args[2];
+            break;
+        case Command_t::TYPE_START_PVT:
+            // restarting would jump back to the current setpoint
+            if (config_.control_mode != CTRL_MODE_PVT_CONTROL) {
+                pvt_.start(pos_setpoint_, vel_setpoint_);
+                config_.control_mode = CTRL_MODE_PVT_CONTROL;
+            }
+            break;
+        case Command_t::TYPE_CLEAR_PVT:
+            if (config_.control_mode == CTRL_MODE_PVT_CONTROL) {
+                config_.control_mode = CTRL_MODE_POSITION_CONTROL;
+                vel_setpoint_ = 0.0f;
+                current_setpoint_ = 0.0f;
+            }
+            pvt_.clear();
+            break;
+        case Command_t::TYPE_START_TIMED_POSITION:
+            if (config_.control_mode != CTRL_MODE_TIMED_POSITION_CONTROL) {
+                timed_setpoint_.start(pos_setpoint_, current_meas_period);
+                config_.control_mode = CTRL_MODE_TIMED_POSITION_CONTROL;
+            }
+            break;
+        case Command_t::TYPE_START_ANTICOGGING_SWEEP:
+            begin_anticogging_sweep();
+            break;
+        case Command_t::TYPE_START_STAGED_MOVE:
+            start_staged_move();
+            break;
+        case Command_t::TYPE_CLEAR_ANTICOGGING_MAP:
+            anticogging_.cogging_map.clear();
+            break;
+    }
+}
+
+// @brief Applies the posted command, the submitted commands and the
+// scheduled commands that are due.
+// Called by the control loop before update(), so that the commands take
+// effect in this cycle and update() never sees half of a command.
+// Scheduled commands that come due while the controller doesn't drive the
+// motor (idle, calibration) are dropped and counted instead.
+void Controller::apply_pending_commands(uint32_t tick) {
+    Command_t command;
+    if (mailbox_.fetch(&command))
+        apply_command(command);
+    submitted_.apply_due(tick, [this](const Command_t& command) {
+        apply_command(command);
+    });
+    if (axis_->current_state_ == Axis::AXIS_STATE_CLOSED_LOOP_CONTROL
+            || axis_->current_state_ == Axis::AXIS_STATE_SENSORLESS_CONTROL) {
+        schedule_.apply_due(tick, [this](const Command_t& command) {
+            apply_command(command);
+        });
+    } else {
+        schedule_.drop_due(tick);
+    }
+}
+
 void Controller::start_anticogging_calibration() {
     // Ensure the cogging map was correctly allocated earlier and that the motor is capable of calibrating
-    if (anticogging_.cogging_map != NULL && axis_->error_ == Axis::ERROR_NONE) {
+    if (anticogging_.cogging_map.n_samples_ && axis_->error_ == Axis::ERROR_NONE) {
         anticogging_.calib_anticogging = true;
     }
 }
 
+// @brief Restores the anti-cogging map saved by save_calibration() if it is
+// compatible with the current configuration. Anti-cogging is enabled by
+// enable_loaded_anticogging() once the encoder position is referenced.
+// @param key: The axis number
+bool Controller::load_anticogging_map(uint32_t key) {
+    anticogging_.loaded_from_nvm = anticogging_.cogging_map.load(calibration_store, key);
+    anticogging_.enable_when_aligned = anticogging_.loaded_from_nvm;
+    return anticogging_.loaded_from_nvm;
+}
+
+// @brief Enables the restored map the first time closed loop control starts
+// with a referenced encoder
+void Controller::enable_loaded_anticogging() {
+    Encoder& encoder = axis_->encoder_;
+    if (anticogging_.enable_when_aligned
+            && CoggingMap::is_aligned(encoder.config_.mode & encoder.MODE_FLAG_ABS, encoder.index_found_)) {
+        anticogging_.use_anticogging = true;
+        anticogging_.enable_when_aligned = false;
+    }
+}
+
+// @brief Sets all samples of the anti-cogging map to zero
+void Controller::clear_anticogging_map() {
+    // the control loop evaluates the map, let it clear it between two cycles
+    submit_command({ Command_t::TYPE_CLEAR_ANTICOGGING_MAP, { 0.0f, 0.0f, 0.0f } });
+}
+
+/*
+ * Faster alternative to the step-by-step calibration: sweeps one revolution
+ * forward and one backward at anticogging_.sweep_vel in velocity control and
+ * bins the current command by position. See CoggingSweep for details.
+ */
+void Controller::start_anticogging_sweep() {
+    // the sweep clears the map and takes over the velocity setpoint
+    submit_command({ Command_t::TYPE_START_ANTICOGGING_SWEEP, { 0.0f, 0.0f, 0.0f } });
+}
+
+// @brief Starts the sweep, only call from the control loop
+void Controller::begin_anticogging_sweep() {
+    if (anticogging_.cogging_map.n_samples_ && axis_->error_ == Axis::ERROR_NONE) {
+        anticogging_.use_anticogging = false;
+        anticogging_.calib_anticogging = false;
+        if (!anticogging_.sweep.is_running())
+            anticogging_.sweep_vel_ramp_enable = vel_ramp_enable_;
+        vel_ramp_enable_ = false;
+        anticogging_.sweep.start(&anticogging_.cogging_map, axis_->encoder_.pos_estimate_);
+        set_vel_setpoint(anticogging_.sweep_vel, 0.0f);
+    }
+}
+
+// @brief Stops a running sweep and the axis, and restores the velocity ramp.
+// Only call from the control loop or while it isn't running.
+void Controller::end_anticogging_sweep() {
+    if (!anticogging_.sweep.is_running())
+        return;
+    anticogging_.sweep.abort();
+    vel_setpoint_ = 0.0f;
+    vel_ramp_target_ = 0.0f;
+    vel_ramp_enable_ = anticogging_.sweep_vel_ramp_enable;
+}
+
 /*
- * This anti-cogging implementation iterates through each encoder position,
+ * This anti-cogging implementation iterates through each sample position of the map,
  * waits for zero velocity & position error,
  * then samples the current required to maintain that position.
  * 
  * This holding current is added as a feedforward term in the control loop.
  */
 bool Controller::anticogging_calibration(float pos_estimate, float vel_estimate) {
-    if (anticogging_.calib_anticogging && anticogging_.cogging_map != NULL) {
-        float pos_err = anticogging_.index - pos_estimate;
+    CoggingMap& map = anticogging_.cogging_map;
+    if (anticogging_.calib_anticogging && map.n_samples_) {
+        float pos_err = map.get_sample_pos(anticogging_.index) - pos_estimate;
         if (fabsf(pos_err) <= anticogging_.calib_pos_threshold &&
             fabsf(vel_estimate) < anticogging_.calib_vel_threshold) {
-            anticogging_.cogging_map[anticogging_.index++] = vel_integrator_current_;
+            map.set_sample(anticogging_.index++, vel_integrator_current_);
         }
-        if (anticogging_.index < axis_->encoder_.config_.cpr) { // TODO: remove the dependency on encoder CPR
-            set_pos_setpoint(anticogging_.index, 0.0f, 0.0f);
+        if (anticogging_.index < map.n_samples_) {
+            set_pos_setpoint(map.get_sample_pos(anticogging_.index), 0.0f, 0.0f);
             return false;
         } else {
             anticogging_.index = 0;
@@ -98,19 +383,25 @@ bool Controller::update(float pos_estimate, float vel_estimate, float* current_s
     anticogging_calibration(pos_estimate, vel_estimate);
     float anticogging_pos = pos_estimate;
 
+    // Anti-cogging sweep: any change of the control mode aborts it
+    if (anticogging_.sweep.is_running()) {
+        if (config_.control_mode == CTRL_MODE_VELOCITY_CONTROL) {
+            vel_setpoint_ = anticogging_.sweep.get_direction() * anticogging_.sweep_vel;
+        } else {
+            end_anticogging_sweep();
+        }
+    }
+
     // Trajectory control
     if (config_.control_mode == CTRL_MODE_TRAJECTORY_CONTROL) {
-        // Note: uint32_t loop count delta is OK across overflow
-        // Beware of negative deltas, as they will not be well behaved due to uint!
-        float t = (axis_->loop_counter_ - traj_start_loop_count_) * current_meas_period;
-        if (t > axis_->trap_.Tf_) {
-            // Drop into position control mode when done to avoid problems on loop counter delta overflow
+        TrapezoidalTrajectory::Step_t traj_step;
+        if (!axis_->trap_.step(&traj_step)) {
+            // Drop into position control mode when done
             config_.control_mode = CTRL_MODE_POSITION_CONTROL;
             // pos_setpoint already set by trajectory
             vel_setpoint_ = 0.0f;
             current_setpoint_ = 0.0f;
         } else {
-            TrapezoidalTrajectory::Step_t traj_step = axis_->trap_.eval(t);
             pos_setpoint_ = traj_step.Y;
             vel_setpoint_ = traj_step.Yd;
             current_setpoint_ = traj_step.Ydd * axis_->trap_.config_.A_per_css;
@@ -118,6 +409,58 @@ bool Controller::update(float pos_estimate, float vel_estimate, float* current_s
         anticogging_pos = pos_setpoint_; // FF the position setpoint instead of the pos_estimate
     }
 
+    // Streamed PVT trajectory
+    if (config_.control_mode == CTRL_MODE_PVT_CONTROL) {
+        PvtTrajectory::Step_t pvt_step;
+        if (pvt_.step(current_meas_period, &pvt_step)) {
+            pos_setpoint_ = pvt_step.Y;
+            vel_setpoint_ = pvt_step.Yd;
+            current_setpoint_ = pvt_step.Ydd * axis_->trap_.config_.A_per_css;
+        } else {
+            // not started: hold the current setpoint
+            config_.control_mode = CTRL_MODE_POSITION_CONTROL;
+            vel_setpoint_ = 0.0f;
+            current_setpoint_ = 0.0f;
+        }
+        anticogging_pos = pos_setpoint_;
+    }
+
+    // Timestamped setpoints
+    if (config_.control_mode == CTRL_MODE_TIMED_POSITION_CONTROL) {
+        TimedSetpoint::Step_t timed_step;
+        timed_setpoint_.step(&timed_step);
+        pos_setpoint_ = timed_step.Y;
+        vel_setpoint_ = timed_step.Yd;
+        current_setpoint_ = 0.0f;
+        anticogging_pos = pos_setpoint_;
+    }
+
+    // Electronic gearing: follow the encoder of another axis
+    if (config_.control_mode == CTRL_MODE_FOLLOWER_CONTROL) {
+        uint32_t leader = config_.gearing.leader_axis;
+        if (leader >= AXIS_COUNT || axes[leader] == axis_) {
+            set_error(ERROR_INVALID_LEADER_AXIS);
+            return false;
+        }
+        // Written by the leader's control loop, which runs at the same rate.
+        // At worst this is one cycle old.
+        Encoder& leader_encoder = axes[leader]->encoder_;
+        if (!leader_encoder.is_ready_) {
+            // hold the setpoint, and engage again once the leader is ready
+            gearing_.disengage();
+            vel_setpoint_ = 0.0f;
+        } else {
+            if (!gearing_.is_engaged())
+                gearing_.engage(leader_encoder.pos_estimate_, pos_setpoint_);
+            gearing_.step(current_meas_period);
+            gearing_.eval(leader_encoder.pos_estimate_, leader_encoder.vel_estimate_, &pos_setpoint_, &vel_setpoint_);
+        }
+        current_setpoint_ = 0.0f;
+        anticogging_pos = pos_setpoint_;
+    } else {
+        gearing_.disengage();
+    }
+
     // Ramp rate limited velocity setpoint
     if (config_.control_mode == CTRL_MODE_VELOCITY_CONTROL && vel_ramp_enable_) {
         float max_step_size = current_meas_period * config_.vel_ramp_rate;
@@ -139,7 +482,7 @@ bool Controller::update(float pos_estimate, float vel_estimate, float* current_s
         if (config_.setpoints_in_cpr) {
             // TODO this breaks the semantics that estimates come in on the arguments.
             // It's probably better to call a get_estimate that will arbitrate (enc vs sensorless) instead.
-            float cpr = (float)(axis_->encoder_.config_.cpr);
+            float cpr = axis_->encoder_.cpr_float_;
             // Keep pos setpoint from drifting
             pos_setpoint_ = fmodf_pos(pos_setpoint_, cpr);
             // Circular delta
@@ -168,10 +511,12 @@ bool Controller::update(float pos_estimate, float vel_estimate, float* current_s
     float Iq = current_setpoint_;
 
     // Anti-cogging is enabled after calibration
-    // We get the current position and apply a current feed-forward
-    // ensuring that we handle negative encoder positions properly (-1 == motor->encoder.encoder_cpr - 1)
-    if (anticogging_.use_anticogging) {
-        Iq += anticogging_.cogging_map[mod(static_cast<int>(anticogging_pos), axis_->encoder_.config_.cpr)];
+    // We get the current position and apply a current feed-forward.
+    // Offsetting pos_cpr keeps the position close to one revolution, so the
+    // map wraps it with a single add or subtract.
+    if (anticogging_.use_anticogging && anticogging_.cogging_map.n_samples_) {
+        float anticogging_pos_cpr = axis_->encoder_.pos_cpr_ + (anticogging_pos - pos_estimate);
+        Iq += anticogging_.cogging_map.eval(anticogging_pos_cpr);
     }
 
     float v_err = vel_des - vel_estimate;
@@ -207,6 +552,123 @@ bool Controller::update(float pos_estimate, float vel_estimate, float* current_s
         }
     }
 
+    // Only runs while an anti-cogging sweep is in progress
+    if (anticogging_.sweep.is_running()) {
+        if (anticogging_.sweep.update(pos_estimate, Iq)) {
+            vel_setpoint_ = 0.0f;
+            vel_ramp_target_ = 0.0f;
+            vel_ramp_enable_ = anticogging_.sweep_vel_ramp_enable;
+            anticogging_.use_anticogging = true;  // We're good to go, enable anti-cogging
+        }
+    }
+
     if (current_setpoint_output) *current_setpoint_output = Iq;
     return true;
 }
+
+// The coordinated moves are planned on the communication thread into these
+// copies, so that the trajectories that the control loops are stepping stay
+// untouched. The control loops take them over at a common control_tick.
+// The plan functions get the limits passed, so the config is not used.
+static TrapezoidalTrajectory::Config_t staged_move_config;
+static TrapezoidalTrajectory staged_moves[AXIS_COUNT] = { staged_move_config, staged_move_config };
+static volatile bool staged_moves_armed = false;   // all axes have their start scheduled
+static bool coordinated_move_busy = false;
+
+// @brief Starts the move that move_to_pos_coordinated() staged for this axis.
+// Only call from the control loop.
+// If the setpoint moved on since the move was planned, the staged plan no
+// longer fits and the move is planned again from the current setpoint, with
+// the axis's own limits.
+void Controller::start_staged_move() {
+    if (!staged_moves_armed)
+        return;
+    size_t i = 0;
+    while (i < AXIS_COUNT && axes[i] != axis_)
+        ++i;
+    if (i == AXIS_COUNT)
+        return;
+    const TrapezoidalTrajectory& staged = staged_moves[i];
+    if (pos_setpoint_ == staged.Xi_ && vel_setpoint_ == staged.Vi_) {
+        axis_->trap_.load_plan(staged);
+        start_trajectory();
+    } else {
+        move_to_pos(staged.Xf_);
+    }
+}
+
+// @brief Moves all axes to their goal positions so that they arrive at the same time.
+//
+// Each axis plans its move with its own limits. The moves that would finish
+// early are then stretched in time to the duration of the slowest one, so the
+// path of the axes is a straight line when they start from standstill.
+// The moves are planned from a snapshot of the setpoints and all axes start
+// them at the same control_tick. An axis whose setpoint changed in between
+// replans its move from there and may arrive at a different time.
+// @returns false if not all axes are in closed loop control, or another
+//          coordinated move is being started
+bool move_to_pos_coordinated(float goal_point0, float goal_point1) {
+    static_assert(AXIS_COUNT == 2, "move_to_pos_coordinated takes one goal point per axis");
+    const float goal_points[AXIS_COUNT] = { goal_point0, goal_point1 };
+    float start_pos[AXIS_COUNT];
+    float start_vel[AXIS_COUNT];
+    float durations[AXIS_COUNT];
+    float duration = 0.0f;
+
+    for (size_t i = 0; i < AXIS_COUNT; ++i) {
+        if (axes[i]->current_state_ != Axis::AXIS_STATE_CLOSED_LOOP_CONTROL)
+            return false;
+    }
+
+    // the snapshot must not be torn by a control cycle
+    uint32_t mask = cpu_enter_critical();
+    bool busy = coordinated_move_busy;
+    coordinated_move_busy = true;
+    for (size_t i = 0; i < AXIS_COUNT; ++i) {
+        start_pos[i] = axes[i]->controller_.pos_setpoint_;
+        start_vel[i] = axes[i]->controller_.vel_setpoint_;
+    }
+    cpu_exit_critical(mask);
+    if (busy)
+        return false;
+
+    for (size_t i = 0; i < AXIS_COUNT; ++i) {
+        durations[i] = axes[i]->controller_.plan_move_to_pos(staged_moves[i], goal_points[i],
+                                                             start_pos[i], start_vel[i], 1.0f);
+        duration = std::max(duration, durations[i]);
+    }
+
+    for (size_t i = 0; i < AXIS_COUNT; ++i) {
+        if (durations[i] <= 0.0f || durations[i] >= duration)
+            continue;
+        // With a nonzero initial velocity the duration does not scale exactly,
+        // so refine the scale until the moves end within one control cycle.
+        float time_scale = duration / durations[i];
+        for (int iter = 0; iter < 4; ++iter) {
+            float scaled_duration = axes[i]->controller_.plan_move_to_pos(staged_moves[i], goal_points[i],
+                                                                          start_pos[i], start_vel[i], time_scale);
+            if (fabsf(scaled_duration - duration) < current_meas_period || scaled_duration <= 0.0f)
+                break;
+            time_scale *= duration / scaled_duration;
+        }
+    }
+
+    // A few cycles ahead, so that the command reaches both control loops in
+    // time. The control loops can't run until all axes are scheduled, and
+    // if an axis can't take the command, none of them starts.
+    const Controller::Command_t command = { Controller::Command_t::TYPE_START_STAGED_MOVE, { 0.0f, 0.0f, 0.0f } };
+    mask = cpu_enter_critical();
+    uint32_t tick = control_tick + 4;
+    bool scheduled = true;
+    for (size_t i = 0; i < AXIS_COUNT; ++i)
+        scheduled = scheduled && axes[i]->controller_.schedule_command(tick, command);
+    staged_moves_armed = scheduled;
+    cpu_exit_critical(mask);
+
+    // the staged moves must stay untouched until all axes took them over
+    for (uint32_t waited = 0; (int32_t)(control_tick - tick) <= 0 && waited < SUBMIT_TIMEOUT; ++waited)
+        osDelay(1);
+    staged_moves_armed = false;
+    coordinated_move_busy = false;
+    return scheduled;
+}
@@ -10,6 +10,7 @@ public:
     enum Error_t {
         ERROR_NONE = 0,
         ERROR_OVERSPEED = 0x01,
+        ERROR_INVALID_LEADER_AXIS = 0x02,
     };
 
     // Note: these should be sorted from lowest level of control to
@@ -19,7 +20,10 @@ public:
         CTRL_MODE_CURRENT_CONTROL = 1,
         CTRL_MODE_VELOCITY_CONTROL = 2,
         CTRL_MODE_POSITION_CONTROL = 3,
-        CTRL_MODE_TRAJECTORY_CONTROL = 4
+        CTRL_MODE_TRAJECTORY_CONTROL = 4,
+        CTRL_MODE_PVT_CONTROL = 5,
+        CTRL_MODE_TIMED_POSITION_CONTROL = 6,
+        CTRL_MODE_FOLLOWER_CONTROL = 7,
     };
 
     struct Config_t {
@@ -32,22 +36,87 @@ public:
         float vel_limit_tolerance = 0;//1.2f;  // ratio to vel_lim. 0.0f to disable
         float vel_ramp_rate = 10000.0f;  // [(counts/s) / s]
         bool setpoints_in_cpr = false;
+        float anticogging_stride = 4.0f;   // [counts] spacing of the anti-cogging map samples, applied at boot
+        float anticogging_scale = 0.001f;  // [A/LSB] resolution of the anti-cogging map, applied at boot
+        TimedSetpoint::Config_t timed_setpoint;
+        ElectronicGearing::Config_t gearing;
+    };
+
+    // Command that the control loop applies as a whole, either as soon as
+    // it is posted or at a scheduled control_tick
+    struct Command_t {
+        enum Type_t {
+            TYPE_POS_SETPOINT,
+            TYPE_VEL_SETPOINT,
+            TYPE_CURRENT_SETPOINT,
+            TYPE_MOVE_TO_POS,
+            TYPE_POS_SETPOINT_WITH_LIMITS,  // pos_setpoint, vel_limit, current_lim
+            TYPE_START_PVT,
+            TYPE_CLEAR_PVT,
+            TYPE_START_TIMED_POSITION,
+            TYPE_START_ANTICOGGING_SWEEP,
+            TYPE_START_STAGED_MOVE,         // see move_to_pos_coordinated()
+            TYPE_CLEAR_ANTICOGGING_MAP,
+        } type;
+        float args[3];
     };
 
     Controller(Config_t& config);
     void reset();
     void set_error(Error_t error);
 
+    // Apply immediately, only call from the control loop
     void set_pos_setpoint(float pos_setpoint, float vel_feed_forward, float current_feed_forward);
     void set_vel_setpoint(float vel_setpoint, float current_feed_forward);
     void set_current_setpoint(float current_setpoint);
 
+    // Applied by the control loop at the start of the next cycle, call from
+    // the communication threads
+    void post_command(const Command_t& command);
+    void post_pos_setpoint(float pos_setpoint, float vel_feed_forward, float current_feed_forward);
+    void post_pos_setpoint_with_limits(float pos_setpoint, float vel_limit, float current_lim);
+    void post_vel_setpoint(float vel_setpoint, float current_feed_forward);
+    void post_current_setpoint(float current_setpoint);
+    void post_move_to_pos(float goal_point);
+
+    // One-shot commands that must not be replaced by a later command.
+    // Call from the communication threads, never from the control loop.
+    bool submit_command(const Command_t& command);
+
     // Trajectory-Planned control
     void move_to_pos(float goal_point);
+    float plan_move_to_pos(TrapezoidalTrajectory& traj, float goal_point,
+                           float start_pos, float start_vel, float time_scale);
+    void start_trajectory();
+    void start_staged_move();
+
+    // Streamed (position, velocity, time) trajectory
+    bool push_pvt(float pos, float vel, float dt);
+    void start_pvt();
+    void clear_pvt();
+
+    // Timestamped position setpoints, interpolated with a delay
+    bool set_pos_setpoint_timed(float pos_setpoint, uint32_t timestamp);
+
+    // Commands scheduled for a control_tick, call from the communication threads
+    bool schedule_command(uint32_t tick, const Command_t& command);
+    bool schedule_pos_setpoint(uint32_t tick, float pos_setpoint, float vel_feed_forward, float current_feed_forward);
+    bool schedule_vel_setpoint(uint32_t tick, float vel_setpoint, float current_feed_forward);
+    bool schedule_current_setpoint(uint32_t tick, float current_setpoint);
+    bool schedule_move_to_pos(uint32_t tick, float goal_point);
+
+    void apply_command(const Command_t& command);
+    void apply_pending_commands(uint32_t tick);
     
     // TODO: make this more similar to other calibration loops
     void start_anticogging_calibration();
     bool anticogging_calibration(float pos_estimate, float vel_estimate);
+    void start_anticogging_sweep();
+    void begin_anticogging_sweep();
+    void end_anticogging_sweep();
+    bool load_anticogging_map(uint32_t key);
+    void enable_loaded_anticogging();
+    void clear_anticogging_map();
 
     bool update(float pos_estimate, float vel_estimate, float* current_setpoint);
 
@@ -55,27 +124,29 @@ public:
     Axis* axis_ = nullptr; // set by Axis constructor
 
     // TODO: anticogging overhaul:
-    // - expose selected (all?) variables on protocol
     // - make calibration user experience similar to motor & encoder calibration
-    // - use python tools to Fourier transform and write back the smoothed map or Fourier coefficients
-    // - make the calibration persistent
-
-    typedef struct {
-        int index;
-        float *cogging_map;
-        bool use_anticogging;
-        bool calib_anticogging;
-        float calib_pos_threshold;
-        float calib_vel_threshold;
-    } Anticogging_t;
-    Anticogging_t anticogging_ = {
-        .index = 0,
-        .cogging_map = nullptr,
-        .use_anticogging = false,
-        .calib_anticogging = false,
-        .calib_pos_threshold = 1.0f,
-        .calib_vel_threshold = 1.0f,
+
+    struct Anticogging_t {
+        uint32_t index = 0;
+        CoggingMap cogging_map;
+        bool use_anticogging = false;
+        bool calib_anticogging = false;
+        float calib_pos_threshold = 1.0f;
+        float calib_vel_threshold = 1.0f;
+        CoggingSweep sweep;
+        float sweep_vel = 2000.0f;  // [counts/s]
+        bool sweep_vel_ramp_enable = false; // vel_ramp_enable_ before the sweep
+        bool loaded_from_nvm = false;
+        bool enable_when_aligned = false;   // the restored map waits for the encoder reference
     };
+    Anticogging_t anticogging_;
+
+    PvtTrajectory pvt_;
+    TimedSetpoint timed_setpoint_;
+    ElectronicGearing gearing_;
+    CommandSchedule<Command_t, 16> schedule_;
+    CommandSchedule<Command_t, 8> submitted_;   // one-shot commands, due when pushed
+    Mailbox<Command_t> mailbox_;
 
     Error_t error_ = ERROR_NONE;
     // variables exposed on protocol
@@ -87,8 +158,6 @@ public:
     float vel_ramp_target_ = 0.0f;
     bool vel_ramp_enable_ = false;
 
-    uint32_t traj_start_loop_count_ = 0;
-
     // Communication protocol definitions
     auto make_protocol_definitions() {
         return make_protocol_member_list(
@@ -107,20 +176,106 @@ public:
                 make_protocol_property("vel_limit", &config_.vel_limit),
                 make_protocol_property("vel_limit_tolerance", &config_.vel_limit_tolerance),
                 make_protocol_property("vel_ramp_rate", &config_.vel_ramp_rate),
-                make_protocol_property("setpoints_in_cpr", &config_.setpoints_in_cpr)
+                make_protocol_property("setpoints_in_cpr", &config_.setpoints_in_cpr),
+                make_protocol_property("anticogging_stride", &config_.anticogging_stride),
+                make_protocol_property("anticogging_scale", &config_.anticogging_scale),
+                make_protocol_object("timed_setpoint",
+                    make_protocol_property("delay", &config_.timed_setpoint.delay),
+                    make_protocol_property("max_extrapolation", &config_.timed_setpoint.max_extrapolation)
+                ),
+                make_protocol_object("gearing",
+                    make_protocol_property("leader_axis", &config_.gearing.leader_axis),
+                    make_protocol_property("ratio", &config_.gearing.ratio),
+                    make_protocol_property("offset", &config_.gearing.offset),
+                    make_protocol_property("use_cam", &config_.gearing.use_cam),
+                    make_protocol_property("cam_period", &config_.gearing.cam_period),
+                    make_protocol_property("engage_vel", &config_.gearing.engage_vel)
+                )
+            ),
+            make_protocol_object("anticogging",
+                make_protocol_ro_property("index", &anticogging_.index),
+                make_protocol_ro_property("n_samples", &anticogging_.cogging_map.n_samples_),
+                make_protocol_ro_property("stride", &anticogging_.cogging_map.stride_),
+                make_protocol_ro_property("scale", &anticogging_.cogging_map.scale_),
+                make_protocol_array("samples", &anticogging_.cogging_map.samples_, &anticogging_.cogging_map.n_samples_,
+                    [](void* ctx) { static_cast<CoggingMap*>(ctx)->samples_written(); }, &anticogging_.cogging_map),
+                make_protocol_property("use_anticogging", &anticogging_.use_anticogging),
+                make_protocol_ro_property("loaded_from_nvm", &anticogging_.loaded_from_nvm),
+                make_protocol_ro_property("calib_anticogging", &anticogging_.calib_anticogging),
+                make_protocol_property("calib_pos_threshold", &anticogging_.calib_pos_threshold),
+                make_protocol_property("calib_vel_threshold", &anticogging_.calib_vel_threshold),
+                make_protocol_property("sweep_vel", &anticogging_.sweep_vel),
+                make_protocol_ro_property("sweep_state", &anticogging_.sweep.state_),
+                make_protocol_ro_property("sweep_progress", &anticogging_.sweep.progress_),
+                make_protocol_ro_property("sweep_friction", &anticogging_.sweep.friction_),
+                make_protocol_ro_property("sweep_asymmetry", &anticogging_.sweep.asymmetry_),
+                make_protocol_ro_property("sweep_ripple", &anticogging_.sweep.ripple_),
+                make_protocol_ro_property("sweep_missed_bins", &anticogging_.sweep.missed_bins_),
+                make_protocol_function("clear_map", *this, &Controller::clear_anticogging_map),
+                make_protocol_function("get_sample", anticogging_.cogging_map, &CoggingMap::get_sample, "index"),
+                make_protocol_function("set_sample", anticogging_.cogging_map, &CoggingMap::set_sample, "index", "current"),
+                make_protocol_function("add_harmonic", anticogging_.cogging_map, &CoggingMap::add_harmonic,
+                    "harmonic", "cos_amplitude", "sin_amplitude")
+            ),
+            make_protocol_object("pvt",
+                make_protocol_ro_property("state", &pvt_.state_),
+                make_protocol_ro_property("underrun_count", &pvt_.underrun_count_),
+                make_protocol_ro_property("min_level", &pvt_.min_level_),
+                make_protocol_function("push", *this, &Controller::push_pvt, "pos", "vel", "dt"),
+                make_protocol_function("get_level", pvt_, &PvtTrajectory::get_level),
+                make_protocol_function("start", *this, &Controller::start_pvt),
+                make_protocol_function("clear", *this, &Controller::clear_pvt)
+            ),
+            make_protocol_object("timed_setpoint",
+                make_protocol_ro_property("sample_count", &timed_setpoint_.sample_count_),
+                make_protocol_ro_property("late_count", &timed_setpoint_.late_count_),
+                make_protocol_ro_property("underflow_count", &timed_setpoint_.underflow_count_),
+                make_protocol_ro_property("interval", &timed_setpoint_.interval_),
+                make_protocol_ro_property("jitter", &timed_setpoint_.jitter_),
+                make_protocol_ro_property("max_jitter", &timed_setpoint_.max_jitter_)
             ),
-            make_protocol_function("set_pos_setpoint", *this, &Controller::set_pos_setpoint,
+            make_protocol_object("gearing",
+                make_protocol_function("get_cam_point", gearing_, &ElectronicGearing::get_cam_point, "index"),
+                make_protocol_function("set_cam_point", gearing_, &ElectronicGearing::set_cam_point, "index", "pos"),
+                make_protocol_function("clear_cam", gearing_, &ElectronicGearing::clear_cam)
+            ),
+            make_protocol_object("schedule",
+                make_protocol_ro_property("applied_count", &schedule_.applied_count_),
+                make_protocol_ro_property("late_count", &schedule_.late_count_),
+                make_protocol_ro_property("max_lateness", &schedule_.max_lateness_),
+                make_protocol_ro_property("dropped_count", &schedule_.dropped_count_),
+                make_protocol_function("get_depth", schedule_, &CommandSchedule<Command_t, 16>::get_depth),
+                make_protocol_function("pos_setpoint", *this, &Controller::schedule_pos_setpoint,
+                    "tick", "pos_setpoint", "vel_feed_forward", "current_feed_forward"),
+                make_protocol_function("vel_setpoint", *this, &Controller::schedule_vel_setpoint,
+                    "tick", "vel_setpoint", "current_feed_forward"),
+                make_protocol_function("current_setpoint", *this, &Controller::schedule_current_setpoint,
+                    "tick", "current_setpoint"),
+                make_protocol_function("move_to_pos", *this, &Controller::schedule_move_to_pos,
+                    "tick", "goal_point")
+            ),
+            make_protocol_object("mailbox",
+                make_protocol_ro_property("post_count", &mailbox_.post_count_),
+                make_protocol_ro_property("dropped_count", &mailbox_.dropped_count_),
+                make_protocol_ro_property("busy_count", &mailbox_.busy_count_)
+            ),
+            make_protocol_function("set_pos_setpoint", *this, &Controller::post_pos_setpoint,
                 "pos_setpoint", "vel_feed_forward", "current_feed_forward"),
-            make_protocol_function("set_vel_setpoint", *this, &Controller::set_vel_setpoint,
+            make_protocol_function("set_pos_setpoint_timed", *this, &Controller::set_pos_setpoint_timed,
+                "pos_setpoint", "timestamp"),
+            make_protocol_function("set_vel_setpoint", *this, &Controller::post_vel_setpoint,
                 "vel_setpoint", "current_feed_forward"),
-            make_protocol_function("set_current_setpoint", *this, &Controller::set_current_setpoint,
+            make_protocol_function("set_current_setpoint", *this, &Controller::post_current_setpoint,
                 "current_setpoint"),
-            make_protocol_function("move_to_pos", *this, &Controller::move_to_pos, "goal_point"),
-            make_protocol_function("start_anticogging_calibration", *this, &Controller::start_anticogging_calibration)
+            make_protocol_function("move_to_pos", *this, &Controller::post_move_to_pos, "goal_point"),
+            make_protocol_function("start_anticogging_calibration", *this, &Controller::start_anticogging_calibration),
+            make_protocol_function("start_anticogging_sweep", *this, &Controller::start_anticogging_sweep)
         );
     }
 };
 
 DEFINE_ENUM_FLAG_OPERATORS(Controller::Error_t)
 
+bool move_to_pos_coordinated(float goal_point0, float goal_point1);
+
 #endif // __CONTROLLER_HPP
@@ -70,6 +70,7 @@ void Encoder::set_linear_count(int32_t count) {
 
     // Update states
     shadow_count_ = count;
+    pos_pll_.set_count(count);
     pos_estimate_ = (float)count;
     //Write hardware last
     hw_config_.timer->Instance->CNT = count;
@@ -90,6 +91,7 @@ void Encoder::set_circular_count(int32_t count, bool update_offset) {
 
     // Update states
     count_in_cpr_ = mod(count, config_.cpr);
+    cpr_pll_.set_count(count_in_cpr_);
     pos_cpr_ = (float)count_in_cpr_;
 
     cpu_exit_critical(prim);
@@ -199,10 +201,8 @@ bool Encoder::run_offset_calibration() {
         return false;
     }
 
-    //TODO avoid recomputing elec_rad_per_enc every time
     // Check CPR
-    float elec_rad_per_enc = axis_->motor_.config_.pole_pairs * 2 * M_PI * (1.0f / (float)(config_.cpr));
-    float expected_encoder_delta = scan_distance / elec_rad_per_enc;
+    float expected_encoder_delta = scan_distance / elec_rad_per_enc_;
     float actual_encoder_delta_abs = fabsf(shadow_count_-init_enc_val);
     if(fabsf(actual_encoder_delta_abs - expected_encoder_delta)/expected_encoder_delta > config_.calib_range)
     {
@@ -248,15 +248,24 @@ static bool decode_hall(uint8_t hall_state, int32_t* hall_cnt) {
 }
 
 void Encoder::update_pll_gains() {
-    pll_kp_ = 2.0f * config_.bandwidth;  // basic conversion to discrete time
-    pll_ki_ = 0.25f * (pll_kp_ * pll_kp_); // Critically damped
-
-    // Check that we don't get problems with discrete time approximation
-    if (!(current_meas_period * pll_kp_ < 1.0f)) {
+    if (!pll_gains_.set_bandwidth(config_.bandwidth, current_meas_period)) {
         set_error(ERROR_UNSTABLE_GAIN);
     }
 }
 
+// @brief Recomputes the values derived from the CPR and the motor pole pairs.
+// This should be invoked whenever one of these values changes.
+void Encoder::update_cpr_params() {
+    if (config_.cpr <= 0) {
+        // keep the previous values, the PLL range must stay positive
+        set_error(ERROR_CPR_OUT_OF_RANGE);
+        return;
+    }
+    cpr_float_ = (float)(config_.cpr);
+    cpr_pll_.set_range(config_.cpr);
+    elec_rad_per_enc_ = axis_->motor_.config_.pole_pairs * 2 * M_PI * (1.0f / cpr_float_);
+}
+
 bool Encoder::abs_spi_init(){
     if ((config_.mode & MODE_FLAG_ABS) == 0x0)
         return false;
@@ -420,19 +429,16 @@ bool Encoder::update() {
 
     //// run pll (for now pll is in units of encoder counts)
     // Predict current pos
-    pos_estimate_ += current_meas_period * vel_estimate_;
-    pos_cpr_      += current_meas_period * vel_estimate_;
-    // discrete phase detector
-    float delta_pos     = (float)(shadow_count_ - (int32_t)floorf(pos_estimate_));
-    float delta_pos_cpr = (float)(count_in_cpr_ - (int32_t)floorf(pos_cpr_));
-    delta_pos_cpr = wrap_pm(delta_pos_cpr, 0.5f * (float)(config_.cpr));
-    // pll feedback
-    pos_estimate_ += current_meas_period * pll_kp_ * delta_pos;
-    pos_cpr_      += current_meas_period * pll_kp_ * delta_pos_cpr;
-    pos_cpr_ = fmodf_pos(pos_cpr_, (float)(config_.cpr));
-    vel_estimate_      += current_meas_period * pll_ki_ * delta_pos_cpr;
+    pos_pll_.predict(current_meas_period, vel_estimate_);
+    cpr_pll_.predict(current_meas_period);
+    // discrete phase detector and pll feedback, in exact integer arithmetic
+    // (the linear position only tracks the phase, velocity comes from the cpr pll)
+    pos_pll_.correct_phase(shadow_count_, pll_gains_);
+    cpr_pll_.correct(count_in_cpr_, pll_gains_);
+    pos_estimate_ = pos_pll_.get_phase();
+    pos_cpr_ = cpr_pll_.get_phase();
     bool snap_to_zero_vel = false;
-    if (fabsf(vel_estimate_) < 0.5f * current_meas_period * pll_ki_) {
+    if (fabsf(vel_estimate_) < 0.5f * pll_gains_.ki_dt) {
         vel_estimate_ = 0.0f; //align delta-sigma on zero to prevent jitter
         snap_to_zero_vel = true;
     }
@@ -457,9 +463,7 @@ bool Encoder::update() {
     float interpolated_enc = corrected_enc + interpolation_;
 
     //// compute electrical phase
-    //TODO avoid recomputing elec_rad_per_enc every time
-    float elec_rad_per_enc = axis_->motor_.config_.pole_pairs * 2 * M_PI * (1.0f / (float)(config_.cpr));
-    float ph = elec_rad_per_enc * (interpolated_enc - config_.offset_float);
+    float ph = elec_rad_per_enc_ * (interpolated_enc - config_.offset_float);
     // ph = fmodf(ph, 2*M_PI);
     phase_ = wrap_pm_pi(ph);
 
@@ -66,6 +66,7 @@ public:
     bool update();
 
     void update_pll_gains();
+    void update_cpr_params();
 
     const EncoderHardwareConfig_t& hw_config_;
     Config_t& config_;
@@ -78,11 +79,15 @@ public:
     int32_t count_in_cpr_ = 0;
     float interpolation_ = 0.0f;
     float phase_ = 0.0f;    // [count]
-    float pos_estimate_ = 0.0f;  // [count]
-    float pos_cpr_ = 0.0f;  // [count]
-    float vel_estimate_ = 0.0f;  // [count/s]
-    float pll_kp_ = 0.0f;   // [count/s / count]
-    float pll_ki_ = 0.0f;   // [(count/s^2) / count]
+    FixedPointPll pos_pll_;     // linear position, follows the velocity of cpr_pll_
+    FixedPointPll cpr_pll_;     // position in [0, cpr)
+    PllGains pll_gains_;
+    float pos_estimate_ = 0.0f; // [count] float copy of pos_pll_ for the controller and protocol, loses resolution beyond 2^24 counts
+    float pos_cpr_ = 0.0f;      // [count] float copy of cpr_pll_
+    float& vel_estimate_ = cpr_pll_.vel_;   // [count/s]
+    // Derived from config_.cpr and motor pole_pairs (see update_cpr_params)
+    float cpr_float_ = 0.0f;        // [count]
+    float elec_rad_per_enc_ = 0.0f; // [rad/count]
     int32_t pos_abs_ = 0;
     float spi_error_rate_ = 0.0f;
     float pos_abs_filter_ = 0.0f;
@@ -113,15 +118,15 @@ public:
             make_protocol_property("count_in_cpr", &count_in_cpr_),
             make_protocol_property("interpolation", &interpolation_),
             make_protocol_property("phase", &phase_),
-            make_protocol_property("pos_estimate", &pos_estimate_),
+            make_protocol_ro_property("pos_estimate", &pos_estimate_),
             make_protocol_property("pos_cpr", &pos_cpr_),
             make_protocol_property("hall_state", &hall_state_),
             make_protocol_property("vel_estimate", &vel_estimate_),
             make_protocol_property("pos_abs", &pos_abs_),
             make_protocol_property("pos_abs_filter", &pos_abs_filter_),
             make_protocol_property("lp_filter_coefficient", &lp_filter_coefficient_),
-            // make_protocol_property("pll_kp", &pll_kp_),
-            // make_protocol_property("pll_ki", &pll_ki_),
+            // make_protocol_property("pll_kp", &pll_gains_.kp),
+            // make_protocol_property("pll_ki", &pll_gains_.ki),
             make_protocol_object("config",
                 make_protocol_property("mode", &config_.mode,
                     [](void* ctx) { static_cast<Encoder*>(ctx)->abs_spi_init(); }, this),
@@ -131,7 +136,8 @@ public:
                 make_protocol_property("pre_calibrated", &config_.pre_calibrated),
                 make_protocol_property("idx_search_speed", &config_.idx_search_speed),
                 make_protocol_property("zero_count_on_find_idx", &config_.zero_count_on_find_idx),
-                make_protocol_property("cpr", &config_.cpr),
+                make_protocol_property("cpr", &config_.cpr,
+                    [](void* ctx) { static_cast<Encoder*>(ctx)->update_cpr_params(); }, this),
                 make_protocol_property("offset", &config_.offset),
                 make_protocol_property("offset_float", &config_.offset_float),
                 make_protocol_property("bandwidth", &config_.bandwidth,
@@ -0,0 +1,108 @@
+#ifndef _GEARING_H
+#define _GEARING_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <math.h>
+
+#include "utils.h"
+
+// @brief Maps the position of a leader axis to the setpoint of a follower.
+//
+//   follower = offset + ratio * leader + cam(leader)
+//
+// The optional cam table adds a periodic profile: kCamPoints samples spread
+// evenly over cam_period counts of the leader, interpolated linearly. The
+// velocity feedforward is the derivative of the mapping times the leader
+// velocity.
+//
+// engage() makes the mapping start at the current follower setpoint instead
+// of jumping onto it. step() then moves the follower onto the mapping at
+// engage_vel on top of the leader's motion.
+class ElectronicGearing {
+public:
+    static constexpr size_t kCamPoints = 64;
+
+    struct Config_t {
+        uint32_t leader_axis = 0;
+        float ratio = 1.0f;         // [follower counts / leader count]
+        float offset = 0.0f;        // [counts]
+        bool use_cam = false;
+        float cam_period = 8192.0f; // [leader counts]
+        float engage_vel = 2000.0f; // [counts/s] rate at which the follower moves onto the mapping
+    };
+
+    ElectronicGearing(Config_t& config) : config_(config) {}
+
+    // @brief Offsets the mapping so that it starts at the current follower
+    // setpoint. Call when follower control starts.
+    void engage(float leader_pos, float follower_pos) {
+        float pos, vel;
+        engage_offset_ = 0.0f;
+        eval(leader_pos, 0.0f, &pos, &vel);
+        engage_offset_ = follower_pos - pos;
+        engaged_ = true;
+    }
+
+    void disengage() {
+        engaged_ = false;
+    }
+
+    bool is_engaged() const {
+        return engaged_;
+    }
+
+    // @brief Moves the remaining engage offset towards zero by one control cycle
+    void step(float dt) {
+        float max_step = fabsf(config_.engage_vel) * dt;
+        if (fabsf(engage_offset_) <= max_step)
+            engage_offset_ = 0.0f;
+        else
+            engage_offset_ -= copysignf(max_step, engage_offset_);
+    }
+
+    // @brief Computes the follower setpoints from the leader position [counts]
+    // and velocity [counts/s]
+    void eval(float leader_pos, float leader_vel, float* pos, float* vel) const {
+        float slope = config_.ratio;
+        *pos = config_.offset + config_.ratio * leader_pos + engage_offset_;
+        if (config_.use_cam && config_.cam_period > 0.0f) {
+            float samples_per_count = (float)kCamPoints / config_.cam_period;
+            float x = fmodf_pos(leader_pos, config_.cam_period) * samples_per_count;
+            size_t index = (size_t)x;
+            if (index >= kCamPoints)
+                index = kCamPoints - 1; // rounding at the end of the period
+            float frac = x - (float)index;
+            float y0 = cam_[index];
+            float y1 = cam_[(index + 1) % kCamPoints];
+            *pos += y0 + frac * (y1 - y0);
+            slope += (y1 - y0) * samples_per_count;
+        }
+        *vel = slope * leader_vel;
+        if (engage_offset_ != 0.0f)
+            *vel -= copysignf(fabsf(config_.engage_vel), engage_offset_);
+    }
+
+    float get_cam_point(uint32_t index) {
+        return index < kCamPoints ? cam_[index] : 0.0f;
+    }
+
+    // @param pos: [follower counts] at leader position index * cam_period / kCamPoints
+    void set_cam_point(uint32_t index, float pos) {
+        if (index < kCamPoints)
+            cam_[index] = pos;
+    }
+
+    void clear_cam() {
+        for (size_t i = 0; i < kCamPoints; ++i)
+            cam_[i] = 0.0f;
+    }
+
+private:
+    Config_t& config_;
+    float cam_[kCamPoints] = {};
+    bool engaged_ = false;
+    float engage_offset_ = 0.0f;    // [counts] still to be removed by step()
+};
+
+#endif
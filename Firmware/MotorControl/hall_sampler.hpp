@@ -0,0 +1,63 @@
+#ifndef _HALL_SAMPLER_H
+#define _HALL_SAMPLER_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+// @brief Samples the hall inputs of an encoder in the PWM timer update
+// interrupt, coherent with the current measurement, and decodes them in the
+// current measurement interrupt.
+//
+// init() works out once which GPIO ports hold the hall pins and where each
+// hall bit is found, so the interrupts only read the ports that are used and
+// decode with a fixed port slot and pin mask per bit instead of searching
+// the ports.
+//
+// @tparam TPort: GPIO port type with an IDR register (GPIO_TypeDef or a mock)
+template<typename TPort>
+class HallSampler {
+public:
+    static constexpr size_t kNumInputs = 3;
+
+    // @brief Precomputes the sampling and decoding
+    // @param ports, pins: Hall inputs A, B, C. Inputs may share a port.
+    void init(TPort* const ports[kNumInputs], const uint16_t pins[kNumInputs]) {
+        n_ports_ = 0;
+        for (size_t i = 0; i < kNumInputs; ++i) {
+            size_t slot = 0;
+            while (slot < n_ports_ && ports_[slot] != ports[i])
+                ++slot;
+            if (slot == n_ports_)
+                ports_[n_ports_++] = ports[i];
+            slot_[i] = (uint8_t)slot;
+            mask_[i] = pins[i];
+        }
+    }
+
+    // @brief Latches the ports, called in the timer update interrupt
+    void sample() {
+        for (size_t i = 0; i < n_ports_; ++i)
+            samples_[i] = (uint16_t)ports_[i]->IDR;
+    }
+
+    // @brief Hall state of the last sample: C in bit 2, B in bit 1, A in bit 0
+    uint8_t decode() const {
+        return (uint8_t)(((samples_[slot_[2]] & mask_[2]) ? 4 : 0)
+                       | ((samples_[slot_[1]] & mask_[1]) ? 2 : 0)
+                       | ((samples_[slot_[0]] & mask_[0]) ? 1 : 0));
+    }
+
+    // @brief Number of ports read per sample
+    size_t get_port_count() const {
+        return n_ports_;
+    }
+
+private:
+    TPort* ports_[kNumInputs] = {};
+    size_t n_ports_ = 0;
+    uint16_t samples_[kNumInputs] = {};
+    uint8_t slot_[kNumInputs] = {};     // sample slot of each input
+    uint16_t mask_[kNumInputs] = {};    // pin of each input
+};
+
+#endif
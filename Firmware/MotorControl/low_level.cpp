@@ -20,6 +20,7 @@
 #include <utils.h>
 
 #include "odrive_main.h"
+#include "hall_sampler.hpp"
 
 /* Private defines -----------------------------------------------------------*/
 
@@ -35,14 +36,13 @@ const float adc_ref_voltage = 3.3f;
 // This value is updated by the DC-bus reading ADC.
 // Arbitrary non-zero inital value to avoid division by zero if ADC reading is late
 float vbus_voltage = 12.0f;
+uint32_t control_tick = 0; // current measurements of M0, common time base of both control loops
 bool brake_resistor_armed = false;
 /* Private constant data -----------------------------------------------------*/
-static const GPIO_TypeDef* GPIOs_to_samp[] = { GPIOA, GPIOB, GPIOC };
-static const int num_GPIO = sizeof(GPIOs_to_samp) / sizeof(GPIOs_to_samp[0]); 
 /* Private variables ---------------------------------------------------------*/
 
-// Two motors, sampling port A,B,C (coherent with current meas timing)
-static uint16_t GPIO_port_samples [2][num_GPIO];
+// One per motor, samples the hall ports coherent with current meas timing
+static HallSampler<GPIO_TypeDef> hall_samplers[AXIS_COUNT];
 /* CPU critical section helpers ----------------------------------------------*/
 
 /* Safety critical functions -------------------------------------------------*/
@@ -197,17 +197,29 @@ void safety_critical_apply_brake_resistor_timings(uint32_t low_off, uint32_t hig
 /* Function implementations --------------------------------------------------*/
 
 void start_adc_pwm() {
+    // Hall sampling starts with the timer update interrupts below
+    for (size_t i = 0; i < AXIS_COUNT; ++i) {
+        const EncoderHardwareConfig_t& enc = axes[i]->encoder_.hw_config_;
+        GPIO_TypeDef* const hall_ports[] = { enc.hallA_port, enc.hallB_port, enc.hallC_port };
+        const uint16_t hall_pins[] = { enc.hallA_pin, enc.hallB_pin, enc.hallC_pin };
+        hall_samplers[i].init(hall_ports, hall_pins);
+    }
+
     // Enable ADC and interrupts
     __HAL_ADC_ENABLE(&hadc1);
-    __HAL_ADC_ENABLE(&hadc2);
-    __HAL_ADC_ENABLE(&hadc3);
+    for (size_t i = 0; i < AXIS_COUNT; ++i) {
+        __HAL_ADC_ENABLE(axis_isr_table.descriptors[i].adc_phB);
+        __HAL_ADC_ENABLE(axis_isr_table.descriptors[i].adc_phC);
+    }
     // Warp field stabilize.
     osDelay(2);
     __HAL_ADC_ENABLE_IT(&hadc1, ADC_IT_JEOC);
-    __HAL_ADC_ENABLE_IT(&hadc2, ADC_IT_JEOC);
-    __HAL_ADC_ENABLE_IT(&hadc3, ADC_IT_JEOC);
-    __HAL_ADC_ENABLE_IT(&hadc2, ADC_IT_EOC);
-    __HAL_ADC_ENABLE_IT(&hadc3, ADC_IT_EOC);
+    for (size_t i = 0; i < AXIS_COUNT; ++i) {
+        const BoardAxisIsrTable_t::Descriptor_t& desc = axis_isr_table.descriptors[i];
+        uint32_t adc_it = desc.injected ? ADC_IT_JEOC : ADC_IT_EOC;
+        __HAL_ADC_ENABLE_IT(desc.adc_phB, adc_it);
+        __HAL_ADC_ENABLE_IT(desc.adc_phC, adc_it);
+    }
 
     // Ensure that debug halting of the core doesn't leave the motor PWM running
     __HAL_DBGMCU_FREEZE_TIM1();
@@ -219,13 +231,13 @@ void start_adc_pwm() {
     sync_timers(&htim1, &htim8, TIM_CLOCKSOURCE_ITR0, TIM_1_8_PERIOD_CLOCKS / 2 - 1 * 128,
             &htim13);
 
-    // Motor output starts in the disabled state
-    __HAL_TIM_MOE_DISABLE_UNCONDITIONALLY(&htim1);
-    __HAL_TIM_MOE_DISABLE_UNCONDITIONALLY(&htim8);
-
-    // Enable the update interrupt (used to coherently sample GPIO)
-    __HAL_TIM_ENABLE_IT(&htim1, TIM_IT_UPDATE);
-    __HAL_TIM_ENABLE_IT(&htim8, TIM_IT_UPDATE);
+    for (size_t i = 0; i < AXIS_COUNT; ++i) {
+        TIM_HandleTypeDef* htim = axis_isr_table.descriptors[i].timer;
+        // Motor output starts in the disabled state
+        __HAL_TIM_MOE_DISABLE_UNCONDITIONALLY(htim);
+        // Enable the update interrupt (used to coherently sample GPIO)
+        __HAL_TIM_ENABLE_IT(htim, TIM_IT_UPDATE);
+    }
 
     // Start brake resistor PWM in floating output configuration
     htim2.Instance->CCR3 = 0;
@@ -426,40 +438,28 @@ void vbus_sense_adc_cb(ADC_HandleTypeDef* hadc, bool injected) {
     // Only one conversion in sequence, so only rank1
     uint32_t ADCValue = HAL_ADCEx_InjectedGetValue(hadc, ADC_INJECTED_RANK_1);
     vbus_voltage = ADCValue * voltage_scale;
-    if (axes[0] && !axes[0]->error_ && axes[1] && !axes[1]->error_) {
-        if (oscilloscope_pos >= OSCILLOSCOPE_SIZE)
-            oscilloscope_pos = 0;
-        oscilloscope[oscilloscope_pos++] = vbus_voltage;
-    }
 }
 
-static void decode_hall_samples(Encoder& enc, uint16_t GPIO_samples[num_GPIO]) {
-    GPIO_TypeDef* hall_ports[] = {
-        enc.hw_config_.hallC_port,
-        enc.hw_config_.hallB_port,
-        enc.hw_config_.hallA_port,
-    };
-    uint16_t hall_pins[] = {
-        enc.hw_config_.hallC_pin,
-        enc.hw_config_.hallB_pin,
-        enc.hw_config_.hallA_pin,
-    };
-
-    uint8_t hall_state = 0x0;
-    for (int i = 0; i < 3; ++i) {
-        int port_idx = 0;
-        for (;;) {
-            auto port = GPIOs_to_samp[port_idx];
-            if (port == hall_ports[i])
-                break;
-            ++port_idx;
-        }
-
-        hall_state <<= 1;
-        hall_state |= (GPIO_samples[port_idx] & hall_pins[i]) ? 1 : 0;
-    }
+// @brief Records the oscilloscope channels, once per control cycle
+static void update_oscilloscope(uint64_t time_us) {
+    oscilloscope.update([](uint32_t channel) {
+        float value = 0.0f;
+        Endpoint* endpoint = oscilloscope_endpoints[channel];
+        if (endpoint)
+            endpoint->get_as_float(&value);
+        return value;
+    }, time_us);
+}
 
-    enc.hall_state_ = hall_state;
+// @brief Records the telemetry channels, once per control cycle
+static void update_telemetry(uint64_t time_us) {
+    telemetry.update([](uint32_t channel) {
+        float value = 0.0f;
+        Endpoint* endpoint = telemetry_endpoints[channel];
+        if (endpoint)
+            endpoint->get_as_float(&value);
+        return value;
+    }, time_us);
 }
 
 // This is the callback from the ADC that we expect after the PWM has triggered an ADC conversion.
@@ -468,43 +468,29 @@ void pwm_trig_adc_cb(ADC_HandleTypeDef* hadc, bool injected) {
 #define calib_tau 0.2f  //@TOTO make more easily configurable
     static const float calib_filter_k = CURRENT_MEAS_PERIOD / calib_tau;
 
-    // Ensure ADCs are expected ones to simplify the logic below
-    if (!(hadc == &hadc2 || hadc == &hadc3)) {
+    // Look up the axis of the conversion, see axis_isr_table in the board config
+    // If the timer of the axis is counting up, we just sampled in SVM vector 0, i.e. real current
+    // If we are counting down, we just sampled in SVM vector 7, with zero current
+    size_t axis_num;
+    if (!axis_isr_table.find_adc(hadc, injected, &axis_num)) {
         low_level_fault(Motor::ERROR_ADC_FAILED);
         return;
     };
-
-    // Motor 0 is on Timer 1, which triggers ADC 2 and 3 on an injected conversion
-    // Motor 1 is on Timer 8, which triggers ADC 2 and 3 on a regular conversion
-    // If the corresponding timer is counting up, we just sampled in SVM vector 0, i.e. real current
-    // If we are counting down, we just sampled in SVM vector 7, with zero current
-    Axis& axis = injected ? *axes[0] : *axes[1];
-    int axis_num = injected ? 0 : 1;
-    Axis& other_axis = injected ? *axes[1] : *axes[0];
+    Axis& axis = *axes[axis_num];
     bool counting_down = axis.motor_.hw_config_.timer->Instance->CR1 & TIM_CR1_DIR;
-    bool current_meas_not_DC_CAL = !counting_down;
+    const BoardAxisIsrTable_t::AdcEvent_t event = axis_isr_table.get_adc_event(axis_num, hadc, counting_down);
 
     // Check the timing of the sequencing
-    if (current_meas_not_DC_CAL)
+    if (event.current_meas)
         axis.motor_.log_timing(Motor::TIMING_LOG_ADC_CB_I);
     else
         axis.motor_.log_timing(Motor::TIMING_LOG_ADC_CB_DC);
 
-    bool update_timings = false;
-    if (hadc == &hadc2) {
-        if (&axis == axes[1] && counting_down)
-            update_timings = true; // update timings of M0
-        else if (&axis == axes[0] && !counting_down)
-            update_timings = true; // update timings of M1
-
-        if((current_meas_not_DC_CAL && !axis_num) ||
-                (axis_num && !current_meas_not_DC_CAL)){
-            axis.encoder_.abs_spi_start_transaction();
-        }
-    }
-
     // Load next timings for the motor that we're not currently sampling
-    if (update_timings) {
+    if (event.load_timings) {
+        axis.encoder_.abs_spi_start_transaction();
+
+        Axis& other_axis = *axes[event.timings_axis];
         if (!other_axis.motor_.next_timings_valid_) {
             // the motor control loop failed to update the timings in time
             // we must assume that it died and therefore float all phases
@@ -513,6 +499,7 @@ void pwm_trig_adc_cb(ADC_HandleTypeDef* hadc, bool injected) {
                 other_axis.motor_.error_ |= Motor::ERROR_CONTROL_DEADLINE_MISSED;
             }
         } else {
+            other_axis.motor_.log_deadline_slack();
             other_axis.motor_.next_timings_valid_ = false;
             safety_critical_apply_motor_pwm_timings(
                 other_axis.motor_, other_axis.motor_.next_timings_
@@ -529,27 +516,34 @@ void pwm_trig_adc_cb(ADC_HandleTypeDef* hadc, bool injected) {
     }
     float current = axis.motor_.phase_current_from_adcval(ADCValue);
 
-    if (current_meas_not_DC_CAL) {
-        // ADC2 and ADC3 record the phB and phC currents concurrently,
+    if (event.current_meas) {
+        // The phB and phC ADCs record the currents concurrently,
         // and their interrupts should arrive on the same clock cycle.
-        // We dispatch the callbacks in order, so ADC2 will always be processed before ADC3.
-        // Therefore we store the value from ADC2 and signal the thread that the
-        // measurement is ready when we receive the ADC3 measurement
-
-        // return or continue
-        if (hadc == &hadc2) {
+        // We dispatch the callbacks in order, so phB will always be processed before phC.
+        // Therefore we store the value from phB and signal the thread that the
+        // measurement is ready when we receive the phC measurement
+        if (event.phB) {
             axis.motor_.current_meas_.phB = current - axis.motor_.DC_calib_.phB;
-            return;
         } else {
             axis.motor_.current_meas_.phC = current - axis.motor_.DC_calib_.phC;
         }
+        if (!event.meas_complete)
+            return;
+        if (event.control_tick)
+            ++control_tick;
         // Prepare hall readings
-        decode_hall_samples(axis.encoder_, GPIO_port_samples[axis_num]);
+        axis.encoder_.hall_state_ = hall_samplers[axis_num].decode();
         // Trigger axis thread
         axis.signal_current_meas();
+        // Sampled after the control cycle was started so that it isn't delayed
+        if (event.control_tick) {
+            uint64_t time_us = micros64();
+            update_oscilloscope(time_us);
+            update_telemetry(time_us);
+        }
     } else {
         // DC_CAL measurement
-        if (hadc == &hadc2) {
+        if (event.phB) {
             axis.motor_.DC_calib_.phB += (current - axis.motor_.DC_calib_.phB) * calib_filter_k;
         } else {
             axis.motor_.DC_calib_.phC += (current - axis.motor_.DC_calib_.phC) * calib_filter_k;
@@ -558,19 +552,13 @@ void pwm_trig_adc_cb(ADC_HandleTypeDef* hadc, bool injected) {
 }
 
 void tim_update_cb(TIM_HandleTypeDef* htim) {
-    int portsamples_arr;
-    if (htim == &htim1) {
-        portsamples_arr = 0;
-    } else if (htim == &htim8) {
-        portsamples_arr = 1;
-    } else {
+    int axis_num = axis_isr_table.find_timer(htim);
+    if (axis_num < 0) {
         low_level_fault(Motor::ERROR_UNEXPECTED_TIMER_CALLBACK);
         return;
     }
 
-    for (int i = 0; i < num_GPIO; ++i) {
-        GPIO_port_samples[portsamples_arr][i] = GPIOs_to_samp[i]->IDR;
-    }
+    hall_samplers[axis_num].sample();
 }
 
 // @brief Sums up the Ibus contribution of each motor and updates the
@@ -752,8 +740,8 @@ void start_analog_thread()
 
 void HAL_SPI_TxRxCpltCallback(SPI_HandleTypeDef *hspi)
 {
-    if(hspi->pRxBuffPtr == (uint8_t*)axes[0]->encoder_.abs_spi_dma_rx_)
-        axes[0]->encoder_.abs_spi_cb();
-    else if (hspi->pRxBuffPtr == (uint8_t*)axes[1]->encoder_.abs_spi_dma_rx_)
-        axes[1]->encoder_.abs_spi_cb();
+    int axis_num = axis_isr_table.find_spi_transfer(hspi, hspi->pRxBuffPtr,
+            [](size_t i) { return (const void*)axes[i]->encoder_.abs_spi_dma_rx_; });
+    if (axis_num >= 0)
+        axes[axis_num]->encoder_.abs_spi_cb();
 }
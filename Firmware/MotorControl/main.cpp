@@ -21,6 +21,9 @@ SystemStats_t system_stats_ = { 0 };
 
 Axis *axes[AXIS_COUNT];
 
+CalibrationStore calibration_store(NVM_calib_get_base(), NVM_calib_get_size(),
+                                   NVM_calib_erase, NVM_calib_program);
+
 typedef Config<
     BoardConfig_t,
     Encoder::Config_t[AXIS_COUNT],
@@ -77,6 +80,30 @@ void erase_configuration(void) {
     NVM_erase();
 }
 
+// @brief Saves the anti-cogging maps of all axes that have anti-cogging enabled.
+// The maps are restored automatically at the next boot.
+// Erasing the calibration sector stalls the CPU for up to a few seconds,
+// so this is refused unless all axes are idle.
+// @returns true on success
+bool save_calibration(void) {
+    for (size_t i = 0; i < AXIS_COUNT; ++i) {
+        if (axes[i]->current_state_ != Axis::AXIS_STATE_IDLE)
+            return false;
+    }
+    if (calibration_store.begin_store())
+        return false;
+    for (size_t i = 0; i < AXIS_COUNT; ++i) {
+        Controller::Anticogging_t& anticogging = axes[i]->controller_.anticogging_;
+        if (anticogging.use_anticogging && anticogging.cogging_map.store(calibration_store, i))
+            return false;
+    }
+    return !calibration_store.commit();
+}
+
+void erase_calibration(void) {
+    calibration_store.erase();
+}
+
 void enter_dfu_mode() {
     if ((hw_version_major == 3) && (hw_version_minor >= 5)) {
         __asm volatile ("CPSID I\n\t":::"memory"); // disable interrupts
@@ -119,6 +146,11 @@ int odrive_main(void) {
     // Load persistent configuration (or defaults)
     load_configuration();
 
+    // Start the CPU cycle counter, used by Motor::log_timing()
+    CoreDebug->DEMCR |= CoreDebug_DEMCR_TRCENA_Msk;
+    DWT->CYCCNT = 0;
+    DWT->CTRL |= DWT_CTRL_CYCCNTENA_Msk;
+
 #if HW_VERSION_MAJOR == 3 && HW_VERSION_MINOR >= 3
     if (board_config.enable_i2c_instead_of_can) {
         // Set up the direction GPIO as input
@@ -209,7 +241,6 @@ int odrive_main(void) {
 
     // Start state machine threads. Each thread will go through various calibration
     // procedures and then run the actual controller loops.
-    // TODO: generalize for AXIS_COUNT != 2
     for (size_t i = 0; i < AXIS_COUNT; ++i) {
         axes[i]->start_thread();
     }
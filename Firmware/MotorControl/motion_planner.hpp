@@ -0,0 +1,245 @@
+#ifndef __MOTION_PLANNER_HPP
+#define __MOTION_PLANNER_HPP
+
+#include <stdint.h>
+#include <stddef.h>
+#include <math.h>
+
+// @brief Look-ahead planner for straight line moves of several axes.
+//
+// Each move gets a trapezoidal velocity profile along its path. Instead of
+// stopping at the end of every move, the planner blends consecutive moves.
+// The speed at a junction between two moves is limited by the angle between
+// them (junction deviation, as in grbl) and by the need to be able to stop at
+// the end of the queue. Moves stay in the queue and are replanned as new
+// moves arrive until they are executed: when the queue is full, on flush(),
+// or when the executor calls execute_next() because the consumer of the
+// points runs low. So a stream of short moves only slows down where the path
+// actually turns, and the last move always ends at standstill.
+//
+// Executed moves are emitted as (position, velocity, dt) points, e.g. into
+// PvtTrajectory. The points are placed at the phase boundaries of each
+// trapezoid. Each phase is a quadratic in time, so a cubic Hermite spline
+// through the points reproduces the profile exactly.
+template<size_t kNumAxes, size_t kQueueSize>
+class MotionPlanner {
+public:
+    // @brief Receives one point. Must not return before the point was accepted.
+    typedef void (*emit_fn_t)(const float pos[kNumAxes], const float vel[kNumAxes], float dt);
+
+    struct Limits_t {
+        float vel[kNumAxes];        // [counts/s]
+        float accel[kNumAxes];      // [counts/s^2]
+        float junction_deviation;   // [counts] 0 stops at every corner
+    };
+
+    MotionPlanner(emit_fn_t emit) : emit_(emit) {}
+
+    // @brief Sets the position at which the next move starts.
+    // Only allowed while the queue is empty.
+    void set_position(const float pos[kNumAxes]) {
+        for (size_t i = 0; i < kNumAxes; ++i)
+            end_pos_[i] = pos[i];
+    }
+
+    // @brief Position at the end of the queued moves
+    const float* get_position() const {
+        return end_pos_;
+    }
+
+    size_t get_queue_length() const {
+        return count_;
+    }
+
+    // @brief Queues a straight line move to target. If the queue is full, the
+    // oldest move is executed first.
+    // @param feed_rate: Path speed [counts/s], limited further by the axis limits
+    void add_line(const float target[kNumAxes], float feed_rate, const Limits_t& limits) {
+        Move_t move;
+        float length_sq = 0.0f;
+        for (size_t i = 0; i < kNumAxes; ++i) {
+            move.start[i] = end_pos_[i];
+            move.end[i] = target[i];
+            move.unit[i] = target[i] - end_pos_[i];
+            length_sq += move.unit[i] * move.unit[i];
+        }
+        if (!(length_sq > 0.0f))
+            return;
+        move.length = sqrtf(length_sq);
+
+        move.max_vel = feed_rate > 0.0f ? feed_rate : INFINITY;
+        move.accel = INFINITY;
+        for (size_t i = 0; i < kNumAxes; ++i) {
+            move.unit[i] /= move.length;
+            float share = fabsf(move.unit[i]);
+            if (share > 0.0f) {
+                move.max_vel = fminf(move.max_vel, limits.vel[i] / share);
+                move.accel = fminf(move.accel, limits.accel[i] / share);
+            }
+        }
+        if (!(move.max_vel > 0.0f) || !(move.accel > 0.0f))
+            return;
+
+        if (count_ == kQueueSize)
+            execute_oldest();
+
+        if (count_ == 0) {
+            move.max_entry_vel = 0.0f; // the queue only runs empty when the axes stop
+        } else {
+            const Move_t& prev = at(count_ - 1);
+            move.max_entry_vel = fminf(fminf(prev.max_vel, move.max_vel),
+                    junction_vel(prev, move, limits.junction_deviation));
+        }
+        move.entry_vel = move.max_entry_vel;
+        at(count_++) = move;
+        for (size_t i = 0; i < kNumAxes; ++i)
+            end_pos_[i] = target[i];
+        replan();
+    }
+
+    // @brief Stops at the end of the queued moves and waits there
+    void add_dwell(float duration) {
+        flush();
+        if (duration > 0.0f)
+            emit_(end_pos_, zero_, duration);
+    }
+
+    // @brief Executes all queued moves, ending at standstill
+    void flush() {
+        while (count_)
+            execute_oldest();
+    }
+
+    // @brief Executes the oldest queued move. Its exit speed is fixed from
+    // then on, the moves behind it are still replanned.
+    // @returns false if the queue is empty
+    bool execute_next() {
+        if (!count_)
+            return false;
+        execute_oldest();
+        return true;
+    }
+
+private:
+    struct Move_t {
+        float start[kNumAxes];
+        float end[kNumAxes];
+        float unit[kNumAxes];   // direction
+        float length;           // [counts]
+        float max_vel;          // [counts/s] along the path
+        float accel;            // [counts/s^2] along the path
+        float max_entry_vel;    // [counts/s] junction limit
+        float entry_vel;        // [counts/s] planned
+    };
+
+    Move_t& at(size_t index) {
+        return queue_[(head_ + index) % kQueueSize];
+    }
+
+    // @brief Maximum speed through the corner between two moves, such that the
+    // centripetal acceleration of an arc that deviates from the corner by at
+    // most junction_deviation stays within the acceleration limit.
+    static float junction_vel(const Move_t& prev, const Move_t& next, float junction_deviation) {
+        float cos_theta = 0.0f; // cosine of the angle between the reversed previous and the next direction
+        for (size_t i = 0; i < kNumAxes; ++i)
+            cos_theta -= prev.unit[i] * next.unit[i];
+        if (cos_theta > 0.999999f)
+            return 0.0f; // reversal
+        if (cos_theta < -0.999999f)
+            return INFINITY; // straight line
+        float sin_theta_d2 = sqrtf(0.5f * (1.0f - cos_theta));
+        float accel = fminf(prev.accel, next.accel);
+        return sqrtf(accel * junction_deviation * sin_theta_d2 / (1.0f - sin_theta_d2));
+    }
+
+    // @brief Recomputes the junction speeds. The entry speed of the oldest
+    // move is fixed because the previous move was already executed.
+    void replan() {
+        // backward pass: the last move must be able to stop
+        float exit_vel = 0.0f;
+        for (size_t k = count_ - 1; k > 0; --k) {
+            Move_t& move = at(k);
+            move.entry_vel = fminf(move.max_entry_vel,
+                    sqrtf(exit_vel * exit_vel + 2.0f * move.accel * move.length));
+            exit_vel = move.entry_vel;
+        }
+        // forward pass: don't plan more than each move can accelerate
+        for (size_t k = 1; k < count_; ++k) {
+            const Move_t& prev = at(k - 1);
+            Move_t& move = at(k);
+            move.entry_vel = fminf(move.entry_vel,
+                    sqrtf(prev.entry_vel * prev.entry_vel + 2.0f * prev.accel * prev.length));
+        }
+    }
+
+    void execute_oldest() {
+        const Move_t& move = at(0);
+        float exit_vel = 0.0f;
+        float exit_dir[kNumAxes];
+        for (size_t i = 0; i < kNumAxes; ++i)
+            exit_dir[i] = move.unit[i];
+        if (count_ > 1) {
+            // Pass the junction along the bisector of both directions. The
+            // interpolation then rounds off the corner over both adjacent moves.
+            const Move_t& next = at(1);
+            exit_vel = next.entry_vel;
+            float norm_sq = 0.0f;
+            for (size_t i = 0; i < kNumAxes; ++i) {
+                exit_dir[i] += next.unit[i];
+                norm_sq += exit_dir[i] * exit_dir[i];
+            }
+            float inv_norm = norm_sq > 0.0f ? 1.0f / sqrtf(norm_sq) : 0.0f;
+            for (size_t i = 0; i < kNumAxes; ++i)
+                exit_dir[i] *= inv_norm;
+        }
+        emit_move(move, move.entry_vel, exit_vel, exit_dir);
+        head_ = (head_ + 1) % kQueueSize;
+        --count_;
+    }
+
+    // @brief Emits the trapezoidal profile of a move as up to three points
+    // @param exit_dir: Direction of the velocity at the end of the move
+    void emit_move(const Move_t& move, float vi, float vf, const float exit_dir[kNumAxes]) {
+        const float a = move.accel;
+        const float L = move.length;
+        float vp = move.max_vel;
+        float d_accel = (vp * vp - vi * vi) / (2.0f * a);
+        float d_decel = (vp * vp - vf * vf) / (2.0f * a);
+        if (d_accel + d_decel > L) {
+            // no cruise phase
+            vp = sqrtf(a * L + 0.5f * (vi * vi + vf * vf));
+            vp = fmaxf(vp, fmaxf(vi, vf));
+            d_accel = (vp * vp - vi * vi) / (2.0f * a);
+            d_decel = (vp * vp - vf * vf) / (2.0f * a);
+        }
+        float d_cruise = fmaxf(L - d_accel - d_decel, 0.0f);
+
+        const float t[3] = { (vp - vi) / a, d_cruise / vp, (vp - vf) / a };
+        const float dist[3] = { d_accel, d_accel + d_cruise, L };
+        const float v[3] = { vp, vp, vf };
+        size_t last = 2;
+        while (last > 0 && !(t[last] > 0.0f))
+            --last;
+        for (size_t k = 0; k <= last; ++k) {
+            if (!(t[k] > 0.0f))
+                continue;
+            float pos[kNumAxes];
+            float vel[kNumAxes];
+            for (size_t i = 0; i < kNumAxes; ++i) {
+                // the last point is exactly at the target, so rounding errors don't add up
+                pos[i] = (k == last) ? move.end[i] : move.start[i] + dist[k] * move.unit[i];
+                vel[i] = v[k] * ((k == last) ? exit_dir[i] : move.unit[i]);
+            }
+            emit_(pos, vel, t[k]);
+        }
+    }
+
+    emit_fn_t emit_;
+    Move_t queue_[kQueueSize];
+    size_t head_ = 0;
+    size_t count_ = 0;
+    float end_pos_[kNumAxes] = {};
+    const float zero_[kNumAxes] = {};
+};
+
+#endif // __MOTION_PLANNER_HPP
@@ -54,7 +54,6 @@ void Motor::reset_current_control() {
 
 // @brief Tune the current controller based on phase resistance and inductance
 // This should be invoked whenever one of these values changes.
-// TODO: allow update on user-request or update automatically via hooks
 void Motor::update_current_controller_gains() {
     // Calculate current control gains
     current_control_.p_gain = config_.current_control_bandwidth * config_.phase_inductance;
@@ -62,6 +61,12 @@ void Motor::update_current_controller_gains() {
     current_control_.i_gain = plant_pole * current_control_.p_gain;
 }
 
+// @brief Updates the values in other components that depend on the pole pair count.
+// This should be invoked whenever config_.pole_pairs changes.
+void Motor::update_pole_pairs() {
+    axis_->encoder_.update_cpr_params();
+}
+
 // @brief Set up the gate drivers
 void Motor::DRV8301_setup() {
     // for reference:
@@ -98,6 +103,7 @@ void Motor::DRV8301_setup() {
 
     // Values for current controller
     phase_current_rev_gain_ = 1.0f / gain_snap_down->first;
+    update_current_sense_scale();
     // Clip all current control to actual usable range
     current_control_.max_allowed_current = max_unity_gain_current * phase_current_rev_gain_;
     // Set trip level
@@ -120,13 +126,16 @@ void Motor::DRV8301_setup() {
 }
 
 // @brief Checks if the gate driver is in operational state.
+// @param read_fault: Also read the fault code over SPI on a fault. The
+//        transfer blocks, so the interrupt handlers pass false and leave it
+//        to read_DRV_fault() in the axis thread.
 // @returns: true if the gate driver is OK (no fault), false otherwise
-bool Motor::check_DRV_fault() {
+bool Motor::check_DRV_fault(bool read_fault) {
     //TODO: make this pin configurable per motor ch
     GPIO_PinState nFAULT_state = HAL_GPIO_ReadPin(gate_driver_config_.nFAULT_port, gate_driver_config_.nFAULT_pin);
     if (nFAULT_state == GPIO_PIN_RESET) {
-        // Update DRV Fault Code
-        drv_fault_ = DRV8301_getFaultType(&gate_driver_);
+        if (read_fault)
+            read_DRV_fault();
         // Update/Cache all SPI device registers
         // DRV_SPI_8301_Vars_t* local_regs = &gate_driver_regs_;
         // local_regs->RcvCmd = true;
@@ -136,6 +145,11 @@ bool Motor::check_DRV_fault() {
     return true;
 }
 
+// @brief Updates the DRV fault code. Blocks on an SPI transfer.
+void Motor::read_DRV_fault() {
+    drv_fault_ = DRV8301_getFaultType(&gate_driver_);
+}
+
 void Motor::set_error(Motor::Error_t error){
     error_ |= error;
     axis_->error_ |= Axis::ERROR_MOTOR_FAILED;
@@ -164,8 +178,9 @@ bool Motor::update_thermal_limits() {
     return true;
 }
 
-bool Motor::do_checks() {
-    if (!check_DRV_fault()) {
+// @param in_isr: Called from an interrupt, see check_DRV_fault()
+bool Motor::do_checks(bool in_isr) {
+    if (!check_DRV_fault(!in_isr)) {
         set_error(ERROR_DRV_FAULT);
         return false;
     }
@@ -191,21 +206,88 @@ float Motor::effective_current_lim() {
     return current_lim;
 }
 
+// @brief Records how far into the control period [CPU cycles] the given point was reached.
+// The time is taken from the DWT cycle counter. TIM13 runs in sync with the
+// control period, so the ADC callbacks use it to align the cycle counter
+// with the start of the period. If a later point is only reached after the
+// period ended, its timing exceeds the period instead of wrapping around.
 void Motor::log_timing(TimingLog_t log_idx) {
-    static const uint16_t clocks_per_cnt = (uint16_t)((float)TIM_1_8_CLOCK_HZ / (float)TIM_APB1_CLOCK_HZ);
-    uint16_t timing = clocks_per_cnt * htim13.Instance->CNT; // TODO: Use a hw_config
+    static constexpr uint32_t clocks_per_cnt = (uint32_t)((float)TIM_1_8_CLOCK_HZ / (float)TIM_APB1_CLOCK_HZ);
+    uint32_t now = DWT->CYCCNT;
+    if (log_idx == TIMING_LOG_ADC_CB_I || log_idx == TIMING_LOG_ADC_CB_DC)
+        timing_period_start_ = now - clocks_per_cnt * htim13.Instance->CNT; // TODO: Use a hw_config
+    uint32_t timing = now - timing_period_start_;
 
     if (log_idx < TIMING_LOG_NUM_SLOTS) {
-        timing_log_[log_idx] = timing;
+        timing_log_[log_idx] = (uint16_t)std::min(timing, (uint32_t)UINT16_MAX);
+        timing_stats_[log_idx].record(timing);
     }
 }
 
-float Motor::phase_current_from_adcval(uint32_t ADCValue) {
-    int adcval_bal = (int)ADCValue - (1 << 11);
-    float amp_out_volt = (3.3f / (float)(1 << 12)) * (float)adcval_bal;
-    float shunt_volt = amp_out_volt * phase_current_rev_gain_;
-    float current = shunt_volt * hw_config_.shunt_conductance;
-    return current;
+uint32_t Motor::get_timing_min(uint32_t log_idx) {
+    return log_idx < TIMING_LOG_NUM_SLOTS ? timing_stats_[log_idx].min_ : 0;
+}
+
+uint32_t Motor::get_timing_max(uint32_t log_idx) {
+    return log_idx < TIMING_LOG_NUM_SLOTS ? timing_stats_[log_idx].max_ : 0;
+}
+
+uint32_t Motor::get_timing_mean(uint32_t log_idx) {
+    return log_idx < TIMING_LOG_NUM_SLOTS ? timing_stats_[log_idx].get_mean() : 0;
+}
+
+uint32_t Motor::get_timing_count(uint32_t log_idx) {
+    return log_idx < TIMING_LOG_NUM_SLOTS ? timing_stats_[log_idx].count_ : 0;
+}
+
+uint32_t Motor::get_timing_histogram(uint32_t log_idx, uint32_t bucket) {
+    return log_idx < TIMING_LOG_NUM_SLOTS ? timing_stats_[log_idx].get_bucket_count(bucket) : 0;
+}
+
+uint32_t Motor::get_timing_bucket_lower_bound(uint32_t bucket) {
+    return TimingStats::get_bucket_lower_bound(bucket);
+}
+
+void Motor::reset_timing_stats() {
+    // the slots are recorded in interrupts and the control loop thread
+    uint32_t mask = cpu_enter_critical();
+    for (size_t i = 0; i < TIMING_LOG_NUM_SLOTS; ++i)
+        timing_stats_[i].reset();
+    cpu_exit_critical(mask);
+}
+
+// @brief Records how long before the deadline the timings that are being
+// loaded were enqueued. Called from the interrupt that loads them.
+void Motor::log_deadline_slack() {
+    uint32_t slack = DWT->CYCCNT - next_timings_cycles_;
+    deadline_slack_.record(slack);
+    if (slack < config_.deadline_slack_warning)
+        ++deadline_slack_warning_count_;
+}
+
+uint32_t Motor::get_deadline_slack_mean() {
+    return deadline_slack_.get_mean();
+}
+
+uint32_t Motor::get_deadline_slack_histogram(uint32_t bucket) {
+    return deadline_slack_.get_bucket_count(bucket);
+}
+
+void Motor::reset_deadline_slack() {
+    // recorded in the interrupt that loads the timings
+    uint32_t mask = cpu_enter_critical();
+    deadline_slack_.reset();
+    deadline_slack_warning_count_ = 0;
+    cpu_exit_critical(mask);
+}
+
+// @brief Folds the ADC resolution, the shunt amplifier gain and the shunt
+// conductance into the scale and offset of phase_current_from_adcval().
+// This should be invoked whenever phase_current_rev_gain changes.
+void Motor::update_current_sense_scale() {
+    // The amplifier output is centered at half the ADC range
+    adc_to_amps_scale_ = (3.3f / (float)(1 << 12)) * phase_current_rev_gain_ * hw_config_.shunt_conductance;
+    adc_to_amps_offset_ = -(float)(1 << 11) * adc_to_amps_scale_;
 }
 
 //--------------------------------
@@ -308,6 +390,7 @@ bool Motor::enqueue_modulation_timings(float mod_alpha, float mod_beta) {
     next_timings_[0] = (uint16_t)(tA * (float)TIM_1_8_PERIOD_CLOCKS);
     next_timings_[1] = (uint16_t)(tB * (float)TIM_1_8_PERIOD_CLOCKS);
     next_timings_[2] = (uint16_t)(tC * (float)TIM_1_8_PERIOD_CLOCKS);
+    next_timings_cycles_ = DWT->CYCCNT;
     next_timings_valid_ = true;
     return true;
 }
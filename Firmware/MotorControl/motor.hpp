@@ -71,6 +71,7 @@ public:
         float current_control_bandwidth = 1000.0f;  // [rad/s]
         float inverter_temp_limit_lower = 100;
         float inverter_temp_limit_upper = 120;
+        uint32_t deadline_slack_warning = 2100; // [cycles] 10% of the control period at 168 MHz
     };
 
     enum TimingLog_t {
@@ -83,6 +84,9 @@ public:
         TIMING_LOG_IDX_SEARCH,
         TIMING_LOG_FOC_VOLTAGE,
         TIMING_LOG_FOC_CURRENT,
+        TIMING_LOG_ENCODER,
+        TIMING_LOG_SENSORLESS,
+        TIMING_LOG_CONTROLLER,
         TIMING_LOG_NUM_SLOTS
     };
 
@@ -105,15 +109,33 @@ public:
     void reset_current_control();
 
     void update_current_controller_gains();
+    void update_current_sense_scale();
+    void update_pole_pairs();
     void DRV8301_setup();
-    bool check_DRV_fault();
+    bool check_DRV_fault(bool read_fault);
+    void read_DRV_fault();
     void set_error(Error_t error);
-    bool do_checks();
+    bool do_checks(bool in_isr);
     float get_inverter_temp();
     bool update_thermal_limits();
     float effective_current_lim();
     void log_timing(TimingLog_t log_idx);
-    float phase_current_from_adcval(uint32_t ADCValue);
+    uint32_t get_timing_min(uint32_t log_idx);
+    uint32_t get_timing_max(uint32_t log_idx);
+    uint32_t get_timing_mean(uint32_t log_idx);
+    uint32_t get_timing_count(uint32_t log_idx);
+    uint32_t get_timing_histogram(uint32_t log_idx, uint32_t bucket);
+    uint32_t get_timing_bucket_lower_bound(uint32_t bucket);
+    void reset_timing_stats();
+    void log_deadline_slack();
+    uint32_t get_deadline_slack_mean();
+    uint32_t get_deadline_slack_histogram(uint32_t bucket);
+    void reset_deadline_slack();
+    // @brief Converts a phase current ADC reading to [A], called in the
+    // current measurement interrupt
+    float phase_current_from_adcval(uint32_t ADCValue) {
+        return (float)ADCValue * adc_to_amps_scale_ + adc_to_amps_offset_;
+    }
     bool measure_phase_resistance(float test_current, float max_voltage);
     bool measure_phase_inductance(float voltage_low, float voltage_high);
     bool run_calibration();
@@ -137,9 +159,14 @@ public:
         TIM_1_8_PERIOD_CLOCKS / 2
     };
     bool next_timings_valid_ = false;
+    uint32_t next_timings_cycles_ = 0;  // [cycles] DWT->CYCCNT when next_timings_ were enqueued
     uint16_t last_cpu_time_ = 0;
     int timing_log_index_ = 0;
     uint16_t timing_log_[TIMING_LOG_NUM_SLOTS] = { 0 };
+    TimingStats timing_stats_[TIMING_LOG_NUM_SLOTS];
+    uint32_t timing_period_start_ = 0; // [cycles] DWT->CYCCNT at the start of the control period
+    TimingStats deadline_slack_;        // [cycles] from enqueuing the timings until they are loaded
+    uint32_t deadline_slack_warning_count_ = 0;
 
     // variables exposed on protocol
     Error_t error_ = ERROR_NONE;
@@ -150,6 +177,8 @@ public:
     Iph_BC_t current_meas_ = {0.0f, 0.0f};
     Iph_BC_t DC_calib_ = {0.0f, 0.0f};
     float phase_current_rev_gain_ = 0.0f; // Reverse gain for ADC to Amps (to be set by DRV8301_setup)
+    float adc_to_amps_scale_ = 0.0f;    // [A/LSB] derived from phase_current_rev_gain_ by update_current_sense_scale
+    float adc_to_amps_offset_ = 0.0f;   // [A]
     CurrentControl_t current_control_ = {
         .p_gain = 0.0f,        // [V/A] should be auto set after resistance and inductance measurement
         .i_gain = 0.0f,        // [V/As] should be auto set after resistance and inductance measurement
@@ -177,7 +206,8 @@ public:
             make_protocol_ro_property("current_meas_phC", &current_meas_.phC),
             make_protocol_property("DC_calib_phB", &DC_calib_.phB),
             make_protocol_property("DC_calib_phC", &DC_calib_.phC),
-            make_protocol_property("phase_current_rev_gain", &phase_current_rev_gain_),
+            make_protocol_property("phase_current_rev_gain", &phase_current_rev_gain_,
+                [](void* ctx) { static_cast<Motor*>(ctx)->update_current_sense_scale(); }, this),
             make_protocol_ro_property("thermal_current_lim", &thermal_current_lim_),
             make_protocol_function("get_inverter_temp", *this, &Motor::get_inverter_temp),
             make_protocol_object("current_control",
@@ -209,20 +239,46 @@ public:
                 make_protocol_ro_property("TIMING_LOG_ENC_CALIB", &timing_log_[TIMING_LOG_ENC_CALIB]),
                 make_protocol_ro_property("TIMING_LOG_IDX_SEARCH", &timing_log_[TIMING_LOG_IDX_SEARCH]),
                 make_protocol_ro_property("TIMING_LOG_FOC_VOLTAGE", &timing_log_[TIMING_LOG_FOC_VOLTAGE]),
-                make_protocol_ro_property("TIMING_LOG_FOC_CURRENT", &timing_log_[TIMING_LOG_FOC_CURRENT])
+                make_protocol_ro_property("TIMING_LOG_FOC_CURRENT", &timing_log_[TIMING_LOG_FOC_CURRENT]),
+                make_protocol_ro_property("TIMING_LOG_ENCODER", &timing_log_[TIMING_LOG_ENCODER]),
+                make_protocol_ro_property("TIMING_LOG_SENSORLESS", &timing_log_[TIMING_LOG_SENSORLESS]),
+                make_protocol_ro_property("TIMING_LOG_CONTROLLER", &timing_log_[TIMING_LOG_CONTROLLER])
+            ),
+            make_protocol_object("timing_stats",
+                make_protocol_function("get_min", *this, &Motor::get_timing_min, "slot"),
+                make_protocol_function("get_max", *this, &Motor::get_timing_max, "slot"),
+                make_protocol_function("get_mean", *this, &Motor::get_timing_mean, "slot"),
+                make_protocol_function("get_count", *this, &Motor::get_timing_count, "slot"),
+                make_protocol_function("get_histogram", *this, &Motor::get_timing_histogram, "slot", "bucket"),
+                make_protocol_function("get_bucket_lower_bound", *this, &Motor::get_timing_bucket_lower_bound, "bucket"),
+                make_protocol_function("reset", *this, &Motor::reset_timing_stats)
+            ),
+            make_protocol_object("deadline_slack",
+                make_protocol_ro_property("min", &deadline_slack_.min_),
+                make_protocol_ro_property("max", &deadline_slack_.max_),
+                make_protocol_ro_property("count", &deadline_slack_.count_),
+                make_protocol_ro_property("warning_count", &deadline_slack_warning_count_),
+                make_protocol_function("get_mean", *this, &Motor::get_deadline_slack_mean),
+                make_protocol_function("get_histogram", *this, &Motor::get_deadline_slack_histogram, "bucket"),
+                make_protocol_ro_array("histogram", &deadline_slack_.histogram_),
+                make_protocol_function("reset", *this, &Motor::reset_deadline_slack)
             ),
             make_protocol_object("config",
                 make_protocol_property("pre_calibrated", &config_.pre_calibrated),
-                make_protocol_property("pole_pairs", &config_.pole_pairs),
+                make_protocol_property("pole_pairs", &config_.pole_pairs,
+                    [](void* ctx) { static_cast<Motor*>(ctx)->update_pole_pairs(); }, this),
                 make_protocol_property("calibration_current", &config_.calibration_current),
                 make_protocol_property("resistance_calib_max_voltage", &config_.resistance_calib_max_voltage),
-                make_protocol_property("phase_inductance", &config_.phase_inductance),
-                make_protocol_property("phase_resistance", &config_.phase_resistance),
+                make_protocol_property("phase_inductance", &config_.phase_inductance,
+                    [](void* ctx) { static_cast<Motor*>(ctx)->update_current_controller_gains(); }, this),
+                make_protocol_property("phase_resistance", &config_.phase_resistance,
+                    [](void* ctx) { static_cast<Motor*>(ctx)->update_current_controller_gains(); }, this),
                 make_protocol_property("direction", &config_.direction),
                 make_protocol_property("motor_type", &config_.motor_type),
                 make_protocol_property("current_lim", &config_.current_lim),
                 make_protocol_property("inverter_temp_limit_lower", &config_.inverter_temp_limit_lower),
                 make_protocol_property("inverter_temp_limit_upper", &config_.inverter_temp_limit_upper),
+                make_protocol_property("deadline_slack_warning", &config_.deadline_slack_warning),
                 make_protocol_property("requested_current_range", &config_.requested_current_range),
                 make_protocol_property("current_control_bandwidth", &config_.current_control_bandwidth,
                     [](void* ctx) { static_cast<Motor*>(ctx)->update_current_controller_gains(); }, this)
@@ -6,6 +6,8 @@
 *
 * The STM32F405xx has 12 flash sectors of heterogeneous size. We use the last
 * two sectors for configuration data. These pages have a size of 128kB each.
+* The sector before them holds large calibration artifacts, see NVM_calib_*
+* at the end of this file.
 * Setting any bit in these sectors to 0 is always possible, but setting them
 * to 1 requires erasing the whole sector.
 *
@@ -40,6 +42,8 @@
 
 // refer to page 75 of datasheet:
 // http://www.st.com/content/ccc/resource/technical/document/reference_manual/3d/6d/5a/66/b4/99/40/d4/DM00031020.pdf/files/DM00031020.pdf/jcr:content/translations/en.DM00031020.pdf
+#define FLASH_SECTOR_9_BASE (const volatile uint8_t*)0x80A0000UL
+#define FLASH_SECTOR_9_SIZE 0x20000UL
 #define FLASH_SECTOR_10_BASE (const volatile uint8_t*)0x80C0000UL
 #define FLASH_SECTOR_10_SIZE 0x20000UL
 #define FLASH_SECTOR_11_BASE (const volatile uint8_t*)0x80E0000UL
@@ -79,6 +83,14 @@ sector_t sectors[] = { {
     .data = (uint64_t *)FLASH_SECTOR_11_BASE
 }};
 
+sector_t calib_sector = {
+    .sector_id = FLASH_SECTOR_9,
+    .n_data = FLASH_SECTOR_9_SIZE >> 3,
+    .n_reserved = 0, // no allocation table, the calibration store has its own format
+    .alloc_table = FLASH_SECTOR_9_BASE,
+    .data = (uint64_t *)FLASH_SECTOR_9_BASE
+};
+
 uint8_t read_sector_; // 0 or 1 to indicate which sector to read from and which to write to
 size_t n_staging_area_; // number of 64-bit values that were reserved using NVM_start_write
 size_t n_valid_; // number of 64-bit fields that can be read
@@ -371,6 +383,59 @@ int NVM_commit(void) {
 }
 
 
+// @brief Returns the memory mapped calibration sector
+const uint8_t* NVM_calib_get_base(void) {
+    return (const uint8_t*)calib_sector.data;
+}
+
+// @brief Returns the size of the calibration sector in bytes
+size_t NVM_calib_get_size(void) {
+    return calib_sector.n_data << 3;
+}
+
+// @brief Erases the calibration sector.
+// Note that the CPU stalls on flash reads for the duration of the erase
+// (up to a few seconds), so this should not be called while a motor is running.
+int NVM_calib_erase(void) {
+    return erase(&calib_sector);
+}
+
+// @brief Programs data into the erased part of the calibration sector.
+// @param offset: Offset in bytes from the beginning of the sector
+int NVM_calib_program(size_t offset, const uint8_t *data, size_t length) {
+    if (offset + length > NVM_calib_get_size())
+        return -1;
+    uintptr_t addr = (uintptr_t)calib_sector.data + offset;
+
+    HAL_FLASH_Unlock();
+    HAL_FLASH_ClearError();
+
+    // handle unaligned start
+    for (; (addr & 0x3) && length; ++data, ++addr, --length)
+        if (HAL_FLASH_Program(FLASH_TYPEPROGRAM_BYTE, addr, *data) != HAL_OK)
+            goto fail;
+
+    // write 32-bit values (64-bit doesn't work)
+    for (; length >= 4; data += 4, addr += 4, length -= 4) {
+        uint32_t word;
+        memcpy(&word, data, sizeof(word)); // the source may be unaligned
+        if (HAL_FLASH_Program(FLASH_TYPEPROGRAM_WORD, addr, word) != HAL_OK)
+            goto fail;
+    }
+
+    // handle unaligned end
+    for (; length; ++data, ++addr, --length)
+        if (HAL_FLASH_Program(FLASH_TYPEPROGRAM_BYTE, addr, *data) != HAL_OK)
+            goto fail;
+
+    HAL_FLASH_Lock();
+    return 0;
+fail:
+    HAL_FLASH_Lock();
+    return HAL_FLASH_GetError(); // non-zero
+}
+
+
 #include <cmsis_os.h>
 /** @brief Call this at startup to test/demo the NVM driver
 
@@ -26,6 +26,11 @@ int NVM_write(size_t offset, uint8_t *data, size_t length);
 int NVM_commit(void);
 void NVM_demo(void);
 
+const uint8_t* NVM_calib_get_base(void);
+size_t NVM_calib_get_size(void);
+int NVM_calib_erase(void);
+int NVM_calib_program(size_t offset, const uint8_t *data, size_t length);
+
 #ifdef __cplusplus
 }
 #endif
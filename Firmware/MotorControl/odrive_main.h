@@ -10,6 +10,7 @@
 
 #ifdef __cplusplus
 #include <fibre/protocol.hpp>
+#include "axis_isr_table.hpp"
 extern "C" {
 #endif
 
@@ -33,6 +34,9 @@ extern "C" {
 //default timeout waiting for phase measurement signals
 #define PH_CURRENT_MEAS_TIMEOUT 2 // [ms]
 
+//timeout waiting for the control loop to apply a submitted command
+#define SUBMIT_TIMEOUT 100 // [ms]
+
 //TODO clean this up
 static const float current_meas_period = CURRENT_MEAS_PERIOD;
 static const int current_meas_hz = CURRENT_MEAS_HZ;
@@ -81,6 +85,7 @@ struct BoardConfig_t {
                                                                         //<! This protects against cases in which the power supply fails to dissipate
                                                                         //<! the brake power if the brake resistor is disabled.
                                                                         //<! The default is 26V for the 24V board version and 52V for the 48V board version.
+    float gcode_junction_deviation = 10.0f;  //<! [counts] how far GCode moves may cut corners to keep their speed
     PWMMapping_t pwm_mappings[GPIO_COUNT];
     PWMMapping_t analog_mappings[GPIO_COUNT];
 };
@@ -89,14 +94,14 @@ extern bool user_config_loaded_;
 
 class Axis;
 class Motor;
+class TrapezoidalTrajectory;
 
-constexpr size_t AXIS_COUNT = 2;
 extern Axis *axes[AXIS_COUNT];
 
-// if you use the oscilloscope feature you can bump up this value
-#define OSCILLOSCOPE_SIZE 128
-extern float oscilloscope[OSCILLOSCOPE_SIZE];
-extern size_t oscilloscope_pos;
+// [values] shared by all channels of the oscilloscope
+#define OSCILLOSCOPE_SIZE 4096
+// [bytes] telemetry frames not yet read by the host, must be a power of two
+#define TELEMETRY_BUFFER_SIZE 2048
 
 // TODO: move
 // this is technically not thread-safe but practically it might be
@@ -113,20 +118,47 @@ inline ENUMTYPE operator ~ (ENUMTYPE a) { return static_cast<ENUMTYPE>(~static_c
 // ODrive specific includes
 #include <utils.h>
 #include <low_level.h>
+#include <pll.hpp>
+#include <timingStats.hpp>
+#include <oscilloscope.hpp>
+#include <telemetry.hpp>
+#include <stepCounter.hpp>
 #include <encoder.hpp>
 #include <sensorless_estimator.hpp>
+#include <calibration_store.hpp>
+#include <cogging_map.hpp>
+#include <cogging_sweep.hpp>
+#include <pvtTraj.hpp>
+#include <timedSetpoint.hpp>
+#include <gearing.hpp>
+#include <commandSchedule.hpp>
+#include <setpointMailbox.hpp>
 #include <controller.hpp>
 #include <motor.hpp>
+#include <trajStepper.hpp>
+#include <scurveTraj.hpp>
 #include <trapTraj.hpp>
 #include <axis.hpp>
 #include <communication/communication.h>
 
+// Large calibration artifacts, stored separately from the configuration
+extern CalibrationStore calibration_store;
+
+extern Oscilloscope oscilloscope;
+extern endpoint_ref_t oscilloscope_channels[Oscilloscope::kMaxChannels];
+extern Endpoint* oscilloscope_endpoints[Oscilloscope::kMaxChannels]; // resolved at start
+extern TelemetryStream telemetry;
+extern endpoint_ref_t telemetry_channels[TelemetryEncoder::kMaxChannels];
+extern Endpoint* telemetry_endpoints[TelemetryEncoder::kMaxChannels]; // resolved at start
+
 #endif // __cplusplus
 
 
 // general system functions defined in main.cpp
 void save_configuration(void);
 void erase_configuration(void);
+bool save_calibration(void);
+void erase_calibration(void);
 void enter_dfu_mode(void);
 
 #endif /* __ODRIVE_MAIN_H */
@@ -0,0 +1,192 @@
+#ifndef _OSCILLOSCOPE_H
+#define _OSCILLOSCOPE_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <atomic>
+
+// @brief Records up to kMaxChannels values every few control cycles into a
+// ring buffer and stops a given number of frames after a trigger.
+//
+// A frame holds one value of each channel. The buffer is divided into as
+// many frames as fit, of which config.pre_trigger are kept from before the
+// trigger. The trigger is evaluated on the recorded frames of
+// config.trigger_channel, once enough frames for the pre-trigger part exist:
+//  - TRIGGER_MODE_IMMEDIATE: right away
+//  - TRIGGER_MODE_RISING: the channel crosses trigger_level upwards
+//  - TRIGGER_MODE_FALLING: the channel crosses trigger_level downwards
+//  - TRIGGER_MODE_NONZERO: the channel changes from zero to non-zero, for
+//    example an error property
+// force_trigger() triggers at the next frame regardless of the mode.
+//
+// update() runs in the control loop interrupt, the other functions in the
+// communication thread. The configuration is copied by start() and must not
+// be changed while a capture is running.
+//
+// The device time of the trigger frame is kept in trigger_time_us_. Frame n
+// of get_value() was recorded (n - pre_trigger) * frame_period_ after it.
+class Oscilloscope {
+public:
+    static constexpr uint32_t kMaxChannels = 8;
+
+    enum State_t {
+        STATE_IDLE,
+        STATE_ARMED,        // recording, waiting for the trigger
+        STATE_TRIGGERED,    // recording the frames after the trigger
+        STATE_DONE,
+    };
+
+    enum TriggerMode_t {
+        TRIGGER_MODE_IMMEDIATE,
+        TRIGGER_MODE_RISING,
+        TRIGGER_MODE_FALLING,
+        TRIGGER_MODE_NONZERO,
+    };
+
+    struct Config_t {
+        uint32_t n_channels = 1;
+        uint32_t decimation = 1;        // record every n-th control cycle
+        uint32_t pre_trigger = 0;       // [frames] recorded before the trigger
+        uint32_t trigger_channel = 0;
+        TriggerMode_t trigger_mode = TRIGGER_MODE_IMMEDIATE;
+        float trigger_level = 0.0f;
+    };
+
+    // @param control_period: Time between two update() calls [s]
+    Oscilloscope(float* buffer, size_t size, float control_period)
+        : buffer_(buffer), size_(size), control_period_(control_period) {}
+
+    // @brief Starts a new capture with the current configuration
+    // @returns false if the configuration is invalid
+    bool start() {
+        stop();
+        if (config_.n_channels < 1 || config_.n_channels > kMaxChannels
+                || config_.trigger_channel >= config_.n_channels || config_.decimation < 1)
+            return false;
+        uint32_t n_frames = (uint32_t)(size_ / config_.n_channels);
+        if (config_.pre_trigger >= n_frames)
+            return false;
+        n_channels_ = config_.n_channels;
+        n_frames_ = n_frames;
+        active_config_ = config_;
+        frame_period_ = (float)config_.decimation * control_period_;
+        trigger_time_us_ = 0;
+        cycle_ = config_.decimation - 1; // record in the first cycle
+        write_frame_ = 0;
+        frames_recorded_ = 0;
+        remaining_ = 0;
+        trigger_frame_ = 0;
+        force_trigger_ = false;
+        // everything above must be written before update() sees the new state
+        std::atomic_signal_fence(std::memory_order_seq_cst);
+        state_ = STATE_ARMED;
+        return true;
+    }
+
+    void stop() {
+        state_ = STATE_IDLE;
+        std::atomic_signal_fence(std::memory_order_seq_cst);
+    }
+
+    void force_trigger() {
+        force_trigger_ = true;
+    }
+
+    // @brief Called once per control cycle
+    // @param read: Returns the current value of a channel, called with
+    //        0 ... n_channels - 1 in every recorded cycle
+    // @param time_us: Device time of this cycle [us]
+    template<typename TRead>
+    void update(const TRead& read, uint64_t time_us) {
+        State_t state = state_;
+        if (state != STATE_ARMED && state != STATE_TRIGGERED)
+            return;
+        if (++cycle_ < active_config_.decimation)
+            return;
+        cycle_ = 0;
+
+        float* frame = &buffer_[write_frame_ * n_channels_];
+        for (uint32_t i = 0; i < n_channels_; ++i)
+            frame[i] = read(i);
+        if (frames_recorded_ < UINT32_MAX)
+            ++frames_recorded_;
+
+        if (state == STATE_ARMED) {
+            float value = frame[active_config_.trigger_channel];
+            if (frames_recorded_ > active_config_.pre_trigger && (force_trigger_ || is_trigger(value))) {
+                trigger_frame_ = write_frame_;
+                trigger_time_us_ = time_us;
+                remaining_ = n_frames_ - active_config_.pre_trigger - 1;
+                state = remaining_ ? STATE_TRIGGERED : STATE_DONE;
+            }
+            prev_value_ = value;
+        } else if (--remaining_ == 0) {
+            state = STATE_DONE;
+        }
+
+        write_frame_ = (write_frame_ + 1 == n_frames_) ? 0 : write_frame_ + 1;
+        state_ = state;
+    }
+
+    // @brief Number of frames of the last capture
+    uint32_t get_frame_count() {
+        return n_frames_;
+    }
+
+    // @brief Number of channels of the last capture
+    uint32_t get_channel_count() {
+        return n_channels_;
+    }
+
+    // @brief Position of the oldest frame of the capture in the buffer. The
+    // frames continue from there to the end of the buffer and wrap around.
+    uint32_t get_first_frame() {
+        if (!n_frames_)
+            return 0;
+        return (trigger_frame_ + n_frames_ - active_config_.pre_trigger) % n_frames_;
+    }
+
+    // @brief Value of a capture in chronological order. The trigger is at
+    // frame config.pre_trigger.
+    float get_value(uint32_t frame, uint32_t channel) {
+        if (frame >= n_frames_ || channel >= n_channels_)
+            return 0.0f;
+        uint32_t index = (get_first_frame() + frame) % n_frames_;
+        return buffer_[index * n_channels_ + channel];
+    }
+
+    Config_t config_;
+    State_t state_ = STATE_IDLE;
+    uint64_t trigger_time_us_ = 0;  // [us] device time of the trigger frame
+    float frame_period_ = 0.0f;     // [s] time between two frames of the capture
+
+private:
+    bool is_trigger(float value) {
+        if (frames_recorded_ < 2 && active_config_.trigger_mode != TRIGGER_MODE_IMMEDIATE)
+            return false; // no previous value yet
+        float level = active_config_.trigger_level;
+        switch (active_config_.trigger_mode) {
+            case TRIGGER_MODE_IMMEDIATE: return true;
+            case TRIGGER_MODE_RISING: return prev_value_ < level && value >= level;
+            case TRIGGER_MODE_FALLING: return prev_value_ > level && value <= level;
+            case TRIGGER_MODE_NONZERO: return prev_value_ == 0.0f && value != 0.0f;
+        }
+        return false;
+    }
+
+    float* buffer_;
+    size_t size_;
+    float control_period_;      // [s]
+    Config_t active_config_;    // copy of config_ at start()
+    uint32_t n_channels_ = 0;
+    uint32_t n_frames_ = 0;
+    uint32_t cycle_ = 0;
+    uint32_t write_frame_ = 0;
+    uint32_t frames_recorded_ = 0;
+    uint32_t remaining_ = 0;    // frames left to record after the trigger
+    uint32_t trigger_frame_ = 0;
+    float prev_value_ = 0.0f;
+    volatile bool force_trigger_ = false;
+};
+
+#endif
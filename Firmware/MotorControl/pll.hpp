@@ -0,0 +1,206 @@
+#ifndef __PLL_HPP
+#define __PLL_HPP
+
+#include <stdint.h>
+#include <stddef.h>
+#include <math.h>
+
+#include "utils.h"
+
+// Number of fractional bits of the FixedPointPll phase
+#define PLL_FIXED_FRAC_BITS 16
+
+// @brief Gains of a critically damped second order PLL.
+//
+// The products with the sample period are cached as well, so the PLL update
+// doesn't redo any of this work. Recompute by calling set_bandwidth whenever
+// the bandwidth changes (typically from a protocol property hook).
+struct PllGains {
+    float kp = 0.0f;    // [1/s]
+    float ki = 0.0f;    // [1/s^2]
+    float kp_dt = 0.0f; // [1]
+    float ki_dt = 0.0f; // [1/s]
+    int32_t kp_dt_fixed = 0; // kp_dt with PLL_FIXED_FRAC_BITS fractional bits
+
+    // @brief Computes the gains for the given bandwidth [rad/s] and sample period [s]
+    // @returns false if the discrete time approximation is unstable with these gains
+    bool set_bandwidth(float bandwidth, float dt) {
+        kp = 2.0f * bandwidth;  // basic conversion to discrete time
+        ki = 0.25f * (kp * kp); // Critically damped
+        kp_dt = kp * dt;
+        ki_dt = ki * dt;
+        kp_dt_fixed = (int32_t)(kp_dt * (float)(1 << PLL_FIXED_FRAC_BITS) + 0.5f);
+        // Check that we don't get problems with discrete time approximation
+        return kp_dt < 1.0f; // Funny polarity to also catch NaN
+    }
+};
+
+// Wrap policies for Pll<TPhase, TWrap>:
+// wrap_phase() maps a phase onto its canonical range,
+// wrap_delta() maps a phase error onto the range centered around zero.
+
+// @brief Unbounded phase, e.g. linear position
+struct PllWrapNone {
+    float wrap_phase(float phase) const { return phase; }
+    float wrap_delta(float delta) const { return delta; }
+};
+
+// @brief Angle in [-pi, pi)
+struct PllWrapPmPi {
+    float wrap_phase(float phase) const { return wrap_pm_pi(phase); }
+    float wrap_delta(float delta) const { return wrap_pm_pi(delta); }
+};
+
+// @brief Phase in [0, range), e.g. encoder counts in [0, cpr)
+struct PllWrapRange {
+    float range_ = 1.0f;
+    float half_range_ = 0.5f;
+
+    void set_range(float range) {
+        range_ = range;
+        half_range_ = 0.5f * range;
+    }
+    float wrap_phase(float phase) const { return fmodf_pos(phase, range_); }
+    float wrap_delta(float delta) const { return wrap_pm(delta, half_range_); }
+};
+
+// @brief Second order phase locked loop.
+//
+// One iteration consists of predict(), followed by the owner's phase detector
+// (measured phase minus phase_) and correct() with its output.
+// The phase is only wrapped in correct(), so the predicted phase may
+// temporarily lie slightly outside the canonical range.
+//
+// @tparam TPhase: Type of the phase state and the phase error
+// @tparam TWrap: Wrap policy, see above
+template<typename TPhase, typename TWrap>
+class Pll {
+public:
+    // @brief Advances the phase by one sample period at the PLL's own velocity
+    void predict(float dt) {
+        phase_ += static_cast<TPhase>(dt * vel_);
+    }
+
+    // @brief Advances the phase by one sample period at an externally supplied velocity.
+    // Use this together with correct_phase() for a phase that follows another PLL.
+    void predict(float dt, float vel) {
+        phase_ += static_cast<TPhase>(dt * vel);
+    }
+
+    // @brief Applies the phase error to both the phase and the velocity.
+    // @returns The wrapped phase error
+    TPhase correct(TPhase delta, const PllGains& gains) {
+        delta = wrap_.wrap_delta(delta);
+        phase_ = wrap_.wrap_phase(phase_ + gains.kp_dt * delta);
+        vel_ += gains.ki_dt * delta;
+        return delta;
+    }
+
+    // @brief Applies the phase error to the phase only.
+    // @returns The wrapped phase error
+    TPhase correct_phase(TPhase delta, const PllGains& gains) {
+        delta = wrap_.wrap_delta(delta);
+        phase_ = wrap_.wrap_phase(phase_ + gains.kp_dt * delta);
+        return delta;
+    }
+
+    TPhase phase_ = 0;
+    float vel_ = 0.0f;
+    TWrap wrap_;
+};
+
+// @brief Second order phase locked loop on integer counts with a fixed point phase.
+//
+// Same loop as Pll<>, but the phase is a 64-bit integer with
+// PLL_FIXED_FRAC_BITS fractional bits. Unlike a float, its resolution does
+// not degrade with distance (a float stops resolving single counts
+// beyond 2^24), and it takes 2^47 counts to overflow.
+//
+// The phase detector is exact integer arithmetic: the difference between
+// the measured count and the integer part of the phase is taken modulo 2^32,
+// so the measured count may be a wrapping int32_t.
+// If a range is set, the phase is kept in [0, range) by exact integer
+// additions/subtractions instead of fmodf.
+class FixedPointPll {
+public:
+    static constexpr int64_t kOne = (int64_t)1 << PLL_FIXED_FRAC_BITS;
+
+    // @brief Keeps the phase in [0, range) counts. 0 means unbounded.
+    // Negative ranges are treated as unbounded.
+    void set_range(int32_t range) {
+        if (range < 0)
+            range = 0;
+        range_ = range;
+        range_fixed_ = (int64_t)range * kOne;
+        wrap();
+    }
+
+    // @brief Sets the phase to an integer count, e.g. when the encoder count is set
+    void set_count(int64_t count) {
+        phase_ = count * kOne;
+        wrap();
+    }
+
+    // @brief Advances the phase by one sample period at the PLL's own velocity
+    void predict(float dt) {
+        predict(dt, vel_);
+    }
+
+    // @brief Advances the phase by one sample period at an externally supplied velocity.
+    // Use this together with correct_phase() for a phase that follows another PLL.
+    void predict(float dt, float vel) {
+        phase_ += (int64_t)(dt * vel * (float)kOne);
+        wrap();
+    }
+
+    // @brief Runs the phase detector against the measured count and applies
+    // the error to both the phase and the velocity.
+    // @returns The phase error in counts
+    int32_t correct(int32_t count, const PllGains& gains) {
+        int32_t delta = correct_phase(count, gains);
+        vel_ += gains.ki_dt * (float)delta;
+        return delta;
+    }
+
+    // @brief Runs the phase detector against the measured count and applies
+    // the error to the phase only.
+    // @returns The phase error in counts
+    int32_t correct_phase(int32_t count, const PllGains& gains) {
+        int32_t delta = (int32_t)((uint32_t)count - (uint32_t)get_count());
+        if (range_) {
+            if (delta >= range_ - (range_ >> 1))
+                delta -= range_;
+            else if (delta < -(range_ >> 1))
+                delta += range_;
+        }
+        phase_ += (int64_t)gains.kp_dt_fixed * delta;
+        wrap();
+        return delta;
+    }
+
+    // @brief Integer part of the phase (rounded towards -inf) [count]
+    int64_t get_count() const { return phase_ >> PLL_FIXED_FRAC_BITS; }
+
+    // @brief The phase as float [count]. Loses resolution beyond 2^24 counts.
+    float get_phase() const { return (float)phase_ * (1.0f / (float)kOne); }
+
+    int64_t phase_ = 0;     // [count / 2^PLL_FIXED_FRAC_BITS]
+    float vel_ = 0.0f;      // [count/s]
+
+private:
+    void wrap() {
+        if (range_) {
+            // The phase moves by much less than one range per call, so this
+            // terminates after at most a few iterations.
+            while (phase_ >= range_fixed_)
+                phase_ -= range_fixed_;
+            while (phase_ < 0)
+                phase_ += range_fixed_;
+        }
+    }
+
+    int32_t range_ = 0;         // [count]
+    int64_t range_fixed_ = 0;   // [count / 2^PLL_FIXED_FRAC_BITS]
+};
+
+#endif // __PLL_HPP
@@ -0,0 +1,160 @@
+#ifndef _PVT_TRAJ_H
+#define _PVT_TRAJ_H
+
+#include <stdint.h>
+#include <atomic>
+
+// @brief Streamed trajectory of (position, velocity, time) points.
+//
+// The host queues points with push() ahead of time. Each point is the
+// position and velocity that should be reached dt seconds after the previous
+// point. The control loop calls step() once per cycle, which interpolates
+// between consecutive points with a cubic Hermite spline, so position and
+// velocity are continuous across points.
+//
+// push() and step() may run in different threads: the queue is a single
+// producer, single consumer ring buffer. Several producers must serialize
+// their pushes, see Controller::push_pvt(). start() and clear() belong to
+// the consumer, call them from the thread that calls step().
+//
+// If the queue runs dry, the trajectory holds the last point at zero
+// velocity and continues as soon as new points arrive. Running dry while
+// the last point has a nonzero velocity is an underrun.
+class PvtTrajectory {
+public:
+    static constexpr uint32_t kCapacity = 128; // must be a power of 2
+
+    enum State_t {
+        STATE_IDLE = 0,
+        STATE_RUNNING = 1,
+        STATE_HOLDING = 2, // queue empty, holding the last point
+    };
+
+    struct Point_t {
+        float pos;  // [counts]
+        float vel;  // [counts/s]
+        float dt;   // [s] time since the previous point
+    };
+
+    struct Step_t {
+        float Y;
+        float Yd;
+        float Ydd;
+    };
+
+    // @brief Queues a point. Called by the producer.
+    // @returns false if the queue is full or dt is not positive
+    bool push(float pos, float vel, float dt) {
+        if (!(dt > 0.0f))
+            return false;
+        uint32_t head = head_.load(std::memory_order_relaxed);
+        if (head - tail_.load(std::memory_order_acquire) >= kCapacity)
+            return false;
+        points_[head & (kCapacity - 1)] = { .pos = pos, .vel = vel, .dt = dt };
+        head_.store(head + 1, std::memory_order_release);
+        return true;
+    }
+
+    // @brief Number of queued points
+    uint32_t get_level() {
+        return head_.load(std::memory_order_acquire) - tail_.load(std::memory_order_acquire);
+    }
+
+    // @brief Playback time of the queued points, without the remaining time
+    // of the segment being played. Called by the producer.
+    float get_queued_duration() {
+        uint32_t head = head_.load(std::memory_order_relaxed);
+        float duration = 0.0f;
+        // only the producer overwrites points, so the consumer can't change them under us
+        for (uint32_t i = tail_.load(std::memory_order_acquire); i != head; ++i)
+            duration += points_[i & (kCapacity - 1)].dt;
+        return duration;
+    }
+
+    // @brief Drops all queued points and stops playback
+    void clear() {
+        tail_.store(head_.load(std::memory_order_acquire), std::memory_order_release);
+        state_ = STATE_IDLE;
+    }
+
+    // @brief Starts playback from the given position and velocity.
+    // The first queued point is reached dt after the start.
+    void start(float pos, float vel) {
+        set_segment(pos, vel, pos, vel, 0.0f);
+        t_ = 0.0f;
+        min_level_ = get_level();
+        state_ = STATE_RUNNING;
+    }
+
+    // @brief Advances the trajectory by one control cycle. Called by the consumer.
+    // @returns false if playback was not started
+    bool step(float dt, Step_t* output) {
+        if (state_ == STATE_IDLE)
+            return false;
+
+        t_ += dt;
+        while (t_ >= T_) {
+            uint32_t tail = tail_.load(std::memory_order_relaxed);
+            uint32_t level = head_.load(std::memory_order_acquire) - tail;
+            if (level < min_level_)
+                min_level_ = level;
+            if (level == 0) {
+                if (state_ == STATE_RUNNING && vel1_ != 0.0f)
+                    ++underrun_count_;
+                state_ = STATE_HOLDING;
+                set_segment(pos1_, 0.0f, pos1_, 0.0f, 0.0f);
+                t_ = 0.0f;
+                break;
+            }
+            Point_t point = points_[tail & (kCapacity - 1)];
+            tail_.store(tail + 1, std::memory_order_release);
+            // leftover time of the previous segment carries into the new one
+            t_ = (state_ == STATE_HOLDING) ? 0.0f : t_ - T_;
+            set_segment(pos1_, vel1_, point.pos, point.vel, point.dt);
+            state_ = STATE_RUNNING;
+        }
+
+        const float tau = t_;
+        output->Y   = c_[0] + tau * (c_[1] + tau * (c_[2] + tau * c_[3]));
+        output->Yd  = c_[1] + tau * (2.0f * c_[2] + tau * 3.0f * c_[3]);
+        output->Ydd = 2.0f * c_[2] + tau * 6.0f * c_[3];
+        return true;
+    }
+
+    State_t state_ = STATE_IDLE;
+    uint32_t underrun_count_ = 0;
+    uint32_t min_level_ = 0;    // lowest queue level since start()
+
+private:
+    // @brief Computes the cubic Hermite coefficients of the segment from
+    // (pos0, vel0) to (pos1, vel1) over a duration T.
+    void set_segment(float pos0, float vel0, float pos1, float vel1, float T) {
+        pos1_ = pos1;
+        vel1_ = vel1;
+        T_ = T;
+        c_[0] = pos0;
+        c_[1] = vel0;
+        if (T > 0.0f) {
+            float inv_T = 1.0f / T;
+            float slope = (pos1 - pos0) * inv_T;
+            c_[2] = (3.0f * slope - 2.0f * vel0 - vel1) * inv_T;
+            c_[3] = (vel0 + vel1 - 2.0f * slope) * inv_T * inv_T;
+        } else {
+            c_[2] = 0.0f;
+            c_[3] = 0.0f;
+        }
+    }
+
+    Point_t points_[kCapacity];
+    std::atomic<uint32_t> head_{0}; // written by the producer only (except clear())
+    std::atomic<uint32_t> tail_{0}; // written by the consumer only (except clear())
+
+    // current segment, Y(t) = c[0] + c[1]*t + c[2]*t^2 + c[3]*t^3
+    float c_[4] = { 0.0f, 0.0f, 0.0f, 0.0f };
+    float T_ = 0.0f;    // [s] duration
+    float t_ = 0.0f;    // [s] time since the start of the segment
+    float pos1_ = 0.0f; // end point of the segment
+    float vel1_ = 0.0f;
+};
+
+#endif
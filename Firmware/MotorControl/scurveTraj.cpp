@@ -0,0 +1,157 @@
+#include <math.h>
+#include <algorithm>
+#include "scurveTraj.hpp"
+
+// Symbol                     Description
+// Tj                         Duration of each of the two constant jerk segments of a velocity change
+// Tc                         Duration of the constant acceleration segment of a velocity change
+// Tv                         Duration of the cruise segment
+// s                          Direction (sign) of the trajectory
+// vi, vr, dx                 Initial velocity, reached velocity and displacement in direction s
+// Vmax, Amax, Dmax and Jmax  Kinematic bounds
+
+// @brief Segment durations of a jerk limited velocity change by dv >= 0.
+// If dv is too small to reach the acceleration limit A, the profile is
+// triangular in acceleration and Tc is 0.
+static void velocity_change_times(float dv, float A, float J, float* Tj, float* Tc) {
+    if (dv * J >= A * A) {
+        *Tj = A / J;
+        *Tc = dv / A - *Tj;
+    } else {
+        *Tj = sqrtf(dv / J);
+        *Tc = 0.0f;
+    }
+}
+
+static float velocity_change_duration(float dv, float A, float J) {
+    float Tj, Tc;
+    velocity_change_times(dv, A, J, &Tj, &Tc);
+    return 2.0f * Tj + Tc;
+}
+
+// @brief Displacement of a profile without cruise segment that goes from
+// vi to vr and then to a standstill.
+// The acceleration is point symmetric within each velocity change, so the
+// displacement is simply the mean velocity times the duration.
+static float profile_displacement(float vi, float vr, float A, float D, float J) {
+    return 0.5f * (vi + vr) * velocity_change_duration(fabsf(vr - vi), A, J)
+         + 0.5f * vr * velocity_change_duration(vr, D, J);
+}
+
+bool SCurveTrajectory::plan(float Xf, float Xi, float Vi,
+                            float Vmax, float Amax, float Dmax, float Jmax) {
+    if (!(Vmax > 0.0f && Amax > 0.0f && Dmax > 0.0f && Jmax > 0.0f))
+        return false;
+
+    float dX = Xf - Xi; // Distance to travel
+    float dXstop = 0.5f * Vi * velocity_change_duration(fabsf(Vi), Dmax, Jmax); // Minimum stopping displacement
+    float s = std::signbit(dX - dXstop) ? -1.0f : 1.0f; // Sign of the cruise velocity (if any)
+    float dx = s * dX;
+    float vi = s * Vi;
+
+    float vr = Vmax;
+    float Tv;
+    float dxmin = profile_displacement(vi, vr, Amax, Dmax, Jmax);
+    if (dxmin <= dx) {
+        // Long move: reaches the velocity limit
+        Tv = (dx - dxmin) / vr;
+    } else {
+        // Short move: find the highest velocity that doesn't overshoot.
+        // The displacement grows monotonically with vr above max(vi, 0).
+        float lo = std::max(0.0f, std::min(vi, Vmax));
+        float hi = Vmax;
+        for (int i = 0; i < 24; ++i) {
+            float mid = 0.5f * (lo + hi);
+            if (profile_displacement(vi, mid, Amax, Dmax, Jmax) > dx)
+                hi = mid;
+            else
+                lo = mid;
+        }
+        vr = lo;
+        // cover the remaining bisection error with a short cruise
+        float rest = dx - profile_displacement(vi, vr, Amax, Dmax, Jmax);
+        Tv = (vr > 0.0f && rest > 0.0f) ? rest / vr : 0.0f;
+    }
+
+    Xi_ = Xi;
+    Xf_ = Xf;
+    Vi_ = Vi;
+    n_segments_ = 0;
+    t_ = 0.0f;
+    x_ = Xi;
+    v_ = Vi;
+    a_ = 0.0f;
+
+    // Velocity change to the cruise velocity
+    float Tj, Tc;
+    velocity_change_times(fabsf(vr - vi), Amax, Jmax, &Tj, &Tc);
+    float jerk = (vr >= vi ? s : -s) * Jmax;
+    append_segment(Tj, jerk);
+    append_segment(Tc, 0.0f);
+    append_segment(Tj, -jerk);
+
+    // Cruise. Reset the state to exact values to avoid accumulating rounding errors.
+    v_ = s * vr;
+    a_ = 0.0f;
+    append_segment(Tv, 0.0f);
+
+    // Velocity change to a standstill, anchored at the final position
+    velocity_change_times(vr, Dmax, Jmax, &Tj, &Tc);
+    x_ = Xf - s * 0.5f * vr * (2.0f * Tj + Tc);
+    v_ = s * vr;
+    a_ = 0.0f;
+    append_segment(Tj, -s * Jmax);
+    append_segment(Tc, 0.0f);
+    append_segment(Tj, s * Jmax);
+
+    Tf_ = t_;
+    return true;
+}
+
+// @brief Appends a segment of duration T with constant jerk, starting at the
+// current planning state, and advances the state to the end of the segment.
+void SCurveTrajectory::append_segment(float T, float jerk) {
+    if (!(T > 0.0f))
+        return;
+    Segment_t& seg = segments_[n_segments_++];
+    seg.t0 = t_;
+    seg.c[0] = x_;
+    seg.c[1] = v_;
+    seg.c[2] = 0.5f * a_;
+    seg.c[3] = jerk * (1.0f / 6.0f);
+
+    x_ += T * (seg.c[1] + T * (seg.c[2] + T * seg.c[3]));
+    v_ += T * (a_ + 0.5f * jerk * T);
+    a_ += jerk * T;
+    t_ += T;
+}
+
+SCurveTrajectory::Step_t SCurveTrajectory::eval(float t) const {
+    Step_t trajStep;
+    if (t < 0.0f) {  // Initial Condition
+        trajStep.Y   = Xi_;
+        trajStep.Yd  = Vi_;
+        trajStep.Ydd = 0.0f;
+    } else if (t < Tf_) {
+        size_t i = n_segments_ - 1;
+        while (i > 0 && t < segments_[i].t0)
+            --i;
+        const float* c = segments_[i].c;
+        float tau = t - segments_[i].t0;
+        trajStep.Y   = c[0] + tau * (c[1] + tau * (c[2] + tau * c[3]));
+        trajStep.Yd  = c[1] + tau * (2.0f * c[2] + tau * 3.0f * c[3]);
+        trajStep.Ydd = 2.0f * c[2] + tau * 6.0f * c[3];
+    } else {  // Final Condition
+        trajStep.Y   = Xf_;
+        trajStep.Yd  = 0.0f;
+        trajStep.Ydd = 0.0f;
+    }
+    return trajStep;
+}
+
+void SCurveTrajectory::load(TrajectoryStepper& stepper, float period) const {
+    stepper.begin(period);
+    for (size_t i = 0; i < n_segments_; ++i)
+        stepper.add_segment(segments_[i].t0, segments_[i].c);
+    stepper.finish(Tf_, Xf_);
+}
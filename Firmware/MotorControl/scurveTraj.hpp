@@ -0,0 +1,62 @@
+#ifndef _SCURVE_TRAJ_H
+#define _SCURVE_TRAJ_H
+
+#include <stddef.h>
+
+#include "trajStepper.hpp"
+
+// @brief Jerk limited ("S-curve") point to point trajectory.
+//
+// The profile changes the velocity from the initial velocity to the cruise
+// velocity, cruises, and then changes the velocity to zero. Each velocity
+// change consists of up to three segments of constant jerk (+J, 0, -J),
+// so a profile has at most 7 segments.
+//
+// plan() stores each segment as the coefficients of a cubic in the time since
+// the start of the segment. eval() only needs to find the segment and
+// evaluate one polynomial.
+class SCurveTrajectory {
+public:
+    static constexpr size_t kMaxSegments = 7;
+
+    struct Step_t {
+        float Y;
+        float Yd;
+        float Ydd;
+    };
+
+    // @brief Plans a move from Xi with initial velocity Vi (and zero
+    // acceleration) to a standstill at Xf.
+    // @returns false if any of the limits is not strictly positive
+    bool plan(float Xf, float Xi, float Vi,
+              float Vmax, float Amax, float Dmax, float Jmax);
+    Step_t eval(float t) const;
+    // @brief Loads the planned segments into an incremental evaluator
+    void load(TrajectoryStepper& stepper, float period) const;
+
+    float Tf_ = 0.0f;   // [s] total duration
+
+private:
+    // Y(t) = c[0] + c[1]*tau + c[2]*tau^2 + c[3]*tau^3 with tau = t - t0
+    struct Segment_t {
+        float t0;
+        float c[4];
+    };
+
+    void append_segment(float T, float jerk);
+
+    Segment_t segments_[kMaxSegments];
+    size_t n_segments_ = 0;
+
+    float Xi_ = 0.0f;
+    float Xf_ = 0.0f;
+    float Vi_ = 0.0f;
+
+    // state at the end of the last appended segment, only used while planning
+    float t_ = 0.0f;
+    float x_ = 0.0f;
+    float v_ = 0.0f;
+    float a_ = 0.0f;
+};
+
+#endif
@@ -3,7 +3,26 @@
 
 SensorlessEstimator::SensorlessEstimator(Config_t& config) :
         config_(config)
-    {};
+{
+    update_pll_gains();
+    update_observer_gain();
+}
+
+// @brief Recomputes the PLL gains from config_.pll_bandwidth.
+// Invoked on startup and whenever the bandwidth is written.
+void SensorlessEstimator::update_pll_gains() {
+    // Stability is checked in update() because the estimator has no way
+    // to report errors to the axis from here.
+    pll_gains_.set_bandwidth(config_.pll_bandwidth, current_meas_period);
+}
+
+// @brief Recomputes the observer constants from config_.observer_gain
+// and config_.pm_flux_linkage.
+void SensorlessEstimator::update_observer_gain() {
+    pm_flux_sqr_ = config_.pm_flux_linkage * config_.pm_flux_linkage;
+    float bandwidth_factor = 1.0f / pm_flux_sqr_;
+    observer_eta_gain_ = 0.5f * (config_.observer_gain * bandwidth_factor);
+}
 
 bool SensorlessEstimator::update() {
     // Algorithm based on paper: Sensorless Control of Surface-Mount Permanent-Magnet Synchronous Motors Based on a Nonlinear Observer
@@ -37,10 +56,8 @@ bool SensorlessEstimator::update() {
     }
 
     // Non-linear observer (see paper eqn 8):
-    float pm_flux_sqr = config_.pm_flux_linkage * config_.pm_flux_linkage;
     float est_pm_flux_sqr = eta[0] * eta[0] + eta[1] * eta[1];
-    float bandwidth_factor = 1.0f / pm_flux_sqr;
-    float eta_factor = 0.5f * (config_.observer_gain * bandwidth_factor) * (pm_flux_sqr - est_pm_flux_sqr);
+    float eta_factor = observer_eta_gain_ * (pm_flux_sqr_ - est_pm_flux_sqr);
 
     // alpha-beta vector operations
     for (int i = 0; i <= 1; ++i) {
@@ -57,25 +74,17 @@ bool SensorlessEstimator::update() {
     V_alpha_beta_memory_[1] = axis_->motor_.current_control_.final_v_beta * axis_->motor_.config_.direction;
 
     // PLL
-    // TODO: the PLL part has some code duplication with the encoder PLL
-    // Pll gains as a function of bandwidth
-    float pll_kp = 2.0f * config_.pll_bandwidth;
-    // Critically damped
-    float pll_ki = 0.25f * (pll_kp * pll_kp);
     // Check that we don't get problems with discrete time approximation
-    if (!(current_meas_period * pll_kp < 1.0f)) {
+    if (!(pll_gains_.kp_dt < 1.0f)) {
         error_ |= ERROR_UNSTABLE_GAIN;
         return false;
     }
 
     // predict PLL phase with velocity
-    pll_pos_ = wrap_pm_pi(pll_pos_ + current_meas_period * vel_estimate_);
-    // update PLL phase with observer permanent magnet phase
+    pll_.predict(current_meas_period);
+    // update PLL phase and velocity with observer permanent magnet phase
     phase_ = fast_atan2(eta[1], eta[0]);
-    float delta_phase = wrap_pm_pi(phase_ - pll_pos_);
-    pll_pos_ = wrap_pm_pi(pll_pos_ + current_meas_period * pll_kp * delta_phase);
-    // update PLL velocity
-    vel_estimate_ += current_meas_period * pll_ki * delta_phase;
+    pll_.correct(phase_ - pll_pos_, pll_gains_);
 
     return true;
 };
@@ -18,16 +18,21 @@ public:
 
     bool update();
 
+    void update_pll_gains();
+    void update_observer_gain();
+
     Axis* axis_ = nullptr; // set by Axis constructor
     Config_t& config_;
 
     // TODO: expose on protocol
     Error_t error_ = ERROR_NONE;
     float phase_ = 0.0f;                        // [rad]
-    float pll_pos_ = 0.0f;                      // [rad]
-    float vel_estimate_ = 0.0f;                      // [rad/s]
-    // float pll_kp_ = 0.0f;                       // [rad/s / rad]
-    // float pll_ki_ = 0.0f;                       // [(rad/s^2) / rad]
+    Pll<float, PllWrapPmPi> pll_;
+    PllGains pll_gains_;
+    float& pll_pos_ = pll_.phase_;              // [rad]
+    float& vel_estimate_ = pll_.vel_;           // [rad/s]
+    float pm_flux_sqr_ = 0.0f;                  // [(Vs)^2]
+    float observer_eta_gain_ = 0.0f;            // [rad/s / (Vs)^2]
     float flux_state_[2] = {0.0f, 0.0f};        // [Vs]
     float V_alpha_beta_memory_[2] = {0.0f, 0.0f}; // [V]
     bool estimator_good_ = false;
@@ -39,12 +44,15 @@ public:
             make_protocol_property("phase", &phase_),
             make_protocol_property("pll_pos", &pll_pos_),
             make_protocol_property("vel_estimate", &vel_estimate_),
-            // make_protocol_property("pll_kp", &pll_kp_),
-            // make_protocol_property("pll_ki", &pll_ki_),
+            // make_protocol_property("pll_kp", &pll_gains_.kp),
+            // make_protocol_property("pll_ki", &pll_gains_.ki),
             make_protocol_object("config",
-                make_protocol_property("observer_gain", &config_.observer_gain),
-                make_protocol_property("pll_bandwidth", &config_.pll_bandwidth),
-                make_protocol_property("pm_flux_linkage", &config_.pm_flux_linkage)
+                make_protocol_property("observer_gain", &config_.observer_gain,
+                    [](void* ctx) { static_cast<SensorlessEstimator*>(ctx)->update_observer_gain(); }, this),
+                make_protocol_property("pll_bandwidth", &config_.pll_bandwidth,
+                    [](void* ctx) { static_cast<SensorlessEstimator*>(ctx)->update_pll_gains(); }, this),
+                make_protocol_property("pm_flux_linkage", &config_.pm_flux_linkage,
+                    [](void* ctx) { static_cast<SensorlessEstimator*>(ctx)->update_observer_gain(); }, this)
             )
         );
     }
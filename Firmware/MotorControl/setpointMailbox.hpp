@@ -0,0 +1,74 @@
+#ifndef _SETPOINT_MAILBOX_H
+#define _SETPOINT_MAILBOX_H
+
+#include <stdint.h>
+#include <atomic>
+
+// @brief Hands the latest command from the communication threads to the
+// control loop as a whole.
+//
+// The mailbox is a sequence lock: the sequence number is odd while a writer
+// copies a command in, and is advanced to the next even number once the
+// command is complete. The control loop calls fetch() once per cycle, which
+// copies the command out and checks that the sequence number did not change
+// meanwhile, so it never sees a command that is half old and half new.
+//
+// Neither side ever waits for the other: a writer that is preempted by the
+// control loop in the middle of a copy just makes the control loop pick the
+// command up one cycle later. Only the latest command is kept; a command that
+// is overwritten before the control loop fetched it is counted and dropped.
+//
+// Any number of threads may post, a second writer that finds the mailbox
+// busy gets false from try_post() and should try again. There must only be
+// one consumer.
+//
+// @tparam T: Trivially copyable command type
+template<typename T>
+class Mailbox {
+public:
+    // @brief Replaces the command in the mailbox. Called by the writers.
+    // @returns false if another writer is currently posting
+    bool try_post(const T& value) {
+        uint32_t seq = seq_.load(std::memory_order_relaxed);
+        if ((seq & 1) || !seq_.compare_exchange_strong(seq, seq + 1, std::memory_order_relaxed))
+            return false;
+        // the odd sequence number must be visible before the first byte changes
+        std::atomic_thread_fence(std::memory_order_release);
+        value_ = value;
+        ++post_count_;
+        seq_.store(seq + 2, std::memory_order_release);
+        return true;
+    }
+
+    // @brief Takes the command out of the mailbox. Called by the consumer.
+    // @returns false if there is no new command or it is being written right now
+    bool fetch(T* value) {
+        uint32_t seq = seq_.load(std::memory_order_acquire);
+        if (seq == taken_seq_)
+            return false;
+        if (!(seq & 1)) {
+            *value = value_;
+            // the copy must be complete before the sequence number is checked again
+            std::atomic_thread_fence(std::memory_order_acquire);
+            if (seq_.load(std::memory_order_relaxed) == seq) {
+                // every write advances the sequence number by 2
+                dropped_count_ += (seq - taken_seq_) / 2 - 1;
+                taken_seq_ = seq;
+                return true;
+            }
+        }
+        ++busy_count_;
+        return false;
+    }
+
+    uint32_t post_count_ = 0;       // writer side
+    uint32_t dropped_count_ = 0;    // commands replaced before they were fetched, consumer side
+    uint32_t busy_count_ = 0;       // fetches deferred by a write in progress, consumer side
+
+private:
+    T value_ = {};
+    std::atomic<uint32_t> seq_{0};
+    uint32_t taken_seq_ = 0;   // sequence number of the last fetched command, consumer only
+};
+
+#endif
@@ -0,0 +1,56 @@
+#ifndef _STEP_COUNTER_H
+#define _STEP_COUNTER_H
+
+#include <stdint.h>
+
+#include "pll.hpp"
+
+// @brief Counts step/dir pulses and estimates the step rate.
+//
+// The step interrupt only adds or subtracts one from an integer counter.
+// The control loop calls update() once per cycle, which returns the steps
+// since the previous cycle and runs a PLL on the count. The PLL velocity is
+// a smooth estimate of the step rate that can be used as velocity
+// feedforward, even when only a fraction of a step arrives per cycle.
+//
+// count_step() may run in an interrupt while update() runs in the control
+// loop thread: only the interrupt writes count_. reset() must only be called
+// while the interrupt is disabled.
+class StepCounter {
+public:
+    // @brief Registers one step. Called from the step interrupt.
+    void count_step(bool forward) {
+        count_ = count_ + (forward ? 1 : -1);
+    }
+
+    // @brief Continues from the current count at zero velocity
+    void reset() {
+        last_count_ = count_;
+        pll_.set_count(last_count_);
+        pll_.vel_ = 0.0f;
+    }
+
+    // @brief Reads the count and updates the rate estimate.
+    // @returns The number of steps since the previous call
+    int32_t update(float dt, const PllGains& gains) {
+        int32_t count = count_;
+        int32_t steps = (int32_t)((uint32_t)count - (uint32_t)last_count_);
+        last_count_ = count;
+        pll_.predict(dt);
+        pll_.correct(count, gains);
+        return steps;
+    }
+
+    // @brief Estimated step rate [steps/s]
+    float get_vel() const {
+        return pll_.vel_;
+    }
+
+    int32_t last_count_ = 0;    // count at the last update()
+
+private:
+    volatile int32_t count_ = 0;
+    FixedPointPll pll_;
+};
+
+#endif
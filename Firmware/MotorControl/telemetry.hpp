@@ -0,0 +1,200 @@
+#ifndef _TELEMETRY_H
+#define _TELEMETRY_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <string.h>
+#include <atomic>
+
+#include <fibre/encoders.hpp>
+
+// @brief Encodes samples of up to kMaxChannels values into compact frames.
+//
+// Each value is scaled to a fixed point integer with the resolution of its
+// channel. A frame consists of:
+//  - a header byte: bit 7 is set for keyframes, bits 0-6 count the frames
+//    (modulo 128) so that the decoder can detect lost frames
+//  - keyframes only: the device time [us] as a varint (see micros64()).
+//    The frames in between follow at the frame period of the stream.
+//  - one varint per channel: the zigzag encoded value in keyframes and the
+//    zigzag encoded difference to the previous frame otherwise
+// Every config.keyframe_interval-th frame is a keyframe, so a decoder that
+// starts late or lost frames resynchronizes at the next keyframe. A slowly
+// changing value takes one byte per frame instead of four for a float.
+//
+// The varints are the same as in the fibre protocol (7 bits per byte, least
+// significant group first, MSB set if more bytes follow).
+class TelemetryEncoder {
+public:
+    static constexpr uint32_t kMaxChannels = 4;
+    static constexpr size_t kMaxTimeSize = 10;     // varint of a uint64_t
+    static constexpr size_t kMaxFrameSize = 1 + kMaxTimeSize + kMaxChannels * 5;
+    static constexpr uint8_t kKeyframeFlag = 0x80;
+
+    struct Config_t {
+        uint32_t n_channels = 1;
+        uint32_t keyframe_interval = 100;   // [frames]
+        float resolution[kMaxChannels] = { 1.0f, 1.0f, 1.0f, 1.0f }; // value of one LSB of each channel
+    };
+
+    // @brief Applies the configuration. The next frame is a keyframe.
+    // @returns false if the configuration is invalid
+    bool start(const Config_t& config) {
+        if (config.n_channels < 1 || config.n_channels > kMaxChannels || config.keyframe_interval < 1)
+            return false;
+        for (uint32_t i = 0; i < config.n_channels; ++i) {
+            if (!(config.resolution[i] > 0.0f))
+                return false;
+            scale_[i] = 1.0f / config.resolution[i];
+        }
+        n_channels_ = config.n_channels;
+        keyframe_interval_ = config.keyframe_interval;
+        frames_to_keyframe_ = 0;
+        frame_count_ = 0;
+        return true;
+    }
+
+    // @brief Encodes one sample of n_channels values
+    // @param time_us: Device time of the sample [us], only sent in keyframes
+    // @param frame: Receives the frame, at least kMaxFrameSize bytes
+    // @returns the length of the frame [bytes]
+    size_t encode(const float* values, uint64_t time_us, uint8_t* frame) {
+        bool keyframe = !frames_to_keyframe_;
+        frames_to_keyframe_ = keyframe ? keyframe_interval_ - 1 : frames_to_keyframe_ - 1;
+        frame[0] = (frame_count_++ & 0x7f) | (keyframe ? kKeyframeFlag : 0);
+
+        size_t length = 1;
+        if (keyframe) {
+            size_t generated_bytes = 0;
+            make_varint_encoder(time_us).get_bytes(frame + length, kMaxTimeSize, &generated_bytes);
+            length += generated_bytes;
+        }
+        for (uint32_t i = 0; i < n_channels_; ++i) {
+            int32_t value = quantize(values[i] * scale_[i]);
+            // the difference wraps around like the decoder's sum
+            int32_t diff = keyframe ? value : (int32_t)((uint32_t)value - (uint32_t)last_[i]);
+            last_[i] = value;
+            uint32_t zigzag = ((uint32_t)diff << 1) ^ (uint32_t)(diff >> 31);
+            size_t generated_bytes = 0;
+            make_varint_encoder(zigzag).get_bytes(frame + length, 5, &generated_bytes);
+            length += generated_bytes;
+        }
+        return length;
+    }
+
+    uint32_t get_channel_count() const {
+        return n_channels_;
+    }
+
+    // @brief Makes the next frame a keyframe
+    void force_keyframe() {
+        frames_to_keyframe_ = 0;
+    }
+
+private:
+    static int32_t quantize(float x) {
+        if (!(x == x)) return 0; // NaN
+        if (x >= 2147483520.0f) return INT32_MAX; // largest float below 2^31
+        if (x <= -2147483648.0f) return INT32_MIN;
+        return (int32_t)(x >= 0.0f ? x + 0.5f : x - 0.5f); // round to nearest
+    }
+
+    uint32_t n_channels_ = 1;
+    uint32_t keyframe_interval_ = 1;
+    uint32_t frames_to_keyframe_ = 0;
+    uint32_t frame_count_ = 0;
+    float scale_[kMaxChannels] = { 1.0f, 1.0f, 1.0f, 1.0f };     // [LSB/value]
+    int32_t last_[kMaxChannels] = {};
+};
+
+// @brief Records telemetry frames of endpoint values into a byte ring buffer
+// that a host reads concurrently.
+//
+// write_count_ is the total number of bytes written so far, the byte with
+// number n is at buffer[n % size]. The size must be a power of two so that
+// this holds when write_count_ wraps around. The host keeps its own read
+// count and reads the bytes up to write_count_. If it fell behind by more
+// than the buffer size, it continues at last_keyframe_, the number of the
+// first byte of the latest keyframe.
+//
+// update() runs in the control loop interrupt, the other functions in the
+// communication thread.
+class TelemetryStream {
+public:
+    struct Config_t : TelemetryEncoder::Config_t {
+        uint32_t decimation = 1;        // record every n-th control cycle
+    };
+
+    // @param control_period: Time between two update() calls [s]
+    TelemetryStream(uint8_t* buffer, size_t size, float control_period)
+        : buffer_(buffer), size_(size), control_period_(control_period) {}
+
+    // @brief Starts recording with the current configuration
+    // @returns false if the configuration is invalid
+    bool start() {
+        stop();
+        // the time is only sent in keyframes
+        const size_t max_delta_frame_size = TelemetryEncoder::kMaxFrameSize - TelemetryEncoder::kMaxTimeSize;
+        if (config_.decimation < 1
+                || config_.keyframe_interval * max_delta_frame_size + TelemetryEncoder::kMaxTimeSize > size_ / 2)
+            return false;
+        if (!encoder_.start(config_))
+            return false;
+        frame_period_ = (float)config_.decimation * control_period_;
+        cycle_ = config_.decimation - 1; // record in the first cycle
+        // everything above must be written before update() sees the new state
+        std::atomic_signal_fence(std::memory_order_seq_cst);
+        running_ = true;
+        return true;
+    }
+
+    void stop() {
+        running_ = false;
+        std::atomic_signal_fence(std::memory_order_seq_cst);
+    }
+
+    // @brief Called once per control cycle
+    // @param read: Returns the current value of a channel, called with
+    //        0 ... n_channels - 1 in every recorded cycle
+    // @param time_us: Device time of this cycle [us]
+    template<typename TRead>
+    void update(const TRead& read, uint64_t time_us) {
+        if (!running_)
+            return;
+        if (++cycle_ < config_.decimation)
+            return;
+        cycle_ = 0;
+
+        float values[TelemetryEncoder::kMaxChannels];
+        for (uint32_t i = 0; i < encoder_.get_channel_count(); ++i)
+            values[i] = read(i);
+        uint8_t frame[TelemetryEncoder::kMaxFrameSize];
+        size_t length = encoder_.encode(values, time_us, frame);
+
+        uint32_t pos = write_count_;
+        for (size_t i = 0; i < length; ++i)
+            buffer_[(pos + i) % size_] = frame[i];
+        // the bytes must be in the buffer before the host sees the new counts
+        std::atomic_signal_fence(std::memory_order_seq_cst);
+        if (frame[0] & TelemetryEncoder::kKeyframeFlag)
+            last_keyframe_ = pos;
+        write_count_ = pos + length;
+        ++frame_count_;
+    }
+
+    Config_t config_;
+    bool running_ = false;
+    uint32_t write_count_ = 0;      // [bytes]
+    uint32_t last_keyframe_ = 0;    // [bytes]
+    uint32_t frame_count_ = 0;
+    float frame_period_ = 0.0f;     // [s] time between two frames
+
+private:
+    uint8_t* buffer_;
+    size_t size_;
+    float control_period_;          // [s]
+    TelemetryEncoder encoder_;
+    uint32_t cycle_ = 0;
+};
+
+#endif
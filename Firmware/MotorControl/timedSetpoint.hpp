@@ -0,0 +1,234 @@
+#ifndef _TIMED_SETPOINT_H
+#define _TIMED_SETPOINT_H
+
+#include <stdint.h>
+#include <math.h>
+#include <atomic>
+
+// @brief Smooths position setpoints that arrive at a low and irregular rate.
+//
+// Each sample is a position with a timestamp. The control loop plays the
+// samples back with a fixed delay: at time t it interpolates linearly
+// between the samples around t - delay and uses their slope as velocity
+// feedforward. If the next sample is not there yet, the last slope is
+// extrapolated for at most max_extrapolation, then the position is held.
+// When a sample arrives after its playback time, the playback approaches it
+// over one sample interval instead of jumping. A sample that arrives after a
+// pause is approached from the held position, without extrapolation.
+//
+// Timestamps are in microseconds and may wrap around. A timestamp of 0 means
+// "now", i.e. the time at which the sample arrived on the device. Other
+// timestamps are taken from the host clock. They are mapped to the device
+// clock by the smallest transport delay seen so far. The mapping only moves
+// by a small amount per sample, so that learning it does not make the
+// setpoint jump, and it creeps up slowly to follow a drift between the clocks.
+//
+// push() and step() may run in different threads: the queue is a single
+// producer, single consumer ring buffer. start() must only be called while
+// the consumer is not running.
+class TimedSetpoint {
+public:
+    static constexpr uint32_t kCapacity = 16; // must be a power of 2
+    static constexpr uint32_t kOffsetCreep = 1; // [us per sample] max. clock drift that can be followed
+    static constexpr uint32_t kOffsetSlew = 50; // [us per sample] max. correction towards a shorter transport delay
+
+    struct Config_t {
+        float delay = 0.01f;                // [s] playback delay, should exceed the jitter
+        float max_extrapolation = 0.01f;    // [s] how long to continue the last slope when samples are late
+    };
+
+    struct Step_t {
+        float Y;
+        float Yd;
+    };
+
+    TimedSetpoint(Config_t& config) : config_(config) {}
+
+    // @brief Queues a sample. Called by the producer.
+    // @param timestamp: [us] host time of the sample, or 0 for the arrival time
+    // @returns false if the queue is full
+    bool push(float pos, uint32_t timestamp) {
+        uint32_t head = head_.load(std::memory_order_relaxed);
+        if (head - tail_.load(std::memory_order_acquire) >= kCapacity)
+            return false;
+        uint32_t arrival = now_.load(std::memory_order_acquire);
+        samples_[head & (kCapacity - 1)] = { .pos = pos, .timestamp = timestamp, .arrival = arrival };
+        head_.store(head + 1, std::memory_order_release);
+        return true;
+    }
+
+    // @brief Starts playback at the given position and resets the statistics.
+    // Samples that were queued before are dropped.
+    // @param period: Control loop period [s]
+    void start(float pos, float period) {
+        tail_.store(head_.load(std::memory_order_acquire), std::memory_order_release);
+        period_us_ = (uint32_t)lroundf(period * 1e6f);
+        uint32_t now = now_.load(std::memory_order_relaxed);
+        // one period back, so that a sample arriving right away is newer
+        prev_ = { .pos = pos, .time = now - period_us_ };
+        last_ = prev_;
+        prev_is_sample_ = false;
+        extrapolating_ = false;
+        have_offset_ = false;
+        have_interval_ = false;
+        sample_count_ = 0;
+        late_count_ = 0;
+        underflow_count_ = 0;
+        interval_ = 0.0f;
+        jitter_ = 0.0f;
+        max_jitter_ = 0.0f;
+    }
+
+    // @brief Advances the clock by one control cycle and evaluates the
+    // setpoint at the playback time. Called by the consumer.
+    void step(Step_t* output) {
+        uint32_t now = now_.load(std::memory_order_relaxed) + period_us_;
+        now_.store(now, std::memory_order_release);
+        uint32_t playback = now - (uint32_t)lroundf(config_.delay * 1e6f);
+
+        // advance to the pair of samples around the playback time
+        while (diff(playback, last_.time) >= 0) {
+            uint32_t tail = tail_.load(std::memory_order_relaxed);
+            if (head_.load(std::memory_order_acquire) == tail)
+                break;
+            Sample_t sample = samples_[tail & (kCapacity - 1)];
+            tail_.store(tail + 1, std::memory_order_release);
+            Point_t point = { .pos = sample.pos, .time = to_device_time(sample) };
+            if (diff(point.time, last_.time) <= 0) {
+                ++late_count_; // out of order or duplicate
+                continue;
+            }
+            if (diff(playback, last_.time) < (int32_t)period_us_) {
+                prev_ = last_;
+                prev_is_sample_ = true;
+            } else {
+                // The playback ran past the last sample: continue from where
+                // it is now. The slope to the new sample is not the host's
+                // velocity, so don't extrapolate it.
+                Step_t current;
+                eval(playback, &current);
+                prev_ = { .pos = current.Y, .time = playback };
+                prev_is_sample_ = false;
+            }
+            if (diff(point.time, playback) <= 0) {
+                // already due: approach it over one sample interval instead of jumping
+                ++late_count_;
+                uint32_t interval_us = (uint32_t)lroundf(interval_ * 1e6f);
+                point.time = playback + (interval_us > period_us_ ? interval_us : period_us_);
+            }
+            last_ = point;
+        }
+
+        bool extrapolating = eval(playback, output);
+        if (extrapolating && !extrapolating_ && output->Yd != 0.0f)
+            ++underflow_count_;
+        extrapolating_ = extrapolating;
+    }
+
+    // statistics since start()
+    uint32_t sample_count_ = 0;
+    uint32_t late_count_ = 0;       // samples that arrived after their playback time
+    uint32_t underflow_count_ = 0;  // times the playback had to extrapolate
+    float interval_ = 0.0f;         // [s] average time between arriving samples
+    float jitter_ = 0.0f;           // [s] average deviation of the arrival times from the timestamps
+    float max_jitter_ = 0.0f;       // [s]
+
+private:
+    struct Sample_t {
+        float pos;
+        uint32_t timestamp;
+        uint32_t arrival;
+    };
+
+    struct Point_t {
+        float pos;
+        uint32_t time;  // [us] device clock
+    };
+
+    static int32_t diff(uint32_t a, uint32_t b) {
+        return (int32_t)(a - b);
+    }
+
+    // @brief Evaluates the current pair of samples at the given time
+    // @returns true if the time is past the newer sample
+    bool eval(uint32_t time, Step_t* output) const {
+        int32_t span = diff(last_.time, prev_.time);
+        float slope = span > 0 ? (last_.pos - prev_.pos) / ((float)span * 1e-6f) : 0.0f;
+        int32_t t = diff(time, prev_.time);
+        if (t <= span) {
+            float frac = (span > 0 && t > 0) ? (float)t / (float)span : (t > 0 ? 1.0f : 0.0f);
+            output->Y = prev_.pos + frac * (last_.pos - prev_.pos);
+            output->Yd = slope;
+            return false;
+        }
+        float beyond = (float)(t - span) * 1e-6f;
+        if (prev_is_sample_ && beyond < config_.max_extrapolation) {
+            output->Y = last_.pos + slope * beyond;
+            output->Yd = slope;
+        } else {
+            output->Y = last_.pos + (prev_is_sample_ ? slope * config_.max_extrapolation : 0.0f);
+            output->Yd = 0.0f;
+        }
+        return true;
+    }
+
+    // @brief Converts the timestamp to the device clock and updates the statistics.
+    // For samples without a timestamp, the jitter is the deviation of the
+    // arrival interval from the average interval.
+    uint32_t to_device_time(const Sample_t& sample) {
+        uint32_t time = sample.arrival;
+        if (sample.timestamp) {
+            uint32_t offset = sample.arrival - sample.timestamp;
+            int32_t correction = diff(offset, offset_);
+            if (!have_offset_)
+                offset_ = offset;
+            else if (correction < -(int32_t)kOffsetSlew)
+                offset_ -= kOffsetSlew;
+            else if (correction > (int32_t)kOffsetCreep)
+                offset_ += kOffsetCreep;
+            else
+                offset_ = offset;
+            have_offset_ = true;
+            time = sample.timestamp + offset_;
+        }
+
+        if (sample_count_) {
+            float interval = (float)diff(sample.arrival, last_arrival_) * 1e-6f;
+            float expected = sample.timestamp ? (float)diff(sample.timestamp, last_timestamp_) * 1e-6f : interval_;
+            if (have_interval_ || sample.timestamp) {
+                float jitter = fabsf(interval - expected);
+                jitter_ += kStatsFilter * (jitter - jitter_);
+                if (jitter > max_jitter_)
+                    max_jitter_ = jitter;
+            }
+            interval_ = have_interval_ ? interval_ + kStatsFilter * (interval - interval_) : interval;
+            have_interval_ = true;
+        }
+        last_arrival_ = sample.arrival;
+        last_timestamp_ = sample.timestamp;
+        ++sample_count_;
+        return time;
+    }
+
+    static constexpr float kStatsFilter = 1.0f / 32.0f;
+
+    Config_t& config_;
+    Sample_t samples_[kCapacity];
+    std::atomic<uint32_t> head_{0};
+    std::atomic<uint32_t> tail_{0};
+    std::atomic<uint32_t> now_{0};  // [us] device clock, advanced by step()
+    uint32_t period_us_ = 0;
+
+    Point_t prev_ = { 0.0f, 0 };
+    Point_t last_ = { 0.0f, 0 };
+    bool prev_is_sample_ = false;   // false if prev_ is where the playback was when last_ arrived
+    bool extrapolating_ = false;
+
+    uint32_t offset_ = 0;           // [us] device time - host time
+    bool have_offset_ = false;
+    uint32_t last_arrival_ = 0;
+    uint32_t last_timestamp_ = 0;
+    bool have_interval_ = false;
+};
+
+#endif
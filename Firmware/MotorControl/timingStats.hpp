@@ -0,0 +1,79 @@
+#ifndef _TIMING_STATS_H
+#define _TIMING_STATS_H
+
+#include <stdint.h>
+
+// @brief Minimum, maximum, mean and histogram of a timing in CPU cycles.
+//
+// The histogram buckets are logarithmic with four buckets per octave, so
+// each bucket is at most 19% wide: the first bucket holds everything below
+// 2^kMinBits cycles, the last everything from 2^kMaxBits cycles on.
+// record() takes a few cycles and doesn't divide.
+class TimingStats {
+public:
+    static constexpr uint32_t kSubBits = 2;     // log2 of the buckets per octave
+    static constexpr uint32_t kMinBits = 7;     // 128 cycles
+    static constexpr uint32_t kMaxBits = 18;    // 262144 cycles, 1.56 ms at 168 MHz
+    static constexpr uint32_t kNumBuckets = ((kMaxBits - kMinBits) << kSubBits) + 2;
+
+    // @brief Bucket index of a timing [cycles]
+    static uint32_t get_bucket(uint32_t cycles) {
+        if (cycles < (1u << kMinBits))
+            return 0;
+        uint32_t msb = 31 - __builtin_clz(cycles);
+        if (msb >= kMaxBits)
+            return kNumBuckets - 1;
+        uint32_t sub = (cycles >> (msb - kSubBits)) & ((1u << kSubBits) - 1);
+        return 1 + ((msb - kMinBits) << kSubBits) + sub;
+    }
+
+    // @brief Smallest timing [cycles] that falls into the given bucket
+    static uint32_t get_bucket_lower_bound(uint32_t bucket) {
+        if (bucket == 0)
+            return 0;
+        if (bucket >= kNumBuckets - 1)
+            return 1u << kMaxBits;
+        uint32_t msb = kMinBits + ((bucket - 1) >> kSubBits);
+        uint32_t sub = (bucket - 1) & ((1u << kSubBits) - 1);
+        return ((1u << kSubBits) + sub) << (msb - kSubBits);
+    }
+
+    void record(uint32_t cycles) {
+        if (cycles < min_ || !count_)
+            min_ = cycles;
+        if (cycles > max_)
+            max_ = cycles;
+        sum_ += cycles;
+        ++count_;
+        ++histogram_[get_bucket(cycles)];
+    }
+
+    void reset() {
+        min_ = 0;
+        max_ = 0;
+        count_ = 0;
+        sum_ = 0;
+        for (uint32_t i = 0; i < kNumBuckets; ++i)
+            histogram_[i] = 0;
+    }
+
+    // @brief Mean timing [cycles]
+    uint32_t get_mean() const {
+        return count_ ? (uint32_t)(sum_ / count_) : 0;
+    }
+
+    // @brief Number of timings recorded in the given bucket
+    uint32_t get_bucket_count(uint32_t bucket) const {
+        return bucket < kNumBuckets ? histogram_[bucket] : 0;
+    }
+
+    uint32_t min_ = 0;      // [cycles]
+    uint32_t max_ = 0;      // [cycles]
+    uint32_t count_ = 0;
+    uint32_t histogram_[kNumBuckets] = {};
+
+private:
+    uint64_t sum_ = 0;      // [cycles]
+};
+
+#endif
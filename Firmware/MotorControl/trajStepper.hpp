@@ -0,0 +1,116 @@
+#ifndef _TRAJ_STEPPER_H
+#define _TRAJ_STEPPER_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <math.h>
+
+// @brief Evaluates a piecewise cubic trajectory once per control cycle.
+//
+// Computing the time as a float (t = ticks * period) loses resolution as a
+// move goes on. The stepper counts time in integer ticks instead. Each
+// segment is re-expanded around its first tick with per-tick coefficients,
+// so a cycle only costs an integer compare and one Horner evaluation in the
+// tick index within the segment. That index stays small enough for a float
+// to represent exactly.
+//
+// Usage: begin(), add_segment() for each segment in order, finish(), then
+// step() once per cycle. restart() starts the same trajectory again.
+class TrajectoryStepper {
+public:
+    static constexpr size_t kMaxSegments = 7;
+
+    struct Step_t {
+        float Y;
+        float Yd;
+        float Ydd;
+    };
+
+    // @param period: Control loop period [s]
+    void begin(float period) {
+        period_ = period;
+        inv_period_ = 1.0f / period;
+        inv_period_sq_ = inv_period_ * inv_period_;
+        n_segments_ = 0;
+        restart();
+    }
+
+    // @brief Appends a segment Y(t) = c[0] + c[1]*tau + c[2]*tau^2 + c[3]*tau^3,
+    // tau = t - t0, which is valid from t0 until the next segment starts.
+    // @returns false if there are too many segments
+    bool add_segment(float t0, const float c[4]) {
+        if (n_segments_ >= kMaxSegments)
+            return false;
+        Segment_t& seg = segments_[n_segments_++];
+        seg.start_tick = (uint32_t)ceilf(t0 * inv_period_);
+        // offset of the first tick from the start of the segment
+        float phi = (float)seg.start_tick * period_ - t0;
+        float h = period_;
+        seg.d[0] = c[0] + phi * (c[1] + phi * (c[2] + phi * c[3]));
+        seg.d[1] = (c[1] + phi * (2.0f * c[2] + 3.0f * phi * c[3])) * h;
+        seg.d[2] = (c[2] + 3.0f * phi * c[3]) * h * h;
+        seg.d[3] = c[3] * h * h * h;
+        return true;
+    }
+
+    // @brief Completes the trajectory.
+    // @param Tf: Duration [s]. Y is Xf from then on.
+    void finish(float Tf, float Xf) {
+        Xf_ = Xf;
+        end_tick_ = (uint32_t)floorf(Tf * inv_period_) + 1;
+        for (size_t i = 0; i < n_segments_; ++i)
+            segments_[i].end_tick = (i + 1 < n_segments_) ? segments_[i + 1].start_tick : end_tick_;
+        restart();
+    }
+
+    void restart() {
+        tick_ = 0;
+        segment_ = 0;
+    }
+
+    // @brief Evaluates the trajectory at the current tick and advances by one tick.
+    // @returns false once the trajectory is complete. Y, Yd and Ydd are then
+    //          the final position at standstill.
+    bool step(Step_t* output) {
+        if (tick_ >= end_tick_ || !n_segments_) {
+            output->Y = Xf_;
+            output->Yd = 0.0f;
+            output->Ydd = 0.0f;
+            if (tick_ >= end_tick_)
+                return false;
+            ++tick_;
+            return true;
+        }
+        while (segment_ < n_segments_ - 1 && tick_ >= segments_[segment_].end_tick)
+            ++segment_;
+        const Segment_t& seg = segments_[segment_];
+        const float m = (float)(tick_ - seg.start_tick);
+        const float* d = seg.d;
+        output->Y   = d[0] + m * (d[1] + m * (d[2] + m * d[3]));
+        output->Yd  = (d[1] + m * (2.0f * d[2] + m * 3.0f * d[3])) * inv_period_;
+        output->Ydd = (2.0f * d[2] + m * 6.0f * d[3]) * inv_period_sq_;
+        ++tick_;
+        return true;
+    }
+
+    uint32_t tick_ = 0;     // ticks since the start of the trajectory
+    uint32_t end_tick_ = 0; // first tick after the end of the trajectory
+
+private:
+    // Y(n) = d[0] + d[1]*m + d[2]*m^2 + d[3]*m^3 with m = n - start_tick
+    struct Segment_t {
+        uint32_t start_tick;
+        uint32_t end_tick;
+        float d[4];
+    };
+
+    Segment_t segments_[kMaxSegments];
+    size_t n_segments_ = 0;
+    size_t segment_ = 0;
+    float period_ = 1.0f;
+    float inv_period_ = 1.0f;
+    float inv_period_sq_ = 1.0f;
+    float Xf_ = 0.0f;
+};
+
+#endif
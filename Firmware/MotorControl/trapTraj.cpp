@@ -59,12 +59,65 @@ bool TrapezoidalTrajectory::planTrapezoidal(float Xf, float Xi, float Vi,
     Xf_ = Xf;
     Vi_ = Vi;
     yAccel_ = Xi + Vi*Ta_ + 0.5f*Ar_*SQ(Ta_); // pos at end of accel phase
+    planned_profile_ = PROFILE_TRAPEZOIDAL;
 
+    // The same phases as polynomials in the time since the start of each phase
+    const float accel[4] = { Xi, Vi, 0.5f*Ar_, 0.0f };
+    const float coast[4] = { yAccel_, Vr_, 0.0f, 0.0f };
+    const float decel[4] = { Xf + 0.5f*Dr_*SQ(Td_), -Dr_*Td_, 0.5f*Dr_, 0.0f };
+    stepper_.begin(current_meas_period);
+    if (Ta_ > 0.0f)
+        stepper_.add_segment(0.0f, accel);
+    if (Tv_ > 0.0f)
+        stepper_.add_segment(Ta_, coast);
+    if (Td_ > 0.0f)
+        stepper_.add_segment(Ta_ + Tv_, decel);
+    stepper_.finish(Tf_, Xf);
+
+    return true;
+}
+
+bool TrapezoidalTrajectory::planSCurve(float Xf, float Xi, float Vi,
+                                       float Vmax, float Amax, float Dmax, float Jmax) {
+    if (!scurve_.plan(Xf, Xi, Vi, Vmax, Amax, Dmax, Jmax))
+        return false;
+    Tf_ = scurve_.Tf_;
+    Xi_ = Xi;
+    Xf_ = Xf;
+    Vi_ = Vi;
+    planned_profile_ = PROFILE_SCURVE;
+    scurve_.load(stepper_, current_meas_period);
     return true;
 }
 
+// @brief Copies the trajectory planned by other, which shares the limits of this one
+void TrapezoidalTrajectory::load_plan(const TrapezoidalTrajectory& other) {
+    Xi_ = other.Xi_;
+    Xf_ = other.Xf_;
+    Vi_ = other.Vi_;
+    Ar_ = other.Ar_;
+    Vr_ = other.Vr_;
+    Dr_ = other.Dr_;
+    Ta_ = other.Ta_;
+    Tv_ = other.Tv_;
+    Td_ = other.Td_;
+    Tf_ = other.Tf_;
+    yAccel_ = other.yAccel_;
+    planned_profile_ = other.planned_profile_;
+    scurve_ = other.scurve_;
+    stepper_ = other.stepper_;
+}
+
 TrapezoidalTrajectory::Step_t TrapezoidalTrajectory::eval(float t) {
     Step_t trajStep;
+    if (planned_profile_ == PROFILE_SCURVE) {
+        SCurveTrajectory::Step_t step = scurve_.eval(t);
+        trajStep.Y   = step.Y;
+        trajStep.Yd  = step.Yd;
+        trajStep.Ydd = step.Ydd;
+        return trajStep;
+    }
+
     if (t < 0.0f) {  // Initial Condition
         trajStep.Y   = Xi_;
         trajStep.Yd  = Vi_;
@@ -91,4 +144,17 @@ TrapezoidalTrajectory::Step_t TrapezoidalTrajectory::eval(float t) {
     }
 
     return trajStep;
-}
\ No newline at end of file
+}
+
+// @brief Evaluates the planned profile at the next control cycle.
+// Equivalent to eval(ticks * current_meas_period), without the loss of time
+// resolution of a float time on long moves.
+// @returns false once the trajectory is complete
+bool TrapezoidalTrajectory::step(Step_t* output) {
+    TrajectoryStepper::Step_t step;
+    bool running = stepper_.step(&step);
+    output->Y   = step.Y;
+    output->Yd  = step.Yd;
+    output->Ydd = step.Ydd;
+    return running;
+}
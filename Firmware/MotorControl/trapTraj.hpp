@@ -3,11 +3,18 @@
 
 class TrapezoidalTrajectory {
 public:
+    enum ProfileType_t {
+        PROFILE_TRAPEZOIDAL = 0,
+        PROFILE_SCURVE = 1, // jerk limited, see SCurveTrajectory
+    };
+
     struct Config_t {
         float vel_limit = 20000.0f;  // [count/s]
         float accel_limit = 5000.0f; // [count/s^2]
         float decel_limit = 5000.0f; // [count/s^2]
         float A_per_css = 0.0f;      // [A/(count/s^2)]
+        ProfileType_t profile_type = PROFILE_TRAPEZOIDAL;
+        float jerk_limit = 100000.0f; // [count/s^3] only used by PROFILE_SCURVE
     };
     struct Step_t {
         float Y;
@@ -18,7 +25,11 @@ public:
     TrapezoidalTrajectory(Config_t& config);
     bool planTrapezoidal(float Xf, float Xi, float Vi,
                          float Vmax, float Amax, float Dmax);
+    bool planSCurve(float Xf, float Xi, float Vi,
+                    float Vmax, float Amax, float Dmax, float Jmax);
+    void load_plan(const TrapezoidalTrajectory& other);
     Step_t eval(float t);
+    bool step(Step_t* output);
 
     auto make_protocol_definitions() {
         return make_protocol_member_list(
@@ -26,7 +37,9 @@ public:
                 make_protocol_property("vel_limit", &config_.vel_limit),
                 make_protocol_property("accel_limit", &config_.accel_limit),
                 make_protocol_property("decel_limit", &config_.decel_limit),
-                make_protocol_property("A_per_css", &config_.A_per_css)
+                make_protocol_property("A_per_css", &config_.A_per_css),
+                make_protocol_property("profile_type", &config_.profile_type),
+                make_protocol_property("jerk_limit", &config_.jerk_limit)
             )
         );
     }
@@ -48,6 +61,10 @@ public:
     float Tf_;
 
     float yAccel_;
+
+    ProfileType_t planned_profile_ = PROFILE_TRAPEZOIDAL; // profile evaluated by eval()
+    SCurveTrajectory scurve_;
+    TrajectoryStepper stepper_; // evaluates the planned profile in the control loop
 };
 
 #endif
\ No newline at end of file
@@ -195,6 +195,20 @@ uint32_t micros(void) {
     return (ms * 1000) + cycle_cnt;
 }
 
+// @brief: Returns number of microseconds since system startup.
+// Unlike micros() this doesn't wrap around after 71 minutes. It is still
+// built on the 32 bit millisecond HAL_GetTick(), so it wraps around after
+// 2^32 ms (about 49.7 days).
+uint64_t micros64(void) {
+    register uint32_t ms, cycle_cnt;
+    do {
+        ms = HAL_GetTick();
+        cycle_cnt = TIM_TIME_BASE->CNT;
+     } while (ms != HAL_GetTick());
+
+    return ((uint64_t)ms * 1000) + cycle_cnt;
+}
+
 // @brief: Busy wait delay for given amount of microseconds (us)
 void delay_us(uint32_t us)
 {
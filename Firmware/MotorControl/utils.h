@@ -104,6 +104,7 @@ uint32_t timeout_to_deadline(uint32_t timeout_ms);
 int is_in_the_future(uint32_t time_ms);
 
 uint32_t micros(void);
+uint64_t micros64(void);
 void delay_us(uint32_t us);
 
 float our_arm_sin_f32(float x);
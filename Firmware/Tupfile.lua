@@ -73,6 +73,11 @@ if tup.getconfig("STEP_DIR") == "y" then
     end
 end
 
+-- Control loop settings
+if tup.getconfig("CONTROL_IN_ISR") == "true" then
+    FLAGS += "-DCONTROL_IN_ISR"
+end
+
 -- Compiler settings
 if tup.getconfig("STRICT") == "true" then
     FLAGS += '-Werror'
@@ -159,6 +164,7 @@ build{
         'MotorControl/controller.cpp',
         'MotorControl/sensorless_estimator.cpp',
         'MotorControl/trapTraj.cpp',
+        'MotorControl/scurveTraj.cpp',
         'MotorControl/main.cpp',
         'communication/communication.cpp',
         'communication/ascii_protocol.cpp',
@@ -1,7 +1,8 @@
 /*
 * The ASCII protocol is a simpler, human readable alternative to the main native
 * protocol.
-* In the future this protocol might be extended to support selected GCode commands.
+* Lines that start with G, M or N are interpreted as a subset of GCode, see
+* process_gcode_line().
 * For a list of supported commands see doc/ascii-protocol.md
 */
 
@@ -12,7 +13,9 @@
 #include "communication.h"
 #include "ascii_protocol.hpp"
 #include <utils.h>
+#include <motion_planner.hpp>
 #include <fibre/cpp_utils.hpp>
+#include <ctype.h>
 
 /* Private macros ------------------------------------------------------------*/
 /* Private typedef -----------------------------------------------------------*/
@@ -24,15 +27,33 @@
 #define TO_STR_INNER(s) #s
 #define TO_STR(s) TO_STR_INNER(s)
 
+#define GCODE_QUEUE_SIZE 16 // moves considered by the look-ahead planner
+#define GCODE_EXECUTE_AHEAD 0.1f // [s] planned moves are executed when the PVT queues hold less than this
+
 /* Private variables ---------------------------------------------------------*/
+
+static void gcode_emit_point(const float pos[AXIS_COUNT], const float vel[AXIS_COUNT], float dt);
+
+// GCode interpreter state. X moves axis0 and Y moves axis1.
+// The USB and UART threads and the communication task share it, gcode_mutex
+// must be held to access it.
+static osMutexId gcode_mutex;
+static MotionPlanner<AXIS_COUNT, GCODE_QUEUE_SIZE> gcode_planner(&gcode_emit_point);
+static float gcode_offset[AXIS_COUNT] = {}; // [counts] machine position of the program origin (G92)
+static float gcode_feed_rate = INFINITY;    // [counts/s] limited by the axis limits if no F was given
+static bool gcode_relative = false;         // G91
+static int gcode_motion_mode = 0;           // G0 or G1
+
 /* Private function prototypes -----------------------------------------------*/
 /* Function implementations --------------------------------------------------*/
 
 // @brief Sends a line on the specified output.
 template<typename ... TArgs>
 void respond(StreamSink& output, bool include_checksum, const char * fmt, TArgs&& ... args) {
-    char response[64];
+    char response[128];
     size_t len = snprintf(response, sizeof(response), fmt, std::forward<TArgs>(args)...);
+    if (len >= sizeof(response))
+        len = sizeof(response) - 1; // truncated
     output.process_bytes((uint8_t*)response, len, nullptr); // TODO: use process_all instead
     if (include_checksum) {
         uint8_t checksum = 0;
@@ -45,6 +66,254 @@ void respond(StreamSink& output, bool include_checksum, const char * fmt, TArgs&
 }
 
 
+static bool gcode_axes_ready() {
+    for (size_t i = 0; i < AXIS_COUNT; ++i) {
+        if (axes[i]->current_state_ != Axis::AXIS_STATE_CLOSED_LOOP_CONTROL)
+            return false;
+    }
+    return true;
+}
+
+// @brief Starts PVT playback on all axes that are not playing yet, in the same control cycle
+static void gcode_start_axes() {
+    // a few cycles ahead, so that the command reaches both control loops in time
+    uint32_t tick = control_tick + 4;
+    bool scheduled = false;
+    for (size_t i = 0; i < AXIS_COUNT; ++i) {
+        Controller& controller = axes[i]->controller_;
+        if (controller.config_.control_mode == Controller::CTRL_MODE_PVT_CONTROL)
+            continue;
+        if (controller.schedule_command(tick, { Controller::Command_t::TYPE_START_PVT, { 0.0f, 0.0f, 0.0f } }))
+            scheduled = true;
+        else
+            controller.start_pvt(); // the schedule holds later commands, start right away
+    }
+    // wait until both axes applied it
+    while (scheduled && gcode_axes_ready() && (int32_t)(control_tick - tick) <= 0)
+        osDelay(1);
+}
+
+// @brief Queues a point on all axes if every axis has room, so that the point
+// goes to all axes or to none. Pushes from the protocol (Controller::push_pvt)
+// could take the room between the check and the push, so both happen in the
+// same critical section.
+// @returns false if an axis had no room
+static bool gcode_try_push_point(const float pos[AXIS_COUNT], const float vel[AXIS_COUNT], float dt) {
+    uint32_t mask = cpu_enter_critical();
+    bool room = true;
+    for (size_t i = 0; i < AXIS_COUNT; ++i)
+        room = room && axes[i]->controller_.pvt_.get_level() < PvtTrajectory::kCapacity;
+    if (room) {
+        for (size_t i = 0; i < AXIS_COUNT; ++i)
+            axes[i]->controller_.pvt_.push(pos[i], vel[i], dt);
+    }
+    cpu_exit_critical(mask);
+    return room;
+}
+
+// @brief Queues a point of the planned path on all axes, waiting for space
+// if necessary. This is what throttles the sender: it only gets the "ok" for
+// a line once the moves that didn't fit in the planner are queued.
+static void gcode_emit_point(const float pos[AXIS_COUNT], const float vel[AXIS_COUNT], float dt) {
+    while (!gcode_try_push_point(pos, vel, dt)) {
+        if (!gcode_axes_ready())
+            return; // the point is lost, but waiting would never end
+        gcode_start_axes();
+        osDelay(1);
+    }
+    gcode_start_axes();
+}
+
+// @brief If the axes were moved by other means since the last GCode move,
+// continue from their current setpoints.
+static void gcode_sync_position() {
+    if (gcode_planner.get_queue_length())
+        return;
+    bool playing = true;
+    for (size_t i = 0; i < AXIS_COUNT; ++i)
+        playing = playing && axes[i]->controller_.config_.control_mode == Controller::CTRL_MODE_PVT_CONTROL;
+    if (playing)
+        return;
+    float pos[AXIS_COUNT];
+    for (size_t i = 0; i < AXIS_COUNT; ++i) {
+        axes[i]->controller_.clear_pvt();
+        pos[i] = axes[i]->controller_.pos_setpoint_;
+    }
+    gcode_planner.set_position(pos);
+}
+
+// @brief Executes all queued moves and waits until the axes stopped
+static void gcode_wait_for_moves() {
+    gcode_planner.flush();
+    for (size_t i = 0; i < AXIS_COUNT; ++i) {
+        PvtTrajectory& pvt = axes[i]->controller_.pvt_;
+        while (gcode_axes_ready() && (pvt.get_level() || pvt.state_ == PvtTrajectory::STATE_RUNNING))
+            osDelay(1);
+    }
+}
+
+// @brief Executes the planned moves that the axes are about to need.
+// The moves stay in the planner as long as possible, so that moves that
+// arrive later can still be blended with them. Once the PVT queues run low,
+// for example because the sender paused, the oldest moves are executed. The
+// last move ends at standstill, so the axes never run out of points at speed.
+void ASCII_protocol_execute_gcode() {
+    // a line is being executed, which feeds the queues itself
+    if (osMutexWait(gcode_mutex, 0) != osOK)
+        return;
+    while (gcode_planner.get_queue_length() && gcode_axes_ready()) {
+        float queued = INFINITY;
+        for (size_t i = 0; i < AXIS_COUNT; ++i)
+            queued = std::min(queued, axes[i]->controller_.pvt_.get_queued_duration());
+        if (queued >= GCODE_EXECUTE_AHEAD)
+            break;
+        gcode_planner.execute_next();
+    }
+    osMutexRelease(gcode_mutex);
+}
+
+// @brief Executes a line of GCode. Supported words:
+//   G0, G1 X Y F: linear move (rapid or at the feed rate F [counts/min])
+//   G4 P|S: dwell [ms] or [s]
+//   G90, G91: absolute or relative coordinates
+//   G92 X Y: set the current position
+//   M17, M18/M84: enter closed loop control or idle on both axes
+//   M114: report the position at the end of the queued moves
+//   M400: wait until all moves are finished
+//   N: line number (ignored)
+// Moves are blended by the look-ahead planner and played through the PVT
+// queues of the controllers. Every line is answered with "ok" or an error.
+static void process_gcode_line(const char* cmd, StreamSink& response_channel, bool use_checksum) {
+    float words[26];
+    uint32_t present = 0;
+    int g_codes[4];
+    size_t n_g_codes = 0;
+    int m_code = -1;
+
+    for (const char* p = cmd; *p; ) {
+        if (isspace((unsigned char)*p)) {
+            ++p;
+            continue;
+        }
+        if (*p == '(') { // comment
+            while (*p && *p != ')')
+                ++p;
+            if (*p)
+                ++p;
+            continue;
+        }
+        char letter = (char)toupper((unsigned char)*p);
+        char* end;
+        float value = strtof(p + 1, &end);
+        if (letter < 'A' || letter > 'Z' || end == p + 1) {
+            respond(response_channel, use_checksum, "error: invalid word at \"%.8s\"", p);
+            return;
+        }
+        p = end;
+        if (letter == 'G') {
+            if (n_g_codes < sizeof(g_codes) / sizeof(g_codes[0]))
+                g_codes[n_g_codes++] = (int)value;
+        } else if (letter == 'M') {
+            m_code = (int)value;
+        } else {
+            words[letter - 'A'] = value;
+            present |= 1 << (letter - 'A');
+        }
+    }
+    auto has = [&](char letter) { return (present & (1 << (letter - 'A'))) != 0; };
+    const char axis_letters[AXIS_COUNT] = { 'X', 'Y' };
+
+    bool motion = false;
+    bool dwell = false;
+    bool set_position = false;
+    for (size_t i = 0; i < n_g_codes; ++i) {
+        switch (g_codes[i]) {
+            case 0:
+            case 1: gcode_motion_mode = g_codes[i]; motion = true; break;
+            case 4: dwell = true; break;
+            case 90: gcode_relative = false; break;
+            case 91: gcode_relative = true; break;
+            case 92: set_position = true; break;
+            default:
+                respond(response_channel, use_checksum, "error: unsupported G%d", g_codes[i]);
+                return;
+        }
+    }
+    // axis words without a G word continue the last motion mode
+    if (!n_g_codes && m_code < 0 && (has('X') || has('Y')))
+        motion = true;
+    if (has('F')) {
+        if (!(words['F' - 'A'] > 0.0f)) {
+            respond(response_channel, use_checksum, "error: invalid feed rate");
+            return;
+        }
+        gcode_feed_rate = words['F' - 'A'] / 60.0f;
+    }
+
+    if (motion || dwell || m_code == 400) {
+        if (!gcode_axes_ready()) {
+            respond(response_channel, use_checksum, "error: axes not in closed loop control");
+            return;
+        }
+        gcode_sync_position();
+    }
+
+    if (set_position) {
+        gcode_sync_position();
+        const float* machine_pos = gcode_planner.get_position();
+        for (size_t i = 0; i < AXIS_COUNT; ++i) {
+            if (has(axis_letters[i]))
+                gcode_offset[i] = machine_pos[i] - words[axis_letters[i] - 'A'];
+        }
+    } else if (motion) {
+        const float* machine_pos = gcode_planner.get_position();
+        float target[AXIS_COUNT];
+        for (size_t i = 0; i < AXIS_COUNT; ++i) {
+            target[i] = machine_pos[i];
+            if (has(axis_letters[i])) {
+                float value = words[axis_letters[i] - 'A'];
+                target[i] = gcode_relative ? machine_pos[i] + value : gcode_offset[i] + value;
+            }
+        }
+        TrapezoidalTrajectory::Config_t* traj_configs[AXIS_COUNT];
+        decltype(gcode_planner)::Limits_t limits;
+        for (size_t i = 0; i < AXIS_COUNT; ++i) {
+            traj_configs[i] = &axes[i]->trap_.config_;
+            limits.vel[i] = traj_configs[i]->vel_limit;
+            limits.accel[i] = std::min(traj_configs[i]->accel_limit, traj_configs[i]->decel_limit);
+        }
+        limits.junction_deviation = board_config.gcode_junction_deviation;
+        gcode_planner.add_line(target, gcode_motion_mode == 0 ? INFINITY : gcode_feed_rate, limits);
+    }
+
+    if (dwell) {
+        float duration = has('P') ? 0.001f * words['P' - 'A'] : has('S') ? words['S' - 'A'] : 0.0f;
+        gcode_planner.add_dwell(duration);
+    }
+
+    switch (m_code) {
+        case -1: break;
+        case 17:
+        case 18:
+        case 84: {
+            gcode_wait_for_moves();
+            Axis::State_t state = (m_code == 17) ? Axis::AXIS_STATE_CLOSED_LOOP_CONTROL : Axis::AXIS_STATE_IDLE;
+            for (size_t i = 0; i < AXIS_COUNT; ++i)
+                axes[i]->requested_state_ = state;
+        } break;
+        case 114: {
+            const float* machine_pos = gcode_planner.get_position();
+            respond(response_channel, use_checksum, "X:%.1f Y:%.1f",
+                    (double)(machine_pos[0] - gcode_offset[0]), (double)(machine_pos[1] - gcode_offset[1]));
+        } break;
+        case 400: gcode_wait_for_moves(); break;
+        default:
+            respond(response_channel, use_checksum, "error: unsupported M%d", m_code);
+            return;
+    }
+    respond(response_channel, use_checksum, "ok");
+}
+
 // @brief Executes an ASCII protocol command
 // @param buffer buffer of ASCII encoded characters
 // @param len size of the buffer
@@ -86,7 +355,12 @@ void ASCII_protocol_process_line(const uint8_t* buffer, size_t len, StreamSink&
     cmd[len] = 0; // null-terminate
 
     // check incoming packet type
-    if (cmd[0] == 'p') { // position control
+    if (cmd[0] == 'G' || cmd[0] == 'M' || cmd[0] == 'N') {
+        osMutexWait(gcode_mutex, osWaitForever);
+        process_gcode_line(cmd, response_channel, use_checksum);
+        osMutexRelease(gcode_mutex);
+
+    } else if (cmd[0] == 'p') { // position control
         unsigned motor_number;
         float pos_setpoint, vel_feed_forward, current_feed_forward;
         int numscan = sscanf(cmd, "p %u %f %f %f", &motor_number, &pos_setpoint, &vel_feed_forward, &current_feed_forward);
@@ -99,7 +373,7 @@ void ASCII_protocol_process_line(const uint8_t* buffer, size_t len, StreamSink&
                 vel_feed_forward = 0.0f;
             if (numscan < 4)
                 current_feed_forward = 0.0f;
-            axes[motor_number]->controller_.set_pos_setpoint(pos_setpoint, vel_feed_forward, current_feed_forward);
+            axes[motor_number]->controller_.post_pos_setpoint(pos_setpoint, vel_feed_forward, current_feed_forward);
         }
 
     } else if (cmd[0] == 'q') { // position control with limits
@@ -111,10 +385,7 @@ void ASCII_protocol_process_line(const uint8_t* buffer, size_t len, StreamSink&
         } else if (motor_number >= AXIS_COUNT) {
             respond(response_channel, use_checksum, "invalid motor %u", motor_number);
         } else {
-            Axis* axis = axes[motor_number];
-            axis->controller_.pos_setpoint_ = pos_setpoint;
-            axis->controller_.config_.vel_limit = vel_limit;
-            axis->motor_.config_.current_lim = current_lim;
+            axes[motor_number]->controller_.post_pos_setpoint_with_limits(pos_setpoint, vel_limit, current_lim);
         }
 
     } else if (cmd[0] == 'v') { // velocity control
@@ -128,7 +399,7 @@ void ASCII_protocol_process_line(const uint8_t* buffer, size_t len, StreamSink&
         } else {
             if (numscan < 3)
                 current_feed_forward = 0.0f;
-            axes[motor_number]->controller_.set_vel_setpoint(vel_setpoint, current_feed_forward);
+            axes[motor_number]->controller_.post_vel_setpoint(vel_setpoint, current_feed_forward);
         }
 
     } else if (cmd[0] == 'c') { // current control
@@ -140,7 +411,7 @@ void ASCII_protocol_process_line(const uint8_t* buffer, size_t len, StreamSink&
         } else if (motor_number >= AXIS_COUNT) {
             respond(response_channel, use_checksum, "invalid motor %u", motor_number);
         } else {
-            axes[motor_number]->controller_.set_current_setpoint(current_setpoint);
+            axes[motor_number]->controller_.post_current_setpoint(current_setpoint);
         }
 
     } else if (cmd[0] == 't') { // trapezoidal trajectory
@@ -152,7 +423,40 @@ void ASCII_protocol_process_line(const uint8_t* buffer, size_t len, StreamSink&
         } else if (motor_number >= AXIS_COUNT) {
             respond(response_channel, use_checksum, "invalid motor %u", motor_number);
         } else {
-            axes[motor_number]->controller_.move_to_pos(goal_point);
+            axes[motor_number]->controller_.post_move_to_pos(goal_point);
+        }
+
+    } else if (cmd[0] == 's') { // synchronized trajectory of both axes
+        float goal_point0, goal_point1;
+        int numscan = sscanf(cmd, "s %f %f", &goal_point0, &goal_point1);
+        if (numscan < 2) {
+            respond(response_channel, use_checksum, "invalid command format");
+        } else if (!move_to_pos_coordinated(goal_point0, goal_point1)) {
+            respond(response_channel, use_checksum, "axes not in closed loop control");
+        }
+
+    } else if (cmd[0] == 'o') { // oscilloscope readout
+        unsigned frame, count;
+        int numscan = sscanf(cmd, "o %u %u", &frame, &count);
+        uint32_t n_channels = oscilloscope.get_channel_count();
+        if (numscan < 1) {
+            respond(response_channel, use_checksum, "%d %u %u", (int)oscilloscope.state_,
+                    (unsigned)oscilloscope.get_frame_count(), (unsigned)n_channels);
+        } else if (!n_channels) {
+            respond(response_channel, use_checksum, "no capture");
+        } else {
+            if (numscan < 2)
+                count = 1;
+            // one line per frame with the values of all channels
+            for (; count && frame < oscilloscope.get_frame_count(); --count, ++frame) {
+                char line[Oscilloscope::kMaxChannels * 16];
+                size_t len = 0;
+                for (uint32_t channel = 0; channel < n_channels; ++channel) {
+                    len += snprintf(line + len, sizeof(line) - len, channel ? " %.6g" : "%.6g",
+                                    (double)oscilloscope.get_value(frame, channel));
+                }
+                respond(response_channel, use_checksum, "%s", line);
+            }
         }
 
     } else if (cmd[0] == 'h') {  // Help
@@ -162,6 +466,10 @@ void ASCII_protocol_process_line(const uint8_t* buffer, size_t len, StreamSink&
         respond(response_channel, use_checksum, "Position: p axis pos vel-ff I-ff");
         respond(response_channel, use_checksum, "Velocity: v axis vel I-ff");
         respond(response_channel, use_checksum, "Current: c axis I");
+        respond(response_channel, use_checksum, "Trajectory: t axis pos");
+        respond(response_channel, use_checksum, "Coordinated trajectory: s pos0 pos1");
+        respond(response_channel, use_checksum, "GCode: G0/G1 X Y F, G4 P, G90/G91, G92, M17/M18, M114, M400");
+        respond(response_channel, use_checksum, "Oscilloscope: o [frame count]");
         respond(response_channel, use_checksum, "");
         respond(response_channel, use_checksum, "Properties start at odrive root, such as axis0.requested_state");
         respond(response_channel, use_checksum, "Read: r property");
@@ -216,6 +524,12 @@ void ASCII_protocol_process_line(const uint8_t* buffer, size_t len, StreamSink&
     }
 }
 
+// @brief Must be called before the communication threads start
+void ASCII_protocol_init() {
+    osMutexDef(gcode_mutex_def);
+    gcode_mutex = osMutexCreate(osMutex(gcode_mutex_def));
+}
+
 void ASCII_protocol_parse_stream(const uint8_t* buffer, size_t len, StreamSink& response_channel) {
     static uint8_t parse_buffer[MAX_LINE_LENGTH];
     static bool read_active = true;
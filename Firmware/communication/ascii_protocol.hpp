@@ -16,7 +16,9 @@
 /* Exported functions --------------------------------------------------------*/
 
 /* Exported functions --------------------------------------------------------*/
+void ASCII_protocol_init();
 void ASCII_protocol_parse_stream(const uint8_t* buffer, size_t len, StreamSink& response_channel);
+void ASCII_protocol_execute_gcode();
 
 
 #endif /* __ASCII_PROTOCOL_H */
@@ -7,6 +7,7 @@
 #include "interface_uart.h"
 #include "interface_can.hpp"
 #include "interface_i2c.h"
+#include "ascii_protocol.hpp"
 
 #include "odrive_main.h"
 #include "freertos_vars.h"
@@ -92,8 +93,23 @@ void init_communication(void) {
 }
 
 
-float oscilloscope[OSCILLOSCOPE_SIZE] = {0};
-size_t oscilloscope_pos = 0;
+float oscilloscope_buffer[OSCILLOSCOPE_SIZE] = {0};
+Oscilloscope oscilloscope(oscilloscope_buffer, OSCILLOSCOPE_SIZE, current_meas_period);
+endpoint_ref_t oscilloscope_channels[Oscilloscope::kMaxChannels] = {};
+Endpoint* oscilloscope_endpoints[Oscilloscope::kMaxChannels] = {};
+
+uint8_t telemetry_buffer[TELEMETRY_BUFFER_SIZE];
+TelemetryStream telemetry(telemetry_buffer, TELEMETRY_BUFFER_SIZE, current_meas_period);
+endpoint_ref_t telemetry_channels[TelemetryEncoder::kMaxChannels] = {};
+Endpoint* telemetry_endpoints[TelemetryEncoder::kMaxChannels] = {};
+
+// @brief Looks up the endpoints of the channels once, so that the control
+// loop interrupt only has to read them. The recorder must be stopped.
+template<size_t N>
+static void resolve_channels(const endpoint_ref_t (&channels)[N], Endpoint* (&endpoints)[N]) {
+    for (size_t i = 0; i < N; ++i)
+        endpoints[i] = get_endpoint(channels[i]);
+}
 
 
 static CAN_context can1_ctx;
@@ -105,9 +121,23 @@ class StaticFunctions {
 public:
     void save_configuration_helper() { save_configuration(); }
     void erase_configuration_helper() { erase_configuration(); }
+    bool save_calibration_helper() { return save_calibration(); }
+    void erase_calibration_helper() { erase_calibration(); }
+    bool move_to_pos_coordinated_helper(float goal_point0, float goal_point1) { return move_to_pos_coordinated(goal_point0, goal_point1); }
     void NVIC_SystemReset_helper() { NVIC_SystemReset(); }
     void enter_dfu_mode_helper() { enter_dfu_mode(); }
-    float get_oscilloscope_val(uint32_t index) { return oscilloscope[index]; }
+    uint64_t get_timestamp_us() { return micros64(); }
+    bool start_oscilloscope() {
+        oscilloscope.stop();
+        resolve_channels(oscilloscope_channels, oscilloscope_endpoints);
+        return oscilloscope.start();
+    }
+    bool start_telemetry() {
+        telemetry.stop();
+        resolve_channels(telemetry_channels, telemetry_endpoints);
+        return telemetry.start();
+    }
+    float get_oscilloscope_val(uint32_t index) { return index < OSCILLOSCOPE_SIZE ? oscilloscope_buffer[index] : 0.0f; }
     float get_adc_voltage_(uint32_t gpio) { return get_adc_voltage(get_gpio_port_by_pin(gpio), get_gpio_pin_by_pin(gpio)); }
     int32_t test_function(int32_t delta) { static int cnt = 0; return cnt += delta; }
 } static_functions;
@@ -118,6 +148,7 @@ public:
 static inline auto make_obj_tree() {
     return make_protocol_member_list(
         make_protocol_ro_property("vbus_voltage", &vbus_voltage),
+        make_protocol_ro_property("control_tick", &control_tick),
         make_protocol_ro_property("serial_number", &serial_number),
         make_protocol_ro_property("hw_version_major", &hw_version_major),
         make_protocol_ro_property("hw_version_minor", &hw_version_minor),
@@ -158,6 +189,7 @@ static inline auto make_obj_tree() {
             make_protocol_property("enable_ascii_protocol_on_usb", &board_config.enable_ascii_protocol_on_usb),
             make_protocol_property("dc_bus_undervoltage_trip_level", &board_config.dc_bus_undervoltage_trip_level),
             make_protocol_property("dc_bus_overvoltage_trip_level", &board_config.dc_bus_overvoltage_trip_level),
+            make_protocol_property("gcode_junction_deviation", &board_config.gcode_junction_deviation),
 #if HW_VERSION_MAJOR == 3 && HW_VERSION_MINOR >= 3
             make_protocol_object("gpio1_pwm_mapping", make_protocol_definitions(board_config.pwm_mappings[0])),
             make_protocol_object("gpio2_pwm_mapping", make_protocol_definitions(board_config.pwm_mappings[1])),
@@ -171,12 +203,69 @@ static inline auto make_obj_tree() {
         make_protocol_object("axis0", axes[0]->make_protocol_definitions()),
         make_protocol_object("axis1", axes[1]->make_protocol_definitions()),
         make_protocol_object("can", can1_ctx.make_protocol_definitions()),
+        make_protocol_object("oscilloscope",
+            make_protocol_ro_property("state", &oscilloscope.state_),
+            make_protocol_ro_property("trigger_time_us", &oscilloscope.trigger_time_us_),
+            make_protocol_ro_property("frame_period", &oscilloscope.frame_period_),
+            make_protocol_object("config",
+                make_protocol_property("n_channels", &oscilloscope.config_.n_channels),
+                make_protocol_property("decimation", &oscilloscope.config_.decimation),
+                make_protocol_property("pre_trigger", &oscilloscope.config_.pre_trigger),
+                make_protocol_property("trigger_channel", &oscilloscope.config_.trigger_channel),
+                make_protocol_property("trigger_mode", &oscilloscope.config_.trigger_mode),
+                make_protocol_property("trigger_level", &oscilloscope.config_.trigger_level)
+            ),
+            make_protocol_property("channel0", &oscilloscope_channels[0]),
+            make_protocol_property("channel1", &oscilloscope_channels[1]),
+            make_protocol_property("channel2", &oscilloscope_channels[2]),
+            make_protocol_property("channel3", &oscilloscope_channels[3]),
+            make_protocol_property("channel4", &oscilloscope_channels[4]),
+            make_protocol_property("channel5", &oscilloscope_channels[5]),
+            make_protocol_property("channel6", &oscilloscope_channels[6]),
+            make_protocol_property("channel7", &oscilloscope_channels[7]),
+            make_protocol_function("start", static_functions, &StaticFunctions::start_oscilloscope),
+            make_protocol_function("stop", oscilloscope, &Oscilloscope::stop),
+            make_protocol_function("force_trigger", oscilloscope, &Oscilloscope::force_trigger),
+            make_protocol_function("get_frame_count", oscilloscope, &Oscilloscope::get_frame_count),
+            make_protocol_function("get_channel_count", oscilloscope, &Oscilloscope::get_channel_count),
+            make_protocol_function("get_first_frame", oscilloscope, &Oscilloscope::get_first_frame),
+            make_protocol_function("get_value", oscilloscope, &Oscilloscope::get_value, "frame", "channel"),
+            make_protocol_ro_array("buffer", &oscilloscope_buffer)
+        ),
+        make_protocol_object("telemetry",
+            make_protocol_ro_property("running", &telemetry.running_),
+            make_protocol_object("config",
+                make_protocol_property("n_channels", &telemetry.config_.n_channels),
+                make_protocol_property("decimation", &telemetry.config_.decimation),
+                make_protocol_property("keyframe_interval", &telemetry.config_.keyframe_interval),
+                make_protocol_property("resolution0", &telemetry.config_.resolution[0]),
+                make_protocol_property("resolution1", &telemetry.config_.resolution[1]),
+                make_protocol_property("resolution2", &telemetry.config_.resolution[2]),
+                make_protocol_property("resolution3", &telemetry.config_.resolution[3])
+            ),
+            make_protocol_property("channel0", &telemetry_channels[0]),
+            make_protocol_property("channel1", &telemetry_channels[1]),
+            make_protocol_property("channel2", &telemetry_channels[2]),
+            make_protocol_property("channel3", &telemetry_channels[3]),
+            make_protocol_ro_property("write_count", &telemetry.write_count_),
+            make_protocol_ro_property("last_keyframe", &telemetry.last_keyframe_),
+            make_protocol_ro_property("frame_count", &telemetry.frame_count_),
+            make_protocol_ro_property("frame_period", &telemetry.frame_period_),
+            make_protocol_function("start", static_functions, &StaticFunctions::start_telemetry),
+            make_protocol_function("stop", telemetry, &TelemetryStream::stop),
+            make_protocol_ro_array("buffer", &telemetry_buffer)
+        ),
         make_protocol_property("test_property", &test_property),
         make_protocol_function("test_function", static_functions, &StaticFunctions::test_function, "delta"),
+        make_protocol_function("get_timestamp_us", static_functions, &StaticFunctions::get_timestamp_us),
         make_protocol_function("get_oscilloscope_val", static_functions, &StaticFunctions::get_oscilloscope_val, "index"),
         make_protocol_function("get_adc_voltage", static_functions, &StaticFunctions::get_adc_voltage_, "gpio"),
         make_protocol_function("save_configuration", static_functions, &StaticFunctions::save_configuration_helper),
         make_protocol_function("erase_configuration", static_functions, &StaticFunctions::erase_configuration_helper),
+        make_protocol_function("save_calibration", static_functions, &StaticFunctions::save_calibration_helper),
+        make_protocol_function("erase_calibration", static_functions, &StaticFunctions::erase_calibration_helper),
+        make_protocol_function("move_to_pos_coordinated", static_functions, &StaticFunctions::move_to_pos_coordinated_helper,
+            "goal_point0", "goal_point1"),
         make_protocol_function("reboot", static_functions, &StaticFunctions::NVIC_SystemReset_helper),
         make_protocol_function("enter_dfu_mode", static_functions, &StaticFunctions::enter_dfu_mode_helper)
     );
@@ -200,6 +289,7 @@ void communication_task(void * ctx) {
     // Allow main init to continue
     endpoint_list_valid = true;
     
+    ASCII_protocol_init();
     start_uart_server();
     start_usb_server();
     if (board_config.enable_i2c_instead_of_can) {
@@ -210,7 +300,9 @@ void communication_task(void * ctx) {
     }
 
     for (;;) {
-        osDelay(1000); // nothing to do
+        // keep the GCode moves going while the sender doesn't send lines
+        ASCII_protocol_execute_gcode();
+        osDelay(1);
     }
 }
 
@@ -6,6 +6,7 @@
 #include "crc.hpp"
 #include "cpp_utils.hpp"
 #include <utility>
+#include <algorithm>
 
 struct Request {
     endpoint_id_t endpoint_id;
@@ -208,10 +209,10 @@ VarintStreamEncoder<T> make_varint_encoder(const T& variable) {
     return VarintStreamEncoder<T>(variable);
 }
 
-VarintStreamEncoder<GET_TYPE_OF(&Request::endpoint_id)> make_endpoint_id_encoder(const Request& request) {
+inline VarintStreamEncoder<GET_TYPE_OF(&Request::endpoint_id)> make_endpoint_id_encoder(const Request& request) {
     return make_varint_encoder(request.endpoint_id);
 }
-VarintStreamEncoder<GET_TYPE_OF(&Request::length)> make_length_encoder(const Request& request) {
+inline VarintStreamEncoder<GET_TYPE_OF(&Request::length)> make_length_encoder(const Request& request) {
     return make_varint_encoder(request.length);
 }
 
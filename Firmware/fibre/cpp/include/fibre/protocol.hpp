@@ -531,6 +531,14 @@ inline constexpr const char* get_default_json_modifier<uint16_t>() {
     return "\"type\":\"uint16\",\"access\":\"rw\"";
 }
 template<>
+inline constexpr const char* get_default_json_modifier<const int16_t>() {
+    return "\"type\":\"int16\",\"access\":\"r\"";
+}
+template<>
+inline constexpr const char* get_default_json_modifier<int16_t>() {
+    return "\"type\":\"int16\",\"access\":\"rw\"";
+}
+template<>
 inline constexpr const char* get_default_json_modifier<const uint8_t>() {
     return "\"type\":\"uint8\",\"access\":\"r\"";
 }
@@ -558,6 +566,7 @@ public:
     virtual bool get_string(char * output, size_t length) { return false; }
     virtual bool set_string(char * buffer, size_t length) { return false; }
     virtual bool set_from_float(float value) { return false; }
+    virtual bool get_as_float(float* value) { return false; }
 };
 
 static inline int write_string(const char* str, StreamSink* output) {
@@ -814,6 +823,27 @@ template<typename T>
 bool set_from_float(float value, T* property) {
     return set_from_float_ex<T>(value, property, 0);
 }
+
+template<typename T>
+bool get_as_float_ex(const float* property, float* value, int) {
+    return *value = *property, true;
+}
+template<typename T>
+bool get_as_float_ex(const bool* property, float* value, int) {
+    return *value = (*property ? 1.0f : 0.0f), true;
+}
+template<typename T, typename = std::enable_if_t<std::is_integral<std::remove_const_t<T>>::value && !std::is_same<std::remove_const_t<T>, bool>::value>>
+bool get_as_float_ex(const T* property, float* value, int) {
+    return *value = static_cast<float>(*property), true;
+}
+template<typename T>
+bool get_as_float_ex(const T* property, float* value, ...) {
+    return false;
+}
+template<typename T>
+bool get_as_float(const T* property, float* value) {
+    return get_as_float_ex<T>(property, value, 0);
+}
 }
 
 //template<typename T>
@@ -894,13 +924,21 @@ public:
 
     // special-purpose function - to be moved
     bool set_string(char * buffer, size_t length) final {
-        return from_string(buffer, length, property_, 0);
+        bool wrote = from_string(buffer, length, property_, 0);
+        if (wrote && written_hook_ != nullptr) {
+            written_hook_(ctx_);
+        }
+        return wrote;
     }
 
     bool set_from_float(float value) final {
         return conversion::set_from_float(value, property_);
     }
 
+    bool get_as_float(float* value) final {
+        return conversion::get_as_float(property_, value);
+    }
+
     void register_endpoints(Endpoint** list, size_t id, size_t length) {
         if (id < length)
             list[id] = this;
@@ -952,6 +990,148 @@ ProtocolProperty<const std::underlying_type_t<TProperty>> make_protocol_ro_prope
 };
 
 
+// @brief Length that an array endpoint returns when it is read at this offset
+constexpr uint32_t ARRAY_LENGTH_OFFSET = 0xffffffff;
+
+/* @brief Endpoint for bulk access to an array of POD values.
+*
+* A request starts with a 32 bit offset (in elements), optionally followed by
+* elements to be written at that offset. The response contains the elements
+* from the offset on, as many as fit into the response, or nothing beyond the
+* end of the array. Reading at ARRAY_LENGTH_OFFSET returns the current length
+* as a 32 bit integer.
+*
+* The elements are streamed straight from and into the backing memory, so
+* the array must be stored in little endian byte order. The array is either
+* fixed or referenced through a pointer and a length that may change at
+* runtime, for example when it is allocated after the endpoints are published.
+*/
+template<typename T>
+class ProtocolArray : public Endpoint {
+public:
+    static_assert(std::is_arithmetic<T>::value, "array elements must be arithmetic types");
+    static_assert(__BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__, "array endpoints require a little endian target");
+
+    static constexpr const char * json_modifier = get_default_json_modifier<T>();
+    static constexpr size_t endpoint_count = 1;
+
+    ProtocolArray(const char * name, T* data, size_t length, T* const* data_ref, const uint32_t* length_ref,
+                  void (*written_hook)(void*), void* ctx)
+        : name_(name), data_(data), length_(length), data_ref_(data_ref), length_ref_(length_ref),
+          written_hook_(written_hook), ctx_(ctx)
+    {}
+
+    void write_json(size_t id, StreamSink* output) {
+        write_string("{\"name\":\"", output);
+        write_string(name_, output);
+
+        // write endpoint ID
+        write_string("\",\"id\":", output);
+        char id_buf[10];
+        snprintf(id_buf, sizeof(id_buf), "%u", (unsigned)id); // TODO: get rid of printf
+        write_string(id_buf, output);
+
+        // The length is not part of the JSON because it can change after
+        // the JSON CRC was calculated.
+        write_string(",\"type\":\"array\",\"element\":{", output);
+        write_string(json_modifier, output);
+        write_string("}}", output);
+    }
+
+    // special-purpose function - to be moved
+    Endpoint* get_by_name(const char * name, size_t length) {
+        if (!strncmp(name, name_, length))
+            return this;
+        else
+            return nullptr;
+    }
+
+    void register_endpoints(Endpoint** list, size_t id, size_t length) {
+        if (id < length)
+            list[id] = this;
+    }
+
+    void handle(const uint8_t* input, size_t input_length, StreamSink* output) final {
+        if (input_length < 4)
+            return;
+        uint32_t offset = read_le<uint32_t>(&input, &input_length);
+        T* data = data_ref_ ? *data_ref_ : data_;
+        size_t length = !data ? 0 : length_ref_ ? *length_ref_ : length_;
+
+        if (offset == ARRAY_LENGTH_OFFSET) {
+            if (output && output->get_free_space() >= 4) {
+                uint8_t buffer[4];
+                write_le<uint32_t>(static_cast<uint32_t>(length), buffer);
+                output->process_bytes(buffer, sizeof(buffer), nullptr);
+            }
+            return;
+        }
+        if (offset >= length)
+            return;
+
+        // Read the old values into output
+        if (output) {
+            size_t count = output->get_free_space() / sizeof(T);
+            if (count > length - offset)
+                count = length - offset;
+            if (count)
+                output->process_bytes(reinterpret_cast<const uint8_t*>(data + offset), count * sizeof(T), nullptr);
+        }
+
+        // If new values were passed, write as many complete elements as fit
+        size_t count = input_length / sizeof(T);
+        if (count > length - offset)
+            count = length - offset;
+        if (count && write_elements(data + offset, input, count) && written_hook_ != nullptr)
+            written_hook_(ctx_);
+    }
+
+    const char* name_;
+    T* data_;
+    size_t length_;
+    T* const* data_ref_;
+    const uint32_t* length_ref_;
+    void (*written_hook_)(void*);
+    void* ctx_;
+
+private:
+    template<typename U = T>
+    static std::enable_if_t<!std::is_const<U>::value, bool>
+    write_elements(U* dst, const uint8_t* src, size_t count) {
+        memcpy(dst, src, count * sizeof(U));
+        return true;
+    }
+    template<typename U = T>
+    static std::enable_if_t<std::is_const<U>::value, bool>
+    write_elements(U* dst, const uint8_t* src, size_t count) {
+        return false; // We don't ever write to const types
+    }
+};
+
+// Fixed arrays
+template<typename T, size_t N>
+ProtocolArray<T> make_protocol_array(const char * name, T (*data)[N],
+        void (*written_hook)(void*) = nullptr, void* ctx = nullptr) {
+    return ProtocolArray<T>(name, *data, N, nullptr, nullptr, written_hook, ctx);
+}
+
+template<typename T, size_t N>
+ProtocolArray<const T> make_protocol_ro_array(const char * name, T (*data)[N]) {
+    return ProtocolArray<const T>(name, *data, N, nullptr, nullptr, nullptr, nullptr);
+}
+
+// Arrays that are allocated or resized at runtime
+template<typename T>
+ProtocolArray<T> make_protocol_array(const char * name, T* const* data, const uint32_t* length,
+        void (*written_hook)(void*) = nullptr, void* ctx = nullptr) {
+    return ProtocolArray<T>(name, nullptr, 0, data, length, written_hook, ctx);
+}
+
+template<typename T>
+ProtocolArray<const T> make_protocol_ro_array(const char * name, T* const* data, const uint32_t* length) {
+    return ProtocolArray<const T>(name, nullptr, 0, data, length, nullptr, nullptr);
+}
+
 template<typename ... TArgs>
 struct PropertyListFactory;
 
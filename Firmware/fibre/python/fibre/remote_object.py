@@ -29,6 +29,28 @@ class StructCodec():
         value = struct.unpack(self._struct_format, buffer)
         value = value[0] if len(value) == 1 else value
         return self._target_type(value)
+    def serialize_array(self, values):
+        return struct.pack(self._array_format(len(values)), *[self._target_type(v) for v in values])
+    def deserialize_array(self, buffer):
+        count = len(buffer) // self.get_length()
+        return [self._target_type(v) for v in struct.unpack(self._array_format(count), buffer[:count * self.get_length()])]
+    def _array_format(self, count):
+        return self._struct_format[0] + str(count) + self._struct_format[1:]
+
+def get_codec(type_str):
+    """
+    Returns (type, codec) for a type name in the JSON definition
+    """
+    # Find all codecs that match the type_str and build a dictionary
+    # of the form {type1: codec1, type2: codec2}
+    eligible_types = {k: v[type_str] for (k,v) in codecs.items() if type_str in v}
+
+    if not eligible_types:
+        raise ObjectDefinitionError("unsupported codec {}".format(type_str))
+
+    # TODO: better heuristics to select a matching type (i.e. prefer non lossless)
+    eligible_types = list(eligible_types.items())
+    return eligible_types[0]
 
 class RemoteProperty():
     """
@@ -52,17 +74,7 @@ class RemoteProperty():
         if type_str is None:
             raise ObjectDefinitionError("unspecified type")
 
-        # Find all codecs that match the type_str and build a dictionary
-        # of the form {type1: codec1, type2: codec2}
-        eligible_types = {k: v[type_str] for (k,v) in codecs.items() if type_str in v}
-        
-        if not eligible_types:
-            raise ObjectDefinitionError("unsupported codec {}".format(type_str))
-
-        # TODO: better heuristics to select a matching type (i.e. prefer non lossless)
-        eligible_types = list(eligible_types.items())
-        self._property_type = eligible_types[0][0]
-        self._codec = eligible_types[0][1]
+        (self._property_type, self._codec) = get_codec(type_str)
 
         access_mode = json_data.get("access", "r")
         self._can_read = 'r' in access_mode
@@ -105,6 +117,96 @@ class EndpointRefCodec():
     def deserialize(self, buffer):
         return struct.unpack("<HH", buffer)
 
+class RemoteArray():
+    """
+    Used internally by dynamically created objects to read and write
+    ranges of an array endpoint with as few requests as possible.
+    Supports len(), indexing and slicing.
+    """
+    LENGTH_OFFSET = 0xffffffff
+    MAX_WRITE_SIZE = 96 # [bytes] per request, requests must stay below 128 bytes
+    MAX_READ_SIZE = 512 # [bytes] per request, the device may return less
+
+    def __init__(self, json_data, parent):
+        self._parent = parent
+        self.__channel__ = parent.__channel__
+        id_str = json_data.get("id", None)
+        if id_str is None:
+            raise ObjectDefinitionError("unspecified endpoint ID")
+        self._id = int(id_str)
+
+        self._name = json_data.get("name", None)
+        if self._name is None:
+            self._name = "[anonymous]"
+
+        element_json = json_data.get("element", None)
+        if element_json is None or element_json.get("type", None) is None:
+            raise ObjectDefinitionError("unspecified element type")
+        (self._element_type, self._codec) = get_codec(element_json["type"])
+        if not isinstance(self._codec, StructCodec):
+            raise ObjectDefinitionError("unsupported element type {}".format(element_json["type"]))
+
+        access_mode = element_json.get("access", "r")
+        self._can_read = 'r' in access_mode
+        self._can_write = 'w' in access_mode
+
+    def get_length(self):
+        buffer = self.__channel__.remote_endpoint_operation(self._id, struct.pack("<I", RemoteArray.LENGTH_OFFSET), True, 4)
+        return struct.unpack("<I", buffer)[0]
+
+    def read(self, offset=0, count=None):
+        """
+        Returns count elements from offset on (all elements if count is None)
+        """
+        if count is None:
+            count = self.get_length() - offset
+        element_size = self._codec.get_length()
+        values = []
+        while len(values) < count:
+            chunk_length = min((count - len(values)) * element_size, RemoteArray.MAX_READ_SIZE)
+            chunk = self.__channel__.remote_endpoint_operation(self._id, struct.pack("<I", offset + len(values)), True, chunk_length)
+            if len(chunk) < element_size:
+                break # end of the array
+            values += self._codec.deserialize_array(chunk)
+        return values[:count]
+
+    def write(self, values, offset=0):
+        if not self._can_write:
+            raise Exception("Cannot write to array {}".format(self._name))
+        values = list(values)
+        chunk_count = max(RemoteArray.MAX_WRITE_SIZE // self._codec.get_length(), 1)
+        for i in range(0, len(values), chunk_count):
+            buffer = struct.pack("<I", offset + i) + self._codec.serialize_array(values[i:i + chunk_count])
+            self.__channel__.remote_endpoint_operation(self._id, buffer, True, 0)
+
+    def __len__(self):
+        return self.get_length()
+
+    def __getitem__(self, index):
+        if isinstance(index, slice):
+            (start, stop, step) = index.indices(self.get_length())
+            return self.read(start, max(stop - start, 0))[::step]
+        if index < 0:
+            index += self.get_length()
+        values = self.read(index, 1)
+        if not values:
+            raise IndexError("array index out of range")
+        return values[0]
+
+    def __setitem__(self, index, value):
+        if isinstance(index, slice):
+            (start, stop, step) = index.indices(self.get_length())
+            if step != 1:
+                raise ValueError("only contiguous slices can be written")
+            self.write(value, start)
+        else:
+            if index < 0:
+                index += self.get_length()
+            self.write([value], index)
+
+    def _dump(self):
+        return "{} = array of {} {}".format(self._name, self.get_length(), self._element_type.__name__)
+
 codecs[int] = {
     'int8': StructCodec("<b", int),
     'uint8': StructCodec("<B", int),
@@ -198,6 +300,8 @@ class RemoteObject(object):
                     attribute = RemoteObject(member_json, self, channel, logger)
                 elif type_str == "function":
                     attribute = RemoteFunction(member_json, self)
+                elif type_str == "array":
+                    attribute = RemoteArray(member_json, self)
                 elif type_str != None:
                     attribute = RemoteProperty(member_json, self)
                 else:
@@ -252,6 +356,8 @@ class RemoteObject(object):
                 attr.set_value(value)
             else:
                 raise Exception("Cannot write to property {}".format(name))
+        elif isinstance(attr, RemoteArray):
+            attr.write(value)
         elif not object.__getattribute__(self, "__sealed__") or name in object.__getattribute__(self, "__dict__"):
             object.__getattribute__(self, "__dict__")[name] = value
         else:
@@ -0,0 +1,41 @@
+-- Host unit tests for the platform independent parts of the firmware.
+-- Enable with CONFIG_BUILD_FIRMWARE_TESTS=true in tup.config, then run build/run_tests.elf
+
+tup.include('../build.lua')
+
+if tup.getconfig("BUILD_FIRMWARE_TESTS") == "true" then
+    toolchain = GCCToolchain('', 'build', {'-O2', '-g', '-Wall', '-pthread'}, {'-lm', '-pthread'})
+
+    build{
+        name='run_tests',
+        toolchains={toolchain},
+        sources={
+            'run_tests.cpp',
+            'test_pll.cpp',
+            'test_cogging_map.cpp',
+            'test_cogging_sweep.cpp',
+            'test_calibration_store.cpp',
+            'test_scurve.cpp',
+            'test_pvt.cpp',
+            'test_traj_stepper.cpp',
+            'test_motion_planner.cpp',
+            'test_timed_setpoint.cpp',
+            'test_step_counter.cpp',
+            'test_gearing.cpp',
+            'test_command_schedule.cpp',
+            'test_setpoint_mailbox.cpp',
+            'test_timing_stats.cpp',
+            'test_oscilloscope.cpp',
+            'test_protocol_array.cpp',
+            'test_telemetry.cpp',
+            'test_axis_isr_table.cpp',
+            'test_hall_sampler.cpp',
+            '../MotorControl/scurveTraj.cpp'
+        },
+        includes={
+            '../MotorControl',
+            '../fibre/cpp/include',
+            '.'
+        }
+    }
+end
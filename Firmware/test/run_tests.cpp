@@ -0,0 +1,65 @@
+#include <stdio.h>
+
+bool pll_test();
+bool pll_benchmark();
+bool cogging_map_test();
+bool cogging_map_benchmark();
+bool cogging_sweep_test();
+bool calibration_store_test();
+bool scurve_test();
+bool scurve_benchmark();
+bool pvt_test();
+bool traj_stepper_test();
+bool traj_stepper_benchmark();
+bool motion_planner_test();
+bool timed_setpoint_test();
+bool step_counter_test();
+bool gearing_test();
+bool command_schedule_test();
+bool setpoint_mailbox_test();
+bool timing_stats_test();
+bool oscilloscope_test();
+bool protocol_array_test();
+bool telemetry_test();
+bool telemetry_benchmark();
+bool axis_isr_table_test();
+bool hall_sampler_test();
+
+int main(int argc, const char** argv) {
+    bool (*tests[])() = {
+        pll_test,
+        pll_benchmark,
+        cogging_map_test,
+        cogging_map_benchmark,
+        cogging_sweep_test,
+        calibration_store_test,
+        scurve_test,
+        scurve_benchmark,
+        pvt_test,
+        traj_stepper_test,
+        traj_stepper_benchmark,
+        motion_planner_test,
+        timed_setpoint_test,
+        step_counter_test,
+        gearing_test,
+        command_schedule_test,
+        setpoint_mailbox_test,
+        timing_stats_test,
+        oscilloscope_test,
+        protocol_array_test,
+        telemetry_test,
+        telemetry_benchmark,
+        axis_isr_table_test,
+        hall_sampler_test,
+    };
+
+    for (size_t i = 0; i < sizeof(tests) / sizeof(tests[0]); ++i) {
+        if (!tests[i]()) {
+            printf("some tests failed\n");
+            return 1;
+        }
+    }
+
+    printf("all tests passed\n");
+    return 0;
+}
@@ -0,0 +1,109 @@
+#include <stddef.h>
+#include <stdint.h>
+
+#include "test_utils.hpp"
+#include <axis_isr_table.hpp>
+
+// Stand-ins for the HAL handles, only their addresses matter
+struct MockTimer { int id; };
+struct MockAdc { int id; };
+struct MockSpi { int id; };
+
+static MockTimer htim1, htim8, htim_extra;
+static MockAdc hadc1, hadc2, hadc3, hadc_extra_b, hadc_extra_c;
+static MockSpi hspi3, hspi_extra;
+
+// The same layout as axis_isr_table in board_config_v3.h
+typedef AxisIsrTable<MockTimer, MockAdc, MockSpi, 2> TwoAxisTable_t;
+static const TwoAxisTable_t two_axes = { {
+    { &htim1, &hadc2, &hadc3, true, false, 1, &hspi3 },
+    { &htim8, &hadc2, &hadc3, false, true, 0, &hspi3 },
+} };
+
+// @brief The dispatch of a two axis board matches what pwm_trig_adc_cb did
+// before it was table driven: M0 injected, M1 regular conversions, the
+// timings of M1 are loaded at the current measurement of M0 and those of
+// M0 at the DC calibration sample of M1.
+static bool axis_isr_table_two_axes_test() {
+    MockAdc* adcs[] = { &hadc2, &hadc3 };
+    for (int injected = 0; injected < 2; ++injected) {
+        for (MockAdc* adc : adcs) {
+            for (int counting_down = 0; counting_down < 2; ++counting_down) {
+                size_t axis = 99;
+                TEST_ASSERT(two_axes.find_adc(adc, injected, &axis), "no axis for adc %d injected %d", adc->id, injected);
+                size_t expected_axis = injected ? 0 : 1;
+                TEST_ASSERT(axis == expected_axis, "axis %zu", axis);
+
+                TwoAxisTable_t::AdcEvent_t event = two_axes.get_adc_event(axis, adc, counting_down);
+                bool is_adc2 = adc == &hadc2;
+                bool expected_load = is_adc2 && ((axis == 1 && counting_down) || (axis == 0 && !counting_down));
+                TEST_ASSERT(event.axis == axis && event.phB == is_adc2, "phB %d", event.phB);
+                TEST_ASSERT(event.current_meas == !counting_down, "current_meas %d", event.current_meas);
+                TEST_ASSERT(event.load_timings == expected_load, "load_timings %d axis %zu down %d", event.load_timings, axis, counting_down);
+                TEST_ASSERT(!expected_load || event.timings_axis == 1 - axis, "timings of axis %zu", event.timings_axis);
+                TEST_ASSERT(event.meas_complete == (!counting_down && !is_adc2), "meas_complete %d", event.meas_complete);
+                TEST_ASSERT(event.control_tick == (event.meas_complete && axis == 0), "control_tick %d", event.control_tick);
+            }
+        }
+    }
+
+    size_t axis;
+    TEST_ASSERT(!two_axes.find_adc(&hadc1, true, &axis), "hadc1 belongs to no axis");
+
+    TEST_ASSERT(two_axes.find_timer(&htim1) == 0 && two_axes.find_timer(&htim8) == 1, "timers");
+    TEST_ASSERT(two_axes.find_timer(&htim_extra) == -1, "unknown timer");
+
+    // both encoders share SPI3 and are told apart by the receive buffer
+    uint16_t rx_buffers[2][1];
+    auto get_rx_buffer = [&](size_t i) { return (const void*)rx_buffers[i]; };
+    TEST_ASSERT(two_axes.find_spi_transfer(&hspi3, rx_buffers[1], get_rx_buffer) == 1, "spi axis 1");
+    TEST_ASSERT(two_axes.find_spi_transfer(&hspi3, rx_buffers[0], get_rx_buffer) == 0, "spi axis 0");
+    TEST_ASSERT(two_axes.find_spi_transfer(&hspi_extra, rx_buffers[0], get_rx_buffer) == -1, "other spi");
+    return true;
+}
+
+// @brief A board with a third axis on its own ADC pair: every current
+// measurement of each axis completes exactly once per period and the
+// timings of every axis are loaded exactly once per period.
+static bool axis_isr_table_three_axes_test() {
+    typedef AxisIsrTable<MockTimer, MockAdc, MockSpi, 3> ThreeAxisTable_t;
+    static const ThreeAxisTable_t three_axes = { {
+        { &htim1, &hadc2, &hadc3, true, false, 1, &hspi3 },
+        { &htim8, &hadc2, &hadc3, false, true, 0, &hspi3 },
+        { &htim_extra, &hadc_extra_b, &hadc_extra_c, false, false, 2, &hspi_extra },
+    } };
+
+    // the callbacks of one PWM period: both directions, both phases of every axis
+    uint32_t meas_complete[3] = {}, timings_loaded[3] = {}, ticks = 0;
+    for (size_t i = 0; i < 3; ++i) {
+        const ThreeAxisTable_t::Descriptor_t& desc = three_axes.descriptors[i];
+        for (int counting_down = 0; counting_down < 2; ++counting_down) {
+            MockAdc* adcs[] = { desc.adc_phB, desc.adc_phC };
+            for (MockAdc* adc : adcs) {
+                size_t axis;
+                TEST_ASSERT(three_axes.find_adc(adc, desc.injected, &axis) && axis == i, "axis %zu not found", i);
+                ThreeAxisTable_t::AdcEvent_t event = three_axes.get_adc_event(axis, adc, counting_down);
+                meas_complete[axis] += event.meas_complete;
+                ticks += event.control_tick;
+                if (event.load_timings)
+                    ++timings_loaded[event.timings_axis];
+            }
+        }
+    }
+    for (size_t i = 0; i < 3; ++i) {
+        TEST_ASSERT(meas_complete[i] == 1, "axis %zu: %u measurements", i, meas_complete[i]);
+        TEST_ASSERT(timings_loaded[i] == 1, "axis %zu: timings loaded %u times", i, timings_loaded[i]);
+    }
+    TEST_ASSERT(ticks == 1, "%u control ticks per period", ticks);
+
+    // the third axis is found by its own handles only
+    size_t axis;
+    TEST_ASSERT(!three_axes.find_adc(&hadc_extra_b, true, &axis), "wrong conversion type");
+    TEST_ASSERT(three_axes.find_timer(&htim_extra) == 2, "timer of axis 2");
+    return true;
+}
+
+bool axis_isr_table_test() {
+    return axis_isr_table_two_axes_test()
+        && axis_isr_table_three_axes_test();
+}
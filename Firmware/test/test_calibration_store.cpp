@@ -0,0 +1,100 @@
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+
+#include "test_utils.hpp"
+#include <calibration_store.hpp>
+#include <cogging_map.hpp>
+
+// RAM stand-in for the flash sector: erase sets all bits, programming can only clear bits
+static uint8_t flash[0x20000];
+
+static int ram_erase(void) {
+    memset(flash, 0xff, sizeof(flash));
+    return 0;
+}
+
+static int ram_program(size_t offset, const uint8_t* data, size_t length) {
+    if (offset + length > sizeof(flash))
+        return -1;
+    for (size_t i = 0; i < length; ++i)
+        flash[offset + i] &= data[i];
+    return 0;
+}
+
+static bool calibration_store_records_test() {
+    CalibrationStore store(flash, sizeof(flash), ram_erase, ram_program);
+    ram_erase();
+    size_t length = 0;
+    TEST_ASSERT(!store.is_valid(), "erased region is valid");
+    TEST_ASSERT(!store.find(1, 0, 1, &length), "found record in erased region");
+
+    const char a[] = "first record";
+    const uint32_t b[] = { 1, 2, 3, 4, 5 };
+    TEST_ASSERT(!store.begin_store(), "begin_store failed");
+    TEST_ASSERT(!store.append(1, 0, 1, a, sizeof(a)), "append failed");
+    TEST_ASSERT(!store.append(1, 1, 1, b, 2 * sizeof(uint32_t), b + 2, 3 * sizeof(uint32_t)), "append failed");
+    // interrupted before commit: nothing may be found
+    TEST_ASSERT(!store.is_valid(), "uncommitted region is valid");
+    TEST_ASSERT(!store.find(1, 0, 1, &length), "found uncommitted record");
+
+    TEST_ASSERT(!store.commit(), "commit failed");
+    TEST_ASSERT(store.is_valid(), "committed region is invalid");
+    const uint8_t* payload = store.find(1, 0, 1, &length);
+    TEST_ASSERT(payload && length == sizeof(a) && !memcmp(payload, a, sizeof(a)), "record 0 mismatch");
+    payload = store.find(1, 1, 1, &length);
+    TEST_ASSERT(payload && length == sizeof(b) && !memcmp(payload, b, sizeof(b)), "record 1 mismatch");
+    TEST_ASSERT(!store.find(1, 1, 2, &length), "found record with wrong version");
+    TEST_ASSERT(!store.find(2, 0, 1, &length), "found record with wrong type");
+
+    // corrupt the payload of the second record
+    size_t offset = (size_t)(payload - flash);
+    flash[offset] &= 0xf0;
+    TEST_ASSERT(!store.find(1, 1, 1, &length), "found corrupted record");
+    TEST_ASSERT(store.find(1, 0, 1, &length), "corruption affected another record");
+
+    // running out of space
+    TEST_ASSERT(!store.begin_store(), "begin_store failed");
+    TEST_ASSERT(store.append(1, 0, 1, flash, sizeof(flash)), "oversized record accepted");
+
+    store.erase();
+    TEST_ASSERT(!store.is_valid(), "erased region is valid");
+    return true;
+}
+
+static bool calibration_store_cogging_map_test() {
+    CalibrationStore store(flash, sizeof(flash), ram_erase, ram_program);
+    CoggingMap map;
+    TEST_ASSERT(map.allocate(8192, 4.0f, 0.001f), "allocation failed");
+    map.add_harmonic(84, 0.2f, -0.1f);
+
+    TEST_ASSERT(!store.begin_store(), "begin_store failed");
+    TEST_ASSERT(!map.store(store, 1), "store failed");
+    TEST_ASSERT(!store.commit(), "commit failed");
+
+    CoggingMap restored;
+    TEST_ASSERT(restored.allocate(8192, 4.0f, 0.001f), "allocation failed");
+    TEST_ASSERT(!restored.load(store, 0), "loaded map of the wrong axis");
+    TEST_ASSERT(restored.load(store, 1), "load failed");
+    for (float pos = -100.0f; pos < 9000.0f; pos += 0.7f)
+        TEST_ASSERT(restored.eval(pos) == map.eval(pos), "mismatch at %f", (double)pos);
+
+    // the restored map must wait until the encoder zero is the same as when it was recorded
+    TEST_ASSERT(!CoggingMap::is_aligned(false, false), "applied with an unreferenced incremental encoder");
+    TEST_ASSERT(CoggingMap::is_aligned(false, true), "not applied after the index was found");
+    TEST_ASSERT(CoggingMap::is_aligned(true, false), "not applied with an absolute encoder");
+
+    // a map made for another configuration must not be used
+    TEST_ASSERT(restored.allocate(8192, 8.0f, 0.001f), "allocation failed");
+    TEST_ASSERT(!restored.load(store, 1), "loaded map with a different stride");
+    TEST_ASSERT(restored.allocate(8192, 4.0f, 0.002f), "allocation failed");
+    TEST_ASSERT(!restored.load(store, 1), "loaded map with a different scale");
+    TEST_ASSERT(restored.allocate(4096, 2.0f, 0.001f), "allocation failed");
+    TEST_ASSERT(!restored.load(store, 1), "loaded map with a different cpr");
+    return true;
+}
+
+bool calibration_store_test() {
+    return calibration_store_records_test()
+        && calibration_store_cogging_map_test();
+}
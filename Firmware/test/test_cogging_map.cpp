@@ -0,0 +1,127 @@
+#include <stddef.h>
+#include <stdint.h>
+
+#include "test_utils.hpp"
+#include <cogging_map.hpp>
+
+static bool cogging_map_interpolation_test() {
+    const int32_t cpr = 8192;
+    CoggingMap map;
+    TEST_ASSERT(map.allocate(cpr, 4.0f, 0.001f), "allocation failed");
+    TEST_ASSERT(map.n_samples_ == 2048 && map.stride_ == 4.0f, "n %u stride %f", map.n_samples_, (double)map.stride_);
+
+    map.set_sample(0, 1.0f);
+    map.set_sample(1, 2.0f);
+    map.set_sample(map.n_samples_ - 1, -1.0f);
+    TEST_ASSERT(fabsf(map.eval(0.0f) - 1.0f) < 1e-6f, "%f", (double)map.eval(0.0f));
+    TEST_ASSERT(fabsf(map.eval(2.0f) - 1.5f) < 1e-6f, "%f", (double)map.eval(2.0f));
+    TEST_ASSERT(fabsf(map.eval(4.0f) - 2.0f) < 1e-6f, "%f", (double)map.eval(4.0f));
+    // negative positions and positions beyond one turn wrap around
+    TEST_ASSERT(fabsf(map.eval(-2.0f) - 0.0f) < 1e-6f, "%f", (double)map.eval(-2.0f));
+    TEST_ASSERT(fabsf(map.eval(-4.0f) + 1.0f) < 1e-6f, "%f", (double)map.eval(-4.0f));
+    TEST_ASSERT(fabsf(map.eval(3.0f * cpr + 2.0f) - 1.5f) < 1e-6f, "%f", (double)map.eval(3.0f * cpr + 2.0f));
+    TEST_ASSERT(fabsf(map.eval(-3.0f * cpr + 2.0f) - 1.5f) < 1e-6f, "%f", (double)map.eval(-3.0f * cpr + 2.0f));
+    // beyond the int32_t range and a negative position that rounds to one revolution
+    TEST_ASSERT(fabsf(map.eval(1e12f) - map.eval(fmodf(1e12f, (float)cpr))) < 1e-6f, "%f", (double)map.eval(1e12f));
+    TEST_ASSERT(fabsf(map.eval(-1e-6f) - 1.0f) < 1e-3f, "%f", (double)map.eval(-1e-6f));
+    TEST_ASSERT(map.eval(NAN) == 0.0f, "%f", (double)map.eval(NAN));
+
+    // saturation instead of overflow
+    map.set_sample(2, 100.0f);
+    TEST_ASSERT(fabsf(map.get_sample(2) - 32.767f) < 1e-4f, "%f", (double)map.get_sample(2));
+    TEST_ASSERT(map.get_sample(map.n_samples_) == 0.0f, "out of range read");
+
+    // a stride that doesn't divide the cpr gets adjusted
+    TEST_ASSERT(map.allocate(2400, 7.0f, 0.001f), "allocation failed");
+    TEST_ASSERT(map.n_samples_ == 343, "n %u", map.n_samples_);
+    TEST_ASSERT(fabsf(map.stride_ * (float)map.n_samples_ - 2400.0f) < 1e-3f, "stride %f", (double)map.stride_);
+    TEST_ASSERT(map.get_sample(0) == 0.0f, "map not cleared");
+
+    TEST_ASSERT(!map.allocate(2400, 0.0f, 0.001f), "invalid stride accepted");
+    TEST_ASSERT(map.n_samples_ == 0, "failed allocation left samples");
+
+    // the protocol functions must not touch an unallocated map
+    map.clear();
+    map.set_sample(0, 1.0f);
+    map.add_harmonic(1, 1.0f, 0.0f);
+    TEST_ASSERT(map.get_sample(0) == 0.0f && !map.samples_, "unallocated map written");
+    return true;
+}
+
+static bool cogging_map_harmonic_test() {
+    const int32_t cpr = 2400;
+    const uint32_t stator_slots = 12;
+    const uint32_t pole_pairs = 7;
+    CoggingMap map;
+    TEST_ASSERT(map.allocate(cpr, 2.0f, 0.0005f), "allocation failed");
+
+    map.add_harmonic(0, 0.05f, 0.0f);
+    map.add_harmonic(stator_slots, 0.3f, -0.2f);
+    map.add_harmonic(2 * pole_pairs, 0.0f, 0.1f);
+
+    for (int pos = -cpr; pos < 2 * cpr; pos += 7) {
+        float theta = 2.0f * M_PI * (float)pos / (float)cpr;
+        float expected = 0.05f
+                + 0.3f * cosf(stator_slots * theta) - 0.2f * sinf(stator_slots * theta)
+                + 0.1f * sinf(2 * pole_pairs * theta);
+        float actual = map.eval((float)pos);
+        // quantization plus linear interpolation error of the highest harmonic
+        TEST_ASSERT(fabsf(actual - expected) < 0.01f, "pos %d: %f, expected %f", pos, (double)actual, (double)expected);
+    }
+    return true;
+}
+
+bool cogging_map_test() {
+    return cogging_map_interpolation_test()
+        && cogging_map_harmonic_test();
+}
+
+// Same as mod() in utils.c, which lives in its own translation unit
+__attribute__((noinline)) static int firmware_mod(int dividend, int divisor) {
+    int r = dividend % divisor;
+    return (r < 0) ? (r + divisor) : r;
+}
+
+// Compares the map lookup against the previous one float per count table
+bool cogging_map_benchmark() {
+    const int32_t cpr = 8192;
+    const int n_steps = 10000000;
+    CoggingMap map;
+    TEST_ASSERT(map.allocate(cpr, 4.0f, 0.001f), "allocation failed");
+    map.add_harmonic(84, 0.2f, 0.1f);
+    float* table = (float*)malloc(cpr * sizeof(float));
+    for (int32_t i = 0; i < cpr; ++i)
+        table[i] = map.eval((float)i);
+
+    // the firmware reads the cpr from the config, so don't let the compiler
+    // turn the modulo into a bit mask
+    volatile int32_t cpr_config = cpr;
+    int32_t table_cpr = cpr_config;
+
+    // the control loop passes pos_cpr plus the position error, which stays
+    // close to one revolution
+    float sum_table = 0.0f;
+    double t0 = test_time_s();
+    for (int i = 0; i < n_steps; ++i) {
+        float pos = (float)(i & 0x7fff) * 0.37f - 0.25f * cpr;
+        sum_table += table[firmware_mod(static_cast<int>(pos), table_cpr)];
+    }
+    double t_table = (test_time_s() - t0) * 1e9 / n_steps;
+
+    float sum_map = 0.0f;
+    t0 = test_time_s();
+    for (int i = 0; i < n_steps; ++i) {
+        float pos = (float)(i & 0x7fff) * 0.37f - 0.25f * cpr;
+        sum_map += map.eval(pos);
+    }
+    double t_map = (test_time_s() - t0) * 1e9 / n_steps;
+    free(table);
+
+    printf("cogging map benchmark: float table %.1f ns/lookup (%.1f kB, sum %.1f), int16 map %.1f ns/lookup (%.1f kB, sum %.1f)\n",
+            t_table, cpr * sizeof(float) / 1024.0, (double)sum_table,
+            t_map, map.n_samples_ * sizeof(int16_t) / 1024.0, (double)sum_map);
+    // the map interpolates between two samples, which costs a few conversions
+    // more than the single load of the table, but no division
+    TEST_ASSERT(t_map < 1.75 * t_table, "map lookup is much slower than the float table");
+    return true;
+}
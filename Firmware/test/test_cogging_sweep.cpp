@@ -0,0 +1,94 @@
+#include <stddef.h>
+#include <stdint.h>
+
+#include "test_utils.hpp"
+#include <cogging_sweep.hpp>
+
+static const float dt = 1.0f / 8000.0f;
+static const int32_t cpr = 8192;
+
+// Simulated motor: cogging from stator slots and magnet poles, constant
+// Coulomb friction and some measurement noise
+static float cogging_profile(float pos) {
+    float theta = 2.0f * M_PI * pos / (float)cpr;
+    return 0.2f * cosf(84.0f * theta) + 0.1f * sinf(12.0f * theta) + 0.05f * cosf(7.0f * theta + 1.0f);
+}
+
+static uint32_t lcg_state = 1;
+static float noise(float amplitude) {
+    lcg_state = lcg_state * 1664525u + 1013904223u;
+    return amplitude * ((float)(lcg_state >> 8) / (float)(1 << 24) * 2.0f - 1.0f);
+}
+
+// Moves the simulated motor at exactly the commanded velocity and feeds the
+// current needed to do so into the sweep, like Controller::update() does.
+// @returns the simulated duration [s], or -1 on timeout
+static float run_sweep(CoggingSweep& sweep, CoggingMap& map, float vel, float friction) {
+    float pos = 123.4f;
+    sweep.start(&map, pos);
+    for (int i = 0; i < 8000 * 120; ++i) {
+        float dir = sweep.get_direction();
+        pos += dir * vel * dt;
+        float current = cogging_profile(pos) + dir * friction + noise(0.02f);
+        if (sweep.update(pos, current))
+            return (float)i * dt;
+    }
+    return -1.0f;
+}
+
+static bool cogging_sweep_binning_test() {
+    CoggingMap map;
+    TEST_ASSERT(map.allocate(cpr, 4.0f, 0.001f), "allocation failed");
+    CoggingSweep sweep;
+
+    const float friction = 0.15f;
+    float duration = run_sweep(sweep, map, 2000.0f, friction);
+    TEST_ASSERT(duration > 0.0f, "sweep did not finish");
+    TEST_ASSERT(duration < 15.0f, "sweep took %f s", (double)duration);
+    TEST_ASSERT(sweep.state_ == CoggingSweep::STATE_DONE, "state %d", sweep.state_);
+    TEST_ASSERT(sweep.progress_ == 1.0f, "progress %f", (double)sweep.progress_);
+    TEST_ASSERT(sweep.missed_bins_ == 0, "missed %u bins", sweep.missed_bins_);
+    TEST_ASSERT(fabsf(sweep.friction_ - friction) < 0.005f, "friction %f", (double)sweep.friction_);
+    TEST_ASSERT(sweep.asymmetry_ < 0.01f, "asymmetry %f", (double)sweep.asymmetry_);
+    TEST_ASSERT(fabsf(sweep.ripple_ - 0.65f) < 0.1f, "ripple %f", (double)sweep.ripple_);
+
+    float max_err = 0.0f;
+    for (int32_t pos = 0; pos < cpr; ++pos) {
+        float err = fabsf(map.eval((float)pos) - cogging_profile((float)pos));
+        if (err > max_err)
+            max_err = err;
+    }
+    // bin averaging flattens the 84th harmonic a little
+    TEST_ASSERT(max_err < 0.03f, "max map error %f A", (double)max_err);
+    printf("cogging sweep: %.1f s at 8192 CPR, max map error %.4f A\n", (double)duration, (double)max_err);
+    return true;
+}
+
+static bool cogging_sweep_too_fast_test() {
+    CoggingMap map;
+    TEST_ASSERT(map.allocate(cpr, 4.0f, 0.001f), "allocation failed");
+    CoggingSweep sweep;
+    // 10 counts per cycle skips bins of 4 counts
+    float duration = run_sweep(sweep, map, 80000.0f, 0.1f);
+    TEST_ASSERT(duration > 0.0f, "sweep did not finish");
+    TEST_ASSERT(sweep.missed_bins_ > map.n_samples_, "missed %u bins", sweep.missed_bins_);
+    return true;
+}
+
+static bool cogging_sweep_abort_test() {
+    CoggingMap map;
+    TEST_ASSERT(map.allocate(cpr, 4.0f, 0.001f), "allocation failed");
+    CoggingSweep sweep;
+    sweep.start(&map, 0.0f);
+    TEST_ASSERT(sweep.is_running() && sweep.get_direction() == 1.0f, "not running");
+    sweep.abort();
+    TEST_ASSERT(!sweep.is_running() && sweep.get_direction() == 0.0f, "still running");
+    TEST_ASSERT(!sweep.update(1000.0f, 1.0f), "update after abort");
+    return true;
+}
+
+bool cogging_sweep_test() {
+    return cogging_sweep_binning_test()
+        && cogging_sweep_too_fast_test()
+        && cogging_sweep_abort_test();
+}
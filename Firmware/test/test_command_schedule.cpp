@@ -0,0 +1,81 @@
+#include <stddef.h>
+#include <stdint.h>
+
+#include "test_utils.hpp"
+#include <commandSchedule.hpp>
+
+typedef CommandSchedule<int, 4> Schedule;
+
+// @brief Runs the consumer from tick start for n_ticks and records at which
+// tick each command was applied
+static void run(Schedule& schedule, uint32_t start, uint32_t n_ticks, uint32_t applied_at[], size_t n_commands) {
+    for (uint32_t tick = start; tick != start + n_ticks; ++tick) {
+        schedule.apply_due(tick, [&](int command) {
+            if (command >= 0 && (size_t)command < n_commands)
+                applied_at[command] = tick;
+        });
+    }
+}
+
+static bool schedule_order_test(uint32_t start) {
+    Schedule schedule;
+    uint32_t applied_at[4] = {};
+    uint32_t start_push = schedule.get_push_count();
+    TEST_ASSERT(schedule.push(start + 10, 0), "push failed");
+    TEST_ASSERT(schedule.push(start + 10, 1), "push at the same tick failed");
+    TEST_ASSERT(!schedule.push(start + 5, 2), "push before a pending tick must fail");
+    TEST_ASSERT(schedule.push(start + 20, 2), "push failed");
+    TEST_ASSERT(schedule.push(start + 30, 3), "push failed");
+    TEST_ASSERT(!schedule.push(start + 40, 4), "push into a full queue must fail");
+    TEST_ASSERT(schedule.get_depth() == 4, "depth %u", schedule.get_depth());
+
+    run(schedule, start, 100, applied_at, 4);
+    TEST_ASSERT(applied_at[0] == start + 10 && applied_at[1] == start + 10
+             && applied_at[2] == start + 20 && applied_at[3] == start + 30, "applied at the wrong tick");
+    TEST_ASSERT(schedule.get_depth() == 0 && schedule.applied_count_ == 4 && schedule.late_count_ == 0,
+            "depth %u, applied %u, late %u", schedule.get_depth(), schedule.applied_count_, schedule.late_count_);
+
+    TEST_ASSERT(schedule.get_push_count() == start_push + 4 && schedule.get_pop_count() == start_push + 4,
+            "pushed %u, popped %u", schedule.get_push_count(), schedule.get_pop_count());
+
+    // once the queue is empty, earlier ticks are accepted again
+    TEST_ASSERT(schedule.push(start + 5, 0), "push into an empty queue failed");
+    return true;
+}
+
+static bool schedule_late_test() {
+    Schedule schedule;
+    uint32_t applied_at[2] = {};
+    schedule.push(100, 0);
+    schedule.push(103, 1);
+    // the control loop didn't run until tick 105
+    run(schedule, 105, 1, applied_at, 2);
+    TEST_ASSERT(applied_at[0] == 105 && applied_at[1] == 105, "late commands not applied");
+    TEST_ASSERT(schedule.late_count_ == 2 && schedule.max_lateness_ == 5,
+            "late %u, max lateness %u", schedule.late_count_, schedule.max_lateness_);
+    return true;
+}
+
+static bool schedule_drop_test() {
+    Schedule schedule;
+    uint32_t applied_at[3] = {};
+    schedule.push(100, 0);
+    schedule.push(101, 1);
+    schedule.push(200, 2);
+    // the axis was idle at tick 150
+    schedule.drop_due(150);
+    TEST_ASSERT(schedule.dropped_count_ == 2 && schedule.get_depth() == 1 && schedule.get_pop_count() == 2,
+            "dropped %u, depth %u", schedule.dropped_count_, schedule.get_depth());
+    run(schedule, 150, 100, applied_at, 3);
+    TEST_ASSERT(applied_at[0] == 0 && applied_at[1] == 0 && applied_at[2] == 200, "dropped commands applied");
+    TEST_ASSERT(schedule.applied_count_ == 1 && schedule.late_count_ == 0,
+            "applied %u, late %u", schedule.applied_count_, schedule.late_count_);
+    return true;
+}
+
+bool command_schedule_test() {
+    return schedule_order_test(1000)
+        && schedule_order_test(0xFFFFFFF0u) // ticks wrap around
+        && schedule_late_test()
+        && schedule_drop_test();
+}
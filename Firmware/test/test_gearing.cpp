@@ -0,0 +1,100 @@
+#include <stddef.h>
+#include <stdint.h>
+
+#include "test_utils.hpp"
+#include <gearing.hpp>
+
+static bool gearing_ratio_test() {
+    ElectronicGearing::Config_t config;
+    config.ratio = -2.5f;
+    config.offset = 100.0f;
+    ElectronicGearing gearing(config);
+    float pos, vel;
+    gearing.eval(1000.0f, 400.0f, &pos, &vel);
+    TEST_ASSERT(pos == 100.0f - 2500.0f && vel == -1000.0f, "pos %f vel %f", (double)pos, (double)vel);
+    return true;
+}
+
+// The velocity feedforward must be consistent with the position mapping,
+// also across cam points and the wrap of the cam period.
+static bool gearing_cam_test() {
+    ElectronicGearing::Config_t config;
+    config.ratio = 0.5f;
+    config.use_cam = true;
+    config.cam_period = 6400.0f;
+    ElectronicGearing gearing(config);
+    for (uint32_t i = 0; i < ElectronicGearing::kCamPoints; ++i)
+        gearing.set_cam_point(i, 300.0f * sinf(2.0f * (float)M_PI * (float)i / (float)ElectronicGearing::kCamPoints));
+    TEST_ASSERT(gearing.get_cam_point(ElectronicGearing::kCamPoints) == 0.0f, "out of range read");
+
+    float pos, vel;
+    // exactly on a cam point
+    gearing.eval(1600.0f, 0.0f, &pos, &vel);
+    TEST_ASSERT(fabsf(pos - (800.0f + 300.0f)) < 1e-3f, "pos %f at a quarter period", (double)pos);
+    // one period later, the cam repeats and the ratio continues
+    gearing.eval(1600.0f + 6400.0f, 0.0f, &pos, &vel);
+    TEST_ASSERT(fabsf(pos - (4000.0f + 300.0f)) < 1e-3f, "pos %f one period later", (double)pos);
+    // negative leader positions wrap into the period
+    gearing.eval(1600.0f - 6400.0f, 0.0f, &pos, &vel);
+    TEST_ASSERT(fabsf(pos - (-2400.0f + 300.0f)) < 1e-3f, "pos %f one period earlier", (double)pos);
+
+    const float leader_vel = 1000.0f;
+    const float h = 0.01f;
+    for (float x = -7000.0f; x < 7000.0f; x += 37.0f) {
+        float pos0, pos1, ff;
+        gearing.eval(x, leader_vel, &pos0, &ff);
+        gearing.eval(x + h, leader_vel, &pos1, &vel);
+        // the derivative between cam points, skipping the points themselves
+        float phase = fmodf_pos(x, config.cam_period / (float)ElectronicGearing::kCamPoints);
+        if (phase > 1.0f && phase < config.cam_period / (float)ElectronicGearing::kCamPoints - 1.0f) {
+            float numeric = (pos1 - pos0) / h * leader_vel;
+            TEST_ASSERT(fabsf(ff - numeric) < 0.05f * leader_vel, "x %f: vel %f, numeric %f", (double)x, (double)ff, (double)numeric);
+        }
+    }
+
+    gearing.clear_cam();
+    gearing.eval(1600.0f, leader_vel, &pos, &vel);
+    TEST_ASSERT(pos == 800.0f && vel == 500.0f, "clear_cam: pos %f vel %f", (double)pos, (double)vel);
+    return true;
+}
+
+// Entering follower control must start at the current setpoint and move
+// onto the mapping at engage_vel
+static bool gearing_engage_test() {
+    const float dt = 1.0f / 8000.0f;
+    ElectronicGearing::Config_t config;
+    config.ratio = 2.0f;
+    config.engage_vel = 1000.0f;
+    ElectronicGearing gearing(config);
+    const float leader_vel = 400.0f;
+    float leader_pos = 50.0f;
+    float pos, vel;
+
+    gearing.engage(leader_pos, 300.0f);
+    gearing.eval(leader_pos, leader_vel, &pos, &vel);
+    TEST_ASSERT(gearing.is_engaged() && pos == 300.0f, "pos %f after engaging", (double)pos);
+    TEST_ASSERT(vel == 800.0f - 1000.0f, "vel %f while engaging", (double)vel);
+
+    // 200 counts above the mapping take 0.2 s at 1000 counts/s
+    float prev_pos = pos;
+    for (int i = 0; i < 1700; ++i) {
+        leader_pos += leader_vel * dt;
+        gearing.step(dt);
+        gearing.eval(leader_pos, leader_vel, &pos, &vel);
+        // the leader's motion plus at most one engage step
+        float step = pos - prev_pos - 2.0f * leader_vel * dt;
+        TEST_ASSERT(step <= 1e-3f && step >= -config.engage_vel * dt - 1e-3f, "cycle %d: pos jumped from %f to %f", i, (double)prev_pos, (double)pos);
+        prev_pos = pos;
+    }
+    TEST_ASSERT(fabsf(pos - 2.0f * leader_pos) < 1e-3f && vel == 800.0f, "pos %f vel %f after engaging", (double)pos, (double)vel);
+
+    gearing.disengage();
+    TEST_ASSERT(!gearing.is_engaged(), "still engaged");
+    return true;
+}
+
+bool gearing_test() {
+    return gearing_ratio_test()
+        && gearing_cam_test()
+        && gearing_engage_test();
+}
@@ -0,0 +1,75 @@
+#include <stddef.h>
+#include <stdint.h>
+
+#include "test_utils.hpp"
+#include <hall_sampler.hpp>
+
+// @brief Input data register that counts how often it is read
+struct MockRegister {
+    uint32_t value;
+    uint32_t reads;
+    operator uint32_t() { ++reads; return value; }
+    MockRegister& operator=(uint32_t v) { value = v; return *this; }
+};
+
+struct MockPort {
+    MockRegister IDR;
+};
+
+// @brief Reference decoder, the linear search over all ports that
+// decode_hall_samples in low_level.cpp did before
+static uint8_t search_decode(MockPort* const all_ports[3], const uint16_t samples[3],
+                             MockPort* const hall_ports[3], const uint16_t hall_pins[3]) {
+    uint8_t hall_state = 0;
+    for (int i = 2; i >= 0; --i) { // C, B, A
+        int port_idx = 0;
+        while (all_ports[port_idx] != hall_ports[i])
+            ++port_idx;
+        hall_state <<= 1;
+        hall_state |= (samples[port_idx] & hall_pins[i]) ? 1 : 0;
+    }
+    return hall_state;
+}
+
+bool hall_sampler_test() {
+    static MockPort port_a, port_b, port_c;
+    MockPort* const all_ports[3] = { &port_a, &port_b, &port_c };
+
+    // the M0 layout of ODrive v3: A and B on port B, C on port C
+    MockPort* const hall_ports[3] = { &port_b, &port_b, &port_c };
+    const uint16_t hall_pins[3] = { 1 << 4, 1 << 5, 1 << 9 };
+
+    HallSampler<MockPort> sampler;
+    sampler.init(hall_ports, hall_pins);
+    TEST_ASSERT(sampler.get_port_count() == 2, "%zu ports sampled", sampler.get_port_count());
+
+    for (uint32_t i = 0; i < 1000; ++i) {
+        uint32_t noise = i * 2654435761u;
+        port_a.IDR = noise & 0xffff;
+        port_b.IDR = (noise >> 8) & 0xffff;
+        port_c.IDR = (noise >> 16) & 0xffff;
+        uint16_t samples[3] = { (uint16_t)port_a.IDR.value, (uint16_t)port_b.IDR.value, (uint16_t)port_c.IDR.value };
+        for (MockPort* port : all_ports)
+            port->IDR.reads = 0;
+
+        sampler.sample();
+        TEST_ASSERT(port_a.IDR.reads == 0 && port_b.IDR.reads == 1 && port_c.IDR.reads == 1,
+                "port reads %u %u %u", port_a.IDR.reads, port_b.IDR.reads, port_c.IDR.reads);
+
+        // the ports change after the sample was taken
+        port_b.IDR = ~port_b.IDR.value;
+        uint8_t expected = search_decode(all_ports, samples, hall_ports, hall_pins);
+        TEST_ASSERT(sampler.decode() == expected, "sample %u: state %u, expected %u", i, sampler.decode(), expected);
+    }
+
+    // one port per input
+    MockPort* const separate_ports[3] = { &port_c, &port_a, &port_b };
+    sampler.init(separate_ports, hall_pins);
+    TEST_ASSERT(sampler.get_port_count() == 3, "%zu ports sampled", sampler.get_port_count());
+    port_a.IDR = hall_pins[1];
+    port_b.IDR = 0;
+    port_c.IDR = hall_pins[0];
+    sampler.sample();
+    TEST_ASSERT(sampler.decode() == 0x3, "state %u", sampler.decode());
+    return true;
+}
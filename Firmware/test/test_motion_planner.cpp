@@ -0,0 +1,185 @@
+#include <stddef.h>
+#include <stdint.h>
+
+#include "test_utils.hpp"
+#include <motion_planner.hpp>
+#include <pvtTraj.hpp>
+
+static const float dt = 1.0f / 8000.0f; // control loop period
+
+typedef MotionPlanner<2, 16> Planner;
+
+struct Point_t {
+    float pos[2];
+    float vel[2];
+    float dt;
+};
+
+static Point_t points[4096];
+static size_t n_points = 0;
+
+static void record_point(const float pos[2], const float vel[2], float point_dt) {
+    if (n_points < sizeof(points) / sizeof(points[0]))
+        points[n_points++] = { { pos[0], pos[1] }, { vel[0], vel[1] }, point_dt };
+}
+
+static const Planner::Limits_t limits = {
+    .vel = { 20000.0f, 10000.0f },
+    .accel = { 50000.0f, 50000.0f },
+    .junction_deviation = 10.0f,
+};
+
+// @brief Plays the recorded points through one PvtTrajectory per axis, like
+// the firmware does, and checks the resulting setpoints.
+// @param min_path_vel: The path speed must not drop below this value
+//        except within accel_time of the start and the end.
+// @param accel_margin: Allowed excess over the acceleration limits. Corners
+//        are rounded off by the interpolation of the adjacent phases, which can
+//        take more than the path acceleration if those phases are short.
+static bool check_playback(const char* name, const float end[2], float min_path_vel, float accel_time,
+                           float accel_margin, float (*path_error)(const float pos[2])) {
+    PvtTrajectory pvt[2];
+    float duration = 0.0f;
+    for (size_t k = 0; k < n_points; ++k) {
+        TEST_ASSERT(points[k].dt > 0.0f, "%s: point %zu dt %f", name, k, (double)points[k].dt);
+        duration += points[k].dt;
+    }
+    TEST_ASSERT(n_points < sizeof(points) / sizeof(points[0]), "%s: too many points", name);
+    size_t n_pushed = 0;
+    for (size_t axis = 0; axis < 2; ++axis)
+        pvt[axis].start(0.0f, 0.0f);
+
+    PvtTrajectory::Step_t prev[2] = {};
+    int n_steps = (int)(duration / dt) + 10;
+    for (int i = 1; i <= n_steps; ++i) {
+        float t = dt * (float)i;
+        // keep the queues filled, as the firmware does
+        for (; n_pushed < n_points && pvt[0].get_level() < PvtTrajectory::kCapacity; ++n_pushed) {
+            for (size_t axis = 0; axis < 2; ++axis)
+                pvt[axis].push(points[n_pushed].pos[axis], points[n_pushed].vel[axis], points[n_pushed].dt);
+        }
+        PvtTrajectory::Step_t step[2];
+        for (size_t axis = 0; axis < 2; ++axis) {
+            pvt[axis].step(dt, &step[axis]);
+            TEST_ASSERT(fabsf(step[axis].Yd) <= limits.vel[axis] * 1.001f,
+                    "%s: t %f axis %zu vel %f", name, (double)t, axis, (double)step[axis].Yd);
+            TEST_ASSERT(fabsf(step[axis].Ydd) <= limits.accel[axis] * accel_margin,
+                    "%s: t %f axis %zu accel %f", name, (double)t, axis, (double)step[axis].Ydd);
+            TEST_ASSERT(fabsf(step[axis].Y - prev[axis].Y) <= limits.vel[axis] * dt * 1.01f + 1e-3f,
+                    "%s: t %f axis %zu position jump", name, (double)t, axis);
+            prev[axis] = step[axis];
+        }
+        const float pos[2] = { step[0].Y, step[1].Y };
+        TEST_ASSERT(path_error(pos) < 20.0f, "%s: t %f: %f counts off the path", name, (double)t, (double)path_error(pos));
+        if (t > accel_time && t < duration - accel_time) {
+            float path_vel = sqrtf(step[0].Yd * step[0].Yd + step[1].Yd * step[1].Yd);
+            TEST_ASSERT(path_vel >= min_path_vel, "%s: t %f path speed %f", name, (double)t, (double)path_vel);
+        }
+    }
+    for (size_t axis = 0; axis < 2; ++axis) {
+        TEST_ASSERT(fabsf(prev[axis].Y - end[axis]) < 1e-3f && prev[axis].Yd == 0.0f,
+                "%s: axis %zu ends at %f", name, axis, (double)prev[axis].Y);
+        TEST_ASSERT(pvt[axis].underrun_count_ == 0, "%s: underrun", name);
+    }
+    return true;
+}
+
+// Many short collinear moves: the planner must not stop between them.
+static bool planner_collinear_test() {
+    n_points = 0;
+    Planner planner(record_point);
+    for (int i = 1; i <= 100; ++i) {
+        const float target[2] = { 200.0f * (float)i, 100.0f * (float)i };
+        planner.add_line(target, INFINITY, limits);
+        TEST_ASSERT(planner.get_queue_length() <= 16, "queue length %zu", planner.get_queue_length());
+    }
+    TEST_ASSERT(n_points > 0, "nothing executed while the queue is full");
+    planner.flush();
+    TEST_ASSERT(planner.get_queue_length() == 0, "flush left moves in the queue");
+    const float end[2] = { 20000.0f, 10000.0f };
+    // y is the limiting axis: 10000 counts/s along y, half the path speed along x
+    float path_vel = 10000.0f * sqrtf(5.0f) / 2.0f;
+    // the Hermite coefficients amplify the rounding of the point positions a little
+    return check_playback("collinear", end, 0.99f * path_vel, 0.3f, 1.01f,
+            [](const float pos[2]) { return fabsf(pos[0] - 2.0f * pos[1]) / sqrtf(5.0f); });
+}
+
+// A polygon approximating a circle: the speed is limited by the junction
+// deviation, but stays well above zero.
+static bool planner_circle_test() {
+    n_points = 0;
+    Planner planner(record_point);
+    const int n_sides = 60;
+    const float radius = 5000.0f;
+    for (int i = 1; i <= n_sides; ++i) {
+        float theta = 2.0f * (float)M_PI * (float)i / (float)n_sides;
+        const float target[2] = { radius * (1.0f - cosf(theta)), radius * sinf(theta) };
+        planner.add_line(target, 8000.0f, limits);
+    }
+    planner.flush();
+    const float end[2] = { 0.0f, 0.0f };
+    // the polygon itself is up to 7 counts inside the circle
+    return check_playback("circle", end, 1000.0f, 0.2f, 2.5f,
+            [](const float pos[2]) { return fabsf(hypotf(pos[0] - 5000.0f, pos[1]) - 5000.0f); });
+}
+
+// With zero junction deviation the axes stop at a corner; a dwell stops and holds.
+static bool planner_corner_test() {
+    n_points = 0;
+    Planner::Limits_t sharp = limits;
+    sharp.junction_deviation = 0.0f;
+    Planner planner(record_point);
+    const float a[2] = { 10000.0f, 0.0f };
+    const float b[2] = { 10000.0f, 5000.0f };
+    planner.add_line(a, INFINITY, sharp);
+    planner.add_line(b, INFINITY, sharp);
+    planner.add_dwell(0.5f);
+    TEST_ASSERT(planner.get_queue_length() == 0, "dwell must flush the queue");
+
+    bool stopped_at_corner = false;
+    for (size_t k = 0; k < n_points; ++k) {
+        if (points[k].pos[0] == a[0] && points[k].pos[1] == a[1])
+            stopped_at_corner = points[k].vel[0] == 0.0f && points[k].vel[1] == 0.0f;
+    }
+    TEST_ASSERT(stopped_at_corner, "no stop at the corner");
+    const Point_t& last = points[n_points - 1];
+    TEST_ASSERT(last.dt == 0.5f && last.pos[0] == b[0] && last.pos[1] == b[1] && last.vel[1] == 0.0f, "dwell point");
+    return check_playback("corner", b, 0.0f, 0.0f, 1.01f,
+            [](const float pos[2]) { return fminf(fabsf(pos[1]), fabsf(pos[0] - 10000.0f)); });
+}
+
+// Executing from the head while moves keep arriving, as the GCode executor
+// does when the PVT queues run low: a lone move ends at standstill, executed
+// moves keep their exit speed and the moves behind them are still blended.
+static bool planner_execute_next_test() {
+    n_points = 0;
+    Planner planner(record_point);
+    const float first[2] = { 1000.0f, 0.0f };
+    planner.add_line(first, INFINITY, limits);
+    TEST_ASSERT(planner.execute_next() && planner.get_queue_length() == 0, "execute_next failed");
+    TEST_ASSERT(n_points > 0 && points[n_points - 1].pos[0] == first[0] && points[n_points - 1].vel[0] == 0.0f,
+            "a lone move must end at standstill");
+    TEST_ASSERT(!planner.execute_next(), "execute_next on an empty queue");
+
+    size_t blended = 0;
+    for (int i = 2; i <= 50; ++i) {
+        const float target[2] = { 1000.0f * (float)i, 0.0f };
+        planner.add_line(target, INFINITY, limits);
+        if (i % 3 == 0 && planner.get_queue_length() > 1) {
+            planner.execute_next();
+            blended += points[n_points - 1].vel[0] > 0.0f;
+        }
+    }
+    TEST_ASSERT(blended > 0, "executed moves never passed on their speed");
+    planner.flush();
+    const float end[2] = { 50000.0f, 0.0f };
+    return check_playback("execute_next", end, 0.0f, 0.0f, 1.01f,
+            [](const float pos[2]) { return fabsf(pos[1]); });
+}
+
+bool motion_planner_test() {
+    return planner_collinear_test()
+        && planner_circle_test()
+        && planner_corner_test()
+        && planner_execute_next_test();
+}
@@ -0,0 +1,103 @@
+#include <stddef.h>
+#include <stdint.h>
+#include <math.h>
+
+#include "test_utils.hpp"
+#include <oscilloscope.hpp>
+
+static float buffer[60];
+
+static const float control_period = 1.0f / 8000.0f;
+
+// @brief Runs the oscilloscope for n_cycles control cycles on a signal that
+// is the cycle number in channel 0 and signal(cycle) in channel 1.
+// The device time is 125 us per cycle.
+static void run(Oscilloscope& scope, uint32_t n_cycles, float (*signal)(uint32_t cycle), uint32_t* cycle) {
+    for (uint32_t i = 0; i < n_cycles; ++i, ++*cycle) {
+        scope.update([&](uint32_t channel) {
+            return channel == 0 ? (float)*cycle : signal(*cycle);
+        }, (uint64_t)*cycle * 125);
+    }
+}
+
+static bool scope_rising_edge_test() {
+    Oscilloscope scope(buffer, sizeof(buffer) / sizeof(buffer[0]), control_period);
+    scope.config_.n_channels = 2;
+    scope.config_.decimation = 2;
+    scope.config_.pre_trigger = 10;
+    scope.config_.trigger_channel = 1;
+    scope.config_.trigger_mode = Oscilloscope::TRIGGER_MODE_RISING;
+    scope.config_.trigger_level = 0.5f;
+    TEST_ASSERT(scope.start(), "start failed");
+    TEST_ASSERT(scope.get_frame_count() == 30, "frame count %u", scope.get_frame_count());
+
+    // a step at cycle 100, long after the pre-trigger part was recorded
+    auto step = [](uint32_t cycle) { return cycle >= 100 ? 1.0f : 0.0f; };
+    uint32_t cycle = 0;
+    run(scope, 100, step, &cycle);
+    TEST_ASSERT(scope.state_ == Oscilloscope::STATE_ARMED, "triggered early");
+    run(scope, 2, step, &cycle);
+    TEST_ASSERT(scope.state_ == Oscilloscope::STATE_TRIGGERED, "not triggered");
+    run(scope, 200, step, &cycle);
+    TEST_ASSERT(scope.state_ == Oscilloscope::STATE_DONE, "not done");
+    TEST_ASSERT(scope.trigger_time_us_ == 100 * 125, "trigger time %llu us", (unsigned long long)scope.trigger_time_us_);
+    TEST_ASSERT(scope.frame_period_ == 2.0f * control_period, "frame period %f", (double)scope.frame_period_);
+
+    // chronological frames every 2 cycles, the step at frame pre_trigger
+    for (uint32_t frame = 0; frame < scope.get_frame_count(); ++frame) {
+        float expected_cycle = (float)(100 + 2 * ((int)frame - 10));
+        TEST_ASSERT(scope.get_value(frame, 0) == expected_cycle, "frame %u: cycle %f", frame, (double)scope.get_value(frame, 0));
+        TEST_ASSERT(scope.get_value(frame, 1) == (frame >= 10 ? 1.0f : 0.0f), "frame %u: value %f", frame, (double)scope.get_value(frame, 1));
+    }
+
+    // nothing is recorded anymore
+    float last = scope.get_value(29, 0);
+    run(scope, 10, step, &cycle);
+    TEST_ASSERT(scope.get_value(29, 0) == last, "recorded after done");
+    return true;
+}
+
+static bool scope_pre_trigger_test() {
+    // an error bit that is set before the pre-trigger part is full only triggers later
+    Oscilloscope scope(buffer, 20, control_period);
+    scope.config_.pre_trigger = 5;
+    scope.config_.trigger_mode = Oscilloscope::TRIGGER_MODE_NONZERO;
+    TEST_ASSERT(scope.start(), "start failed");
+    auto error = [](uint32_t cycle) { return (cycle >= 3 && cycle < 6) || cycle >= 9 ? 4.0f : 0.0f; };
+    uint32_t cycle = 0;
+    for (; cycle < 40; ++cycle)
+        scope.update([&](uint32_t) { return error(cycle); }, (uint64_t)cycle * 125);
+    TEST_ASSERT(scope.state_ == Oscilloscope::STATE_DONE, "not done");
+    TEST_ASSERT(scope.get_value(4, 0) == 0.0f && scope.get_value(5, 0) == 4.0f, "trigger at the wrong frame");
+    return true;
+}
+
+static bool scope_force_trigger_test() {
+    Oscilloscope scope(buffer, 16, control_period);
+    scope.config_.n_channels = 2;
+    scope.config_.trigger_mode = Oscilloscope::TRIGGER_MODE_FALLING;
+    TEST_ASSERT(scope.start(), "start failed");
+    uint32_t cycle = 0;
+    auto flat = [](uint32_t) { return 1.0f; };
+    run(scope, 50, flat, &cycle);
+    TEST_ASSERT(scope.state_ == Oscilloscope::STATE_ARMED, "triggered without an edge");
+    scope.force_trigger();
+    run(scope, 8, flat, &cycle);
+    TEST_ASSERT(scope.state_ == Oscilloscope::STATE_DONE, "not done after forcing the trigger");
+    TEST_ASSERT(scope.get_value(0, 0) == 50.0f && scope.get_value(7, 0) == 57.0f, "wrong frames");
+
+    // invalid configurations
+    scope.config_.n_channels = Oscilloscope::kMaxChannels + 1;
+    TEST_ASSERT(!scope.start(), "too many channels accepted");
+    scope.config_.n_channels = 2;
+    scope.config_.pre_trigger = 8;
+    TEST_ASSERT(!scope.start(), "pre-trigger longer than the buffer accepted");
+    TEST_ASSERT(scope.state_ == Oscilloscope::STATE_IDLE, "running after failed start");
+    return true;
+}
+
+bool oscilloscope_test() {
+    return scope_rising_edge_test()
+        && scope_pre_trigger_test()
+        && scope_force_trigger_test();
+}
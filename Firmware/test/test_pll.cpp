@@ -0,0 +1,209 @@
+#include <stddef.h>
+#include <stdint.h>
+
+#include "test_utils.hpp"
+#include <pll.hpp>
+
+static const float dt = 1.0f / 8000.0f;
+
+// Feeds a quantized encoder count moving at constant velocity into a
+// [0, cpr) PLL, the same way Encoder::update() does.
+template<typename TPll>
+static void run_encoder_pll(TPll& pll, const PllGains& gains, float cpr, float vel, int n_steps) {
+    for (int i = 0; i < n_steps; ++i) {
+        float true_pos = fmodf_pos(vel * dt * (float)i, cpr);
+        int32_t count = (int32_t)floorf(true_pos);
+        pll.predict(dt);
+        pll.correct((float)(count - (int32_t)floorf(pll.phase_)), gains);
+    }
+}
+
+static bool pll_gains_test() {
+    PllGains gains;
+    TEST_ASSERT(gains.set_bandwidth(1000.0f, dt), "bandwidth 1000 should be stable");
+    TEST_ASSERT(gains.kp == 2000.0f && gains.ki == 1000000.0f, "kp %f ki %f", gains.kp, gains.ki);
+    TEST_ASSERT(fabsf(gains.kp_dt - 0.25f) < 1e-6f, "kp_dt %f", gains.kp_dt);
+    TEST_ASSERT(!gains.set_bandwidth(4000.0f, dt), "bandwidth 4000 should be unstable");
+    TEST_ASSERT(!gains.set_bandwidth(NAN, dt), "NaN bandwidth should be unstable");
+    return true;
+}
+
+static bool pll_convergence_test() {
+    const float cpr = 8192.0f;
+    PllGains gains;
+    gains.set_bandwidth(1000.0f, dt);
+
+    const float vels[] = { 0.0f, 100.0f, -2500.0f, 200000.0f };
+    for (float vel : vels) {
+        Pll<float, PllWrapRange> pll;
+        pll.wrap_.set_range(cpr);
+        run_encoder_pll(pll, gains, cpr, vel, 8000);
+        // quantization noise on the phase detector is up to one count per sample,
+        // which moves the velocity estimate by ki_dt each time
+        float tol = 0.01f * fabsf(vel) + gains.ki_dt;
+        TEST_ASSERT(fabsf(pll.vel_ - vel) <= tol, "vel %f: estimate %f", vel, pll.vel_);
+        TEST_ASSERT(pll.phase_ >= 0.0f && pll.phase_ < cpr, "vel %f: phase %f out of range", vel, pll.phase_);
+    }
+    return true;
+}
+
+static bool pll_wrap_test() {
+    // Angle PLL: constant electrical velocity across many turns
+    PllGains gains;
+    gains.set_bandwidth(1000.0f, dt);
+    Pll<float, PllWrapPmPi> pll;
+    const float omega = 2.0f * M_PI * 50.0f; // [rad/s]
+    for (int i = 0; i < 8000; ++i) {
+        float meas = wrap_pm_pi(omega * dt * (float)i);
+        pll.predict(dt);
+        float delta = pll.correct(meas - pll.phase_, gains);
+        TEST_ASSERT(delta >= -M_PI && delta <= M_PI, "delta %f not wrapped", delta);
+        TEST_ASSERT(pll.phase_ >= -M_PI && pll.phase_ <= M_PI, "phase %f not wrapped", pll.phase_);
+    }
+    TEST_ASSERT(fabsf(pll.vel_ - omega) < 0.01f * omega, "vel %f expected %f", pll.vel_, omega);
+
+    // A follower without wrapping must accumulate the full distance
+    Pll<float, PllWrapNone> linear;
+    Pll<float, PllWrapRange> cpr_pll;
+    cpr_pll.wrap_.set_range(100.0f);
+    for (int i = 0; i < 8000; ++i) {
+        float pos = 1000.0f * dt * (float)i;
+        linear.predict(dt, cpr_pll.vel_);
+        cpr_pll.predict(dt);
+        linear.correct_phase(pos - linear.phase_, gains);
+        cpr_pll.correct(fmodf_pos(pos, 100.0f) - cpr_pll.phase_, gains);
+    }
+    TEST_ASSERT(fabsf(linear.phase_ - 1000.0f) < 1.0f, "linear position %f", linear.phase_);
+    TEST_ASSERT(linear.vel_ == 0.0f, "correct_phase must not touch the velocity");
+    return true;
+}
+
+static bool fixed_point_pll_test() {
+    PllGains gains;
+    gains.set_bandwidth(1000.0f, dt);
+
+    // Must track the float PLL where floats are still exact
+    {
+        const float cpr = 8192.0f;
+        const float vel = -2500.0f;
+        Pll<float, PllWrapRange> ref;
+        ref.wrap_.set_range(cpr);
+        FixedPointPll pll;
+        pll.set_range((int32_t)cpr);
+        for (int i = 0; i < 8000; ++i) {
+            int32_t count = (int32_t)floorf(fmodf_pos(vel * dt * (float)i, cpr));
+            ref.predict(dt);
+            ref.correct((float)(count - (int32_t)floorf(ref.phase_)), gains);
+            pll.predict(dt);
+            pll.correct(count, gains);
+            TEST_ASSERT(pll.phase_ >= 0 && pll.get_count() < (int64_t)cpr, "phase %f out of range", (double)pll.get_phase());
+        }
+        TEST_ASSERT(fabsf(pll.vel_ - ref.vel_) <= 2.0f * gains.ki_dt, "vel %f, float pll %f", (double)pll.vel_, (double)ref.vel_);
+        float phase_err = wrap_pm(pll.get_phase() - ref.phase_, 0.5f * cpr);
+        TEST_ASSERT(fabsf(phase_err) < 2.0f, "phase %f, float pll %f", (double)pll.get_phase(), (double)ref.phase_);
+    }
+
+    // Far beyond 2^24 counts, with the measured count being a wrapping int32
+    {
+        const int64_t start = (int64_t)1 << 40;
+        const int32_t vel = 100000; // [count/s]
+        FixedPointPll pll;
+        pll.set_count(start);
+        pll.vel_ = (float)vel;
+        for (int i = 1; i <= 80000; ++i) {
+            int64_t true_count = start + (int64_t)vel * i / 8000;
+            pll.predict(dt);
+            pll.correct((int32_t)(uint32_t)(uint64_t)true_count, gains);
+        }
+        int64_t expected = start + (int64_t)vel * 10;
+        int64_t err = pll.get_count() - expected;
+        TEST_ASSERT(err >= -2 && err <= 2, "position off by %lld counts", (long long)err);
+        TEST_ASSERT(fabsf(pll.vel_ - (float)vel) <= 2.0f * gains.ki_dt, "vel %f", (double)pll.vel_);
+    }
+
+    // Exact modular arithmetic: many turns must not accumulate any error
+    {
+        const int32_t cpr = 8192;
+        FixedPointPll pll;
+        pll.set_range(cpr);
+        int64_t true_count = 0;
+        for (int i = 0; i < 800000; ++i) {
+            true_count += 37;
+            pll.predict(dt);
+            pll.correct((int32_t)(true_count % cpr), gains);
+        }
+        int64_t err = pll.get_count() - true_count % cpr;
+        if (err > cpr / 2) err -= cpr;
+        if (err < -cpr / 2) err += cpr;
+        TEST_ASSERT(err >= -1 && err <= 1, "cpr position off by %lld counts", (long long)err);
+    }
+
+    // a negative range (e.g. a negative CPR) must not make wrap() spin
+    {
+        FixedPointPll pll;
+        pll.set_range(-8192);
+        for (int i = 0; i < 1000; ++i) {
+            pll.predict(dt);
+            pll.correct(i * 37, gains);
+        }
+        TEST_ASSERT(pll.get_count() > 0, "count %lld", (long long)pll.get_count());
+    }
+    return true;
+}
+
+bool pll_test() {
+    return pll_gains_test()
+        && pll_convergence_test()
+        && pll_wrap_test()
+        && fixed_point_pll_test();
+}
+
+// Runs both the linear and the cpr PLL the way Encoder::update() does,
+// once with floats and once with fixed point. The counts are generated
+// up front so only the PLL itself is timed.
+bool pll_benchmark() {
+    const int32_t cpr = 8192;
+    const int n_counts = 4096;
+    const int n_steps = 10000000;
+    PllGains gains;
+    gains.set_bandwidth(1000.0f, dt);
+
+    int32_t counts[n_counts];
+    for (int i = 0; i < n_counts; ++i)
+        counts[i] = (i * 7) / 3;
+
+    Pll<float, PllWrapNone> pos_pll;
+    Pll<float, PllWrapRange> cpr_pll;
+    cpr_pll.wrap_.set_range((float)cpr);
+    double t0 = test_time_s();
+    for (int i = 0; i < n_steps; ++i) {
+        int32_t count = counts[i & (n_counts - 1)];
+        int32_t count_in_cpr = count & (cpr - 1);
+        pos_pll.predict(dt, cpr_pll.vel_);
+        cpr_pll.predict(dt);
+        pos_pll.correct_phase((float)(count - (int32_t)floorf(pos_pll.phase_)), gains);
+        cpr_pll.correct((float)(count_in_cpr - (int32_t)floorf(cpr_pll.phase_)), gains);
+    }
+    double t_float = (test_time_s() - t0) * 1e9 / n_steps;
+
+    FixedPointPll pos_fixed;
+    FixedPointPll cpr_fixed;
+    cpr_fixed.set_range(cpr);
+    t0 = test_time_s();
+    for (int i = 0; i < n_steps; ++i) {
+        int32_t count = counts[i & (n_counts - 1)];
+        int32_t count_in_cpr = count & (cpr - 1);
+        pos_fixed.predict(dt, cpr_fixed.vel_);
+        cpr_fixed.predict(dt);
+        pos_fixed.correct_phase(count, gains);
+        cpr_fixed.correct(count_in_cpr, gains);
+    }
+    double t_fixed = (test_time_s() - t0) * 1e9 / n_steps;
+
+    // print the results so the loops can't be optimized away
+    printf("pll benchmark: float %.1f ns/update (vel %.1f), fixed point %.1f ns/update (vel %.1f)\n",
+            t_float, (double)cpr_pll.vel_, t_fixed, (double)cpr_fixed.vel_);
+    // generous margin, this is only meant to catch gross regressions
+    TEST_ASSERT(t_fixed < 1.5 * t_float, "fixed point PLL is slower than the float PLL");
+    return true;
+}
@@ -0,0 +1,116 @@
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include <string>
+
+#include "test_utils.hpp"
+#include <fibre/protocol.hpp>
+
+// @brief Sends a request to an endpoint the way BidirectionalPacketBasedChannel
+// does and returns the response length.
+static size_t request(Endpoint& endpoint, uint32_t offset, const void* data, size_t data_length,
+                      uint8_t* response, size_t response_length) {
+    uint8_t input[64];
+    size_t input_length = write_le<uint32_t>(offset, input);
+    if (data_length)
+        memcpy(input + input_length, data, data_length);
+    input_length += data_length;
+    MemoryStreamSink output(response, response_length);
+    endpoint.handle(input, input_length, &output);
+    return response_length - output.get_free_space();
+}
+
+static bool protocol_array_read_test() {
+    float values[10];
+    for (size_t i = 0; i < 10; ++i)
+        values[i] = (float)i;
+    auto array = make_protocol_ro_array("values", &values);
+
+    // only whole elements that fit into the response
+    uint8_t response[30];
+    size_t length = request(array, 2, nullptr, 0, response, sizeof(response));
+    TEST_ASSERT(length == 7 * sizeof(float), "response length %zu", length);
+    for (size_t i = 0; i < 7; ++i) {
+        float value;
+        read_le<float>(&value, response + i * sizeof(float));
+        TEST_ASSERT(value == (float)(i + 2), "element %zu: %f", i + 2, value);
+    }
+
+    // the response ends with the array
+    length = request(array, 8, nullptr, 0, response, sizeof(response));
+    TEST_ASSERT(length == 2 * sizeof(float), "response length at the end %zu", length);
+    length = request(array, 10, nullptr, 0, response, sizeof(response));
+    TEST_ASSERT(length == 0, "response length beyond the end %zu", length);
+
+    uint32_t array_length = 0;
+    length = request(array, ARRAY_LENGTH_OFFSET, nullptr, 0, response, sizeof(response));
+    read_le<uint32_t>(&array_length, response);
+    TEST_ASSERT(length == 4 && array_length == 10, "length %u", array_length);
+
+    // read only arrays ignore writes
+    float value = 42.0f;
+    request(array, 0, &value, sizeof(value), response, 0);
+    TEST_ASSERT(values[0] == 0.0f, "read only array was written");
+    return true;
+}
+
+static int hook_calls = 0;
+
+static bool protocol_array_write_test() {
+    int16_t samples[4] = { 0 };
+    int16_t* data = nullptr;
+    uint32_t n_samples = 0;
+    auto array = make_protocol_array("samples", &data, &n_samples,
+            [](void* ctx) { ++*static_cast<int*>(ctx); }, &hook_calls);
+
+    // not allocated yet
+    uint8_t response[30];
+    uint32_t array_length = 1;
+    request(array, ARRAY_LENGTH_OFFSET, nullptr, 0, response, sizeof(response));
+    read_le<uint32_t>(&array_length, response);
+    TEST_ASSERT(array_length == 0, "length before allocation %u", array_length);
+
+    // exchange: the old values are returned, the new values are clipped to the array
+    data = samples;
+    n_samples = 4;
+    int16_t new_samples[] = { 100, -200, 300 };
+    size_t length = request(array, 2, new_samples, sizeof(new_samples), response, sizeof(response));
+    TEST_ASSERT(length == 2 * sizeof(int16_t) && response[0] == 0, "response length %zu", length);
+    TEST_ASSERT(samples[0] == 0 && samples[1] == 0 && samples[2] == 100 && samples[3] == -200,
+            "samples %d %d %d %d", samples[0], samples[1], samples[2], samples[3]);
+    TEST_ASSERT(hook_calls == 1, "hook called %d times", hook_calls);
+
+    // incomplete elements are not written
+    uint8_t odd_byte = 0xff;
+    request(array, 0, &odd_byte, 1, response, 0);
+    TEST_ASSERT(samples[0] == 0 && hook_calls == 1, "incomplete element written");
+    return true;
+}
+
+// @brief Collects the JSON of an endpoint
+class StringSink : public StreamSink {
+public:
+    int process_bytes(const uint8_t* buffer, size_t length, size_t* processed_bytes) {
+        str_.append(reinterpret_cast<const char*>(buffer), length);
+        return 0;
+    }
+    size_t get_free_space() { return SIZE_MAX; }
+    std::string str_;
+};
+
+static bool protocol_array_json_test() {
+    uint32_t histogram[8] = { 0 };
+    auto array = make_protocol_ro_array("histogram", &histogram);
+    StringSink json;
+    array.write_json(5, &json);
+    const char* expected = "{\"name\":\"histogram\",\"id\":5,\"type\":\"array\",\"element\":{\"type\":\"uint32\",\"access\":\"r\"}}";
+    TEST_ASSERT(json.str_ == expected, "json %s", json.str_.c_str());
+    return true;
+}
+
+bool protocol_array_test() {
+    return protocol_array_read_test()
+        && protocol_array_write_test()
+        && protocol_array_json_test();
+}
@@ -0,0 +1,96 @@
+#include <stddef.h>
+#include <stdint.h>
+
+#include "test_utils.hpp"
+#include <pvtTraj.hpp>
+
+static const float dt = 1.0f / 8000.0f; // control loop period
+
+static bool pvt_queue_test() {
+    PvtTrajectory pvt;
+    TEST_ASSERT(!pvt.push(0.0f, 0.0f, 0.0f), "zero dt must be rejected");
+    for (uint32_t i = 0; i < PvtTrajectory::kCapacity; ++i)
+        TEST_ASSERT(pvt.push((float)i, 0.0f, 0.01f), "push %u failed", i);
+    TEST_ASSERT(!pvt.push(0.0f, 0.0f, 0.01f), "push into a full queue must fail");
+    TEST_ASSERT(pvt.get_level() == PvtTrajectory::kCapacity, "level %u", pvt.get_level());
+    TEST_ASSERT(fabsf(pvt.get_queued_duration() - 0.01f * PvtTrajectory::kCapacity) < 1e-4f,
+            "queued duration %f", (double)pvt.get_queued_duration());
+
+    PvtTrajectory::Step_t step;
+    TEST_ASSERT(!pvt.step(dt, &step), "step before start must fail");
+    pvt.start(0.0f, 0.0f);
+    TEST_ASSERT(pvt.step(dt, &step), "step after start failed");
+    TEST_ASSERT(pvt.get_level() == PvtTrajectory::kCapacity - 1, "level %u", pvt.get_level());
+    TEST_ASSERT(pvt.push(0.0f, 0.0f, 0.01f), "push after consuming a point failed");
+
+    pvt.clear();
+    TEST_ASSERT(pvt.get_level() == 0 && pvt.state_ == PvtTrajectory::STATE_IDLE, "clear failed");
+    return true;
+}
+
+// Hermite interpolation reproduces a cubic exactly when the points are
+// sampled from it, even if the point spacing is irregular and not a multiple
+// of the loop period.
+static bool pvt_interpolation_test() {
+    auto pos = [](float t) { return 1000.0f * t * t * t - 300.0f * t * t + 50.0f * t + 10.0f; };
+    auto vel = [](float t) { return 3000.0f * t * t - 600.0f * t + 50.0f; };
+    const float dts[] = { 0.0101f, 0.0037f, 0.05f, 0.02f, 0.00005f, 0.013f };
+
+    PvtTrajectory pvt;
+    float t_point = 0.0f;
+    for (int rep = 0; rep < 4; ++rep) {
+        for (float point_dt : dts) {
+            t_point += point_dt;
+            TEST_ASSERT(pvt.push(pos(t_point), vel(t_point), point_dt), "push failed");
+        }
+    }
+
+    pvt.start(pos(0.0f), vel(0.0f));
+    PvtTrajectory::Step_t step;
+    int n_steps = (int)(t_point / dt) - 1;
+    for (int i = 1; i <= n_steps; ++i) {
+        float t = dt * (float)i;
+        TEST_ASSERT(pvt.step(dt, &step), "step failed");
+        float tol = 1e-5f * t * 8000.0f + 1e-3f; // accumulated rounding of the segment times
+        TEST_ASSERT(fabsf(step.Y - pos(t)) < tol, "t %f: pos %f expected %f", (double)t, (double)step.Y, (double)pos(t));
+        TEST_ASSERT(fabsf(step.Yd - vel(t)) < 10.0f * tol, "t %f: vel %f expected %f", (double)t, (double)step.Yd, (double)vel(t));
+        TEST_ASSERT(pvt.state_ == PvtTrajectory::STATE_RUNNING, "t %f: not running", (double)t);
+    }
+    TEST_ASSERT(pvt.underrun_count_ == 0, "unexpected underrun");
+    return true;
+}
+
+static bool pvt_underrun_test() {
+    PvtTrajectory pvt;
+    PvtTrajectory::Step_t step;
+
+    // ends at standstill: running dry is not an underrun
+    pvt.push(10.0f, 0.0f, 0.01f);
+    pvt.start(0.0f, 0.0f);
+    for (int i = 0; i < 200; ++i)
+        pvt.step(dt, &step);
+    TEST_ASSERT(pvt.state_ == PvtTrajectory::STATE_HOLDING, "state %d", pvt.state_);
+    TEST_ASSERT(pvt.underrun_count_ == 0, "underrun count %u", pvt.underrun_count_);
+    TEST_ASSERT(step.Y == 10.0f && step.Yd == 0.0f, "holding at %f, %f", (double)step.Y, (double)step.Yd);
+
+    // ends while moving: underrun, hold the last point
+    pvt.push(20.0f, 1000.0f, 0.01f);
+    for (int i = 0; i < 200; ++i)
+        pvt.step(dt, &step);
+    TEST_ASSERT(pvt.underrun_count_ == 1, "underrun count %u", pvt.underrun_count_);
+    TEST_ASSERT(pvt.min_level_ == 0, "min level %u", pvt.min_level_);
+    TEST_ASSERT(step.Y == 20.0f && step.Yd == 0.0f, "holding at %f, %f", (double)step.Y, (double)step.Yd);
+
+    // resumes from the held point when new points arrive
+    pvt.push(30.0f, 0.0f, 0.01f);
+    TEST_ASSERT(pvt.step(dt, &step), "step failed");
+    TEST_ASSERT(pvt.state_ == PvtTrajectory::STATE_RUNNING, "state %d", pvt.state_);
+    TEST_ASSERT(fabsf(step.Y - 20.0f) < 0.01f && step.Yd == 0.0f, "resumed at %f, %f", (double)step.Y, (double)step.Yd);
+    return true;
+}
+
+bool pvt_test() {
+    return pvt_queue_test()
+        && pvt_interpolation_test()
+        && pvt_underrun_test();
+}
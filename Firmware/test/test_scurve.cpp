@@ -0,0 +1,110 @@
+#include <stddef.h>
+#include <stdint.h>
+
+#include "test_utils.hpp"
+#include <scurveTraj.hpp>
+
+static const float dt = 1.0f / 8000.0f; // current loop period
+
+struct Move_t {
+    const char* name;
+    float Xf, Xi, Vi;
+    float Vmax, Amax, Dmax, Jmax;
+};
+
+static const Move_t moves[] = {
+    { "long",               100000.0f,      0.0f,      0.0f, 20000.0f, 5000.0f, 5000.0f, 100000.0f },
+    { "long reverse",       -20000.0f,  30000.0f,      0.0f, 20000.0f, 8000.0f, 4000.0f, 100000.0f },
+    { "short",                 500.0f,      0.0f,      0.0f, 20000.0f, 5000.0f, 5000.0f, 100000.0f },
+    { "tiny",                    1.0f,      0.0f,      0.0f, 20000.0f, 5000.0f, 5000.0f, 100000.0f },
+    { "no accel plateau",    50000.0f,      0.0f,      0.0f,  2000.0f, 5000.0f, 5000.0f,  10000.0f },
+    { "moving start",        80000.0f,   1000.0f,  10000.0f, 20000.0f, 5000.0f, 5000.0f, 100000.0f },
+    { "moving away",         -5000.0f,      0.0f,   8000.0f, 20000.0f, 5000.0f, 5000.0f, 100000.0f },
+    { "overspeed start",     90000.0f,      0.0f,  30000.0f, 20000.0f, 5000.0f, 5000.0f, 100000.0f },
+    { "overshoot",             100.0f,      0.0f,  10000.0f, 20000.0f, 5000.0f, 5000.0f, 100000.0f },
+    { "zero",                  123.0f,    123.0f,      0.0f, 20000.0f, 5000.0f, 5000.0f, 100000.0f },
+};
+
+// Samples the trajectory at the control loop rate and checks that position,
+// velocity and acceleration are continuous and within the limits.
+static bool scurve_move_test(const Move_t& m) {
+    SCurveTrajectory traj;
+    TEST_ASSERT(traj.plan(m.Xf, m.Xi, m.Vi, m.Vmax, m.Amax, m.Dmax, m.Jmax), "%s: plan failed", m.name);
+    TEST_ASSERT(traj.Tf_ >= 0.0f && traj.Tf_ < 100.0f, "%s: Tf %f", m.name, (double)traj.Tf_);
+
+    // boundary conditions
+    SCurveTrajectory::Step_t first = traj.eval(0.0f);
+    TEST_ASSERT(fabsf(first.Y - m.Xi) <= 1e-3f * (1.0f + fabsf(m.Xi)), "%s: Y(0) %f", m.name, (double)first.Y);
+    TEST_ASSERT(fabsf(first.Yd - m.Vi) <= 1e-3f * (1.0f + fabsf(m.Vi)), "%s: Yd(0) %f", m.name, (double)first.Yd);
+    TEST_ASSERT(fabsf(first.Ydd) <= 1e-3f * m.Amax, "%s: Ydd(0) %f", m.name, (double)first.Ydd);
+    SCurveTrajectory::Step_t final = traj.eval(traj.Tf_);
+    TEST_ASSERT(final.Y == m.Xf && final.Yd == 0.0f && final.Ydd == 0.0f, "%s: final step", m.name);
+
+    float vel_lim = fmaxf(m.Vmax, fabsf(m.Vi));
+    float acc_lim = fmaxf(m.Amax, m.Dmax);
+    float pos_eps = 1e-6f * (fabsf(m.Xi) + fabsf(m.Xf)) + 1e-3f;
+    SCurveTrajectory::Step_t prev = first;
+    int n_steps = (int)(traj.Tf_ / dt) + 2;
+    for (int i = 1; i <= n_steps; ++i) {
+        float t = dt * (float)i;
+        SCurveTrajectory::Step_t step = traj.eval(t);
+        TEST_ASSERT(fabsf(step.Yd) <= vel_lim * 1.001f, "%s: t %f vel %f", m.name, (double)t, (double)step.Yd);
+        TEST_ASSERT(fabsf(step.Ydd) <= acc_lim * 1.001f, "%s: t %f accel %f", m.name, (double)t, (double)step.Ydd);
+        // a bounded derivative over one period means no jump at a segment boundary
+        TEST_ASSERT(fabsf(step.Y - prev.Y) <= vel_lim * dt * 1.01f + pos_eps,
+                "%s: t %f position jump %f", m.name, (double)t, (double)(step.Y - prev.Y));
+        TEST_ASSERT(fabsf(step.Yd - prev.Yd) <= acc_lim * dt * 1.01f + 1e-3f,
+                "%s: t %f velocity jump %f", m.name, (double)t, (double)(step.Yd - prev.Yd));
+        TEST_ASSERT(fabsf(step.Ydd - prev.Ydd) <= m.Jmax * dt * 1.01f + 1e-3f,
+                "%s: t %f acceleration jump %f", m.name, (double)t, (double)(step.Ydd - prev.Ydd));
+        prev = step;
+    }
+
+    // the last sample before the end must already be at the target
+    SCurveTrajectory::Step_t end = traj.eval(traj.Tf_ * (1.0f - 1e-6f));
+    TEST_ASSERT(fabsf(end.Y - m.Xf) <= 10.0f * pos_eps, "%s: Y(Tf-) %f", m.name, (double)end.Y);
+    TEST_ASSERT(fabsf(end.Yd) <= 1.0f, "%s: Yd(Tf-) %f", m.name, (double)end.Yd);
+    return true;
+}
+
+bool scurve_test() {
+    for (const Move_t& m : moves) {
+        if (!scurve_move_test(m))
+            return false;
+    }
+
+    // A long move from standstill takes A/J longer than the trapezoidal profile
+    const Move_t& m = moves[0];
+    SCurveTrajectory traj;
+    traj.plan(m.Xf, m.Xi, m.Vi, m.Vmax, m.Amax, m.Dmax, m.Jmax);
+    float trap_Tf = (m.Xf - m.Xi) / m.Vmax + 0.5f * m.Vmax / m.Amax + 0.5f * m.Vmax / m.Dmax;
+    float extra = traj.Tf_ - trap_Tf;
+    TEST_ASSERT(fabsf(extra - m.Amax / m.Jmax) < 1e-3f, "extra duration %f", (double)extra);
+
+    SCurveTrajectory invalid;
+    TEST_ASSERT(!invalid.plan(1.0f, 0.0f, 0.0f, 1.0f, 1.0f, 1.0f, 0.0f), "zero jerk limit must be rejected");
+    return true;
+}
+
+bool scurve_benchmark() {
+    const int n_steps = 10000000;
+    SCurveTrajectory traj;
+    traj.plan(100000.0f, 0.0f, 0.0f, 20000.0f, 5000.0f, 5000.0f, 100000.0f);
+    volatile float Tf = traj.Tf_;
+    float step_t = Tf / (float)n_steps;
+
+    float sum = 0.0f;
+    double t0 = test_time_s();
+    for (int i = 0; i < n_steps; ++i) {
+        SCurveTrajectory::Step_t step = traj.eval(step_t * (float)i);
+        sum += step.Y + step.Yd + step.Ydd;
+    }
+    double t_eval = (test_time_s() - t0) * 1e9 / n_steps;
+
+    printf("scurve benchmark: eval %.1f ns/step (%.4f%% of the %.0f ns current loop period, sum %.1f)\n",
+            t_eval, 100.0 * t_eval / (1e9 * dt), 1e9 * dt, (double)sum);
+    // a host CPU is 10-50x faster than the Cortex-M4, so 0.1% here is at most
+    // a few percent of the loop budget on the target
+    TEST_ASSERT(t_eval < 1e-3 * 1e9 * dt, "eval takes too long");
+    return true;
+}
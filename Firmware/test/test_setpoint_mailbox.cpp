@@ -0,0 +1,145 @@
+#include <stddef.h>
+#include <stdint.h>
+#include <atomic>
+#include <thread>
+
+#include "test_utils.hpp"
+#include <setpointMailbox.hpp>
+
+// @brief Command whose fields must always be seen together
+struct Command_t {
+    uint32_t seq;
+    float args[3];
+};
+
+static Command_t make_command(uint32_t seq) {
+    return { seq, { (float)seq, -(float)seq, 0.5f * (float)seq } };
+}
+
+static bool is_consistent(const Command_t& command) {
+    return command.args[0] == (float)command.seq
+        && command.args[1] == -(float)command.seq
+        && command.args[2] == 0.5f * (float)command.seq;
+}
+
+static bool mailbox_basic_test() {
+    Mailbox<Command_t> mailbox;
+    Command_t command;
+    TEST_ASSERT(!mailbox.fetch(&command), "fetched from an empty mailbox");
+
+    TEST_ASSERT(mailbox.try_post(make_command(1)), "post failed");
+    TEST_ASSERT(mailbox.fetch(&command) && command.seq == 1, "command 1 not fetched");
+    TEST_ASSERT(!mailbox.fetch(&command), "command fetched twice");
+
+    // the latest command wins
+    mailbox.try_post(make_command(2));
+    mailbox.try_post(make_command(3));
+    TEST_ASSERT(mailbox.fetch(&command) && command.seq == 3 && is_consistent(command), "command 3 not fetched");
+    TEST_ASSERT(mailbox.post_count_ == 3 && mailbox.dropped_count_ == 1 && mailbox.busy_count_ == 0,
+            "posted %u, dropped %u, busy %u", mailbox.post_count_, mailbox.dropped_count_, mailbox.busy_count_);
+    return true;
+}
+
+// @brief Command whose assignment calls back in the middle of the copy, to
+// see what the consumer and a second writer find while a writer is preempted.
+struct SlowCommand_t {
+    uint32_t seq = 0;
+    uint32_t check = 0;
+    static void (*preempt)();
+
+    SlowCommand_t& operator=(const SlowCommand_t& other) {
+        seq = other.seq;
+        if (preempt)
+            preempt();
+        check = other.check;
+        return *this;
+    }
+};
+void (*SlowCommand_t::preempt)() = nullptr;
+
+static Mailbox<SlowCommand_t>* preempted_mailbox;
+static bool preempted_fetch_ok;
+static bool preempted_post_ok;
+
+static bool mailbox_preempted_writer_test() {
+    Mailbox<SlowCommand_t> mailbox;
+    preempted_mailbox = &mailbox;
+    SlowCommand_t command;
+    command.seq = command.check = 1;
+    mailbox.try_post(command);
+
+    // The control loop and another writer run while the second command is half written
+    SlowCommand_t::preempt = []() {
+        SlowCommand_t::preempt = nullptr;
+        SlowCommand_t fetched;
+        preempted_fetch_ok = preempted_mailbox->fetch(&fetched);
+        preempted_post_ok = preempted_mailbox->try_post(fetched);
+    };
+    command.seq = command.check = 2;
+    TEST_ASSERT(mailbox.try_post(command), "post failed");
+    TEST_ASSERT(!preempted_fetch_ok, "fetched a command that is being written");
+    TEST_ASSERT(!preempted_post_ok, "two writers posted at the same time");
+    TEST_ASSERT(mailbox.busy_count_ == 1, "busy %u", mailbox.busy_count_);
+
+    // one cycle later the complete command is there
+    SlowCommand_t fetched;
+    TEST_ASSERT(mailbox.fetch(&fetched) && fetched.seq == 2 && fetched.check == 2, "command 2 not fetched");
+    return true;
+}
+
+// @brief A writer thread posts while the consumer polls. The writer yields
+// after each command so that the threads interleave on a single core as well.
+static bool mailbox_threaded_test() {
+    Mailbox<Command_t> mailbox;
+    const uint32_t n_commands = 50000;
+    std::atomic<bool> started{false};
+    std::atomic<bool> done{false};
+
+    std::thread writer([&]() {
+        while (!started)
+            std::this_thread::yield();
+        for (uint32_t seq = 1; seq <= n_commands; ++seq) {
+            while (!mailbox.try_post(make_command(seq)))
+                std::this_thread::yield();
+            std::this_thread::yield();
+        }
+        done = true;
+    });
+
+    uint32_t n_fetched = 0;
+    uint32_t n_torn = 0;
+    uint32_t n_reordered = 0;
+    uint32_t last_seq = 0;
+    started = true;
+    for (;;) {
+        bool finished = done;
+        Command_t command;
+        if (mailbox.fetch(&command)) {
+            ++n_fetched;
+            if (!is_consistent(command))
+                ++n_torn;
+            if (command.seq <= last_seq)
+                ++n_reordered;
+            last_seq = command.seq;
+        } else if (finished) {
+            break;
+        } else {
+            std::this_thread::yield();
+        }
+    }
+    writer.join();
+
+    printf("mailbox: fetched %u of %u commands, %u busy\n", n_fetched, n_commands, mailbox.busy_count_);
+    TEST_ASSERT(n_torn == 0, "%u torn commands", n_torn);
+    TEST_ASSERT(n_reordered == 0, "%u commands out of order", n_reordered);
+    TEST_ASSERT(last_seq == n_commands, "last command %u not fetched", last_seq);
+    TEST_ASSERT(n_fetched + mailbox.dropped_count_ == n_commands,
+            "fetched %u + dropped %u != %u", n_fetched, mailbox.dropped_count_, n_commands);
+    return true;
+}
+
+bool setpoint_mailbox_test() {
+    return mailbox_basic_test()
+        && mailbox_preempted_writer_test()
+        && mailbox_threaded_test();
+}
@@ -0,0 +1,84 @@
+#include <stddef.h>
+#include <stdint.h>
+
+#include "test_utils.hpp"
+#include <stepCounter.hpp>
+
+static const float dt = 1.0f / 8000.0f; // control loop period
+
+// @brief Step train as a step generator produces it: the step times are
+// quantized to its timer tick and the direction is the sign of the rate.
+struct StepTrain_t {
+    const char* name;
+    float tick;                 // [s] timer resolution of the step generator
+    float (*rate)(float t);     // [steps/s] commanded step rate
+    float duration;             // [s]
+};
+
+// @brief Feeds a step train into a StepCounter and compares the estimated
+// rate with the commanded rate.
+// @param max_err: allowed rate error after settle_time [steps/s]
+static bool step_train_test(const StepTrain_t& train, float bandwidth, float settle_time, float max_err) {
+    PllGains gains;
+    TEST_ASSERT(gains.set_bandwidth(bandwidth, dt), "unstable gains");
+    StepCounter counter;
+    counter.reset();
+
+    double phase = 0.0;     // [steps] integral of the rate
+    double t_gen = 0.0;     // step generator time
+    int32_t n_steps = 0;    // steps generated so far
+    int32_t n_counted = 0;  // sum of the steps returned by update()
+    float err = 0.0f;
+    float naive_err = 0.0f; // rate error of steps per cycle / dt
+    uint32_t n_cycles = (uint32_t)(train.duration / dt);
+    for (uint32_t i = 1; i <= n_cycles; ++i) {
+        double t_cycle = (double)i * (double)dt;
+        // generate the steps of this control cycle
+        for (; t_gen < t_cycle; t_gen += (double)train.tick) {
+            phase += (double)train.rate((float)t_gen) * (double)train.tick;
+            while (phase - (double)n_steps >= 1.0) {
+                counter.count_step(true);
+                ++n_steps;
+            }
+            while (phase - (double)n_steps <= -1.0) {
+                counter.count_step(false);
+                --n_steps;
+            }
+        }
+        int32_t steps = counter.update(dt, gains);
+        n_counted += steps;
+        float rate = train.rate((float)t_cycle);
+        if ((float)t_cycle > settle_time) {
+            err = fmaxf(err, fabsf(counter.get_vel() - rate));
+            naive_err = fmaxf(naive_err, fabsf((float)steps / dt - rate));
+        }
+    }
+    printf("step counter %s: max rate error %.1f steps/s (steps per cycle: %.1f steps/s)\n",
+            train.name, (double)err, (double)naive_err);
+    TEST_ASSERT(n_counted == n_steps && counter.last_count_ == n_steps,
+            "%s: counted %d of %d steps", train.name, n_counted, n_steps);
+    TEST_ASSERT(err <= max_err, "%s: rate error %f", train.name, (double)err);
+    return true;
+}
+
+bool step_counter_test() {
+    const float bandwidth = 100.0f; // [rad/s]
+    // A constant accel a lags by 4 a / kp = 2 a / bandwidth in a critically damped PLL.
+    const float accel = 20000.0f;   // [steps/s^2]
+    const float lag = 2.0f * accel / bandwidth;
+
+    const StepTrain_t trains[] = {
+        // 0.25 steps per control cycle from a step generator with a 50 us tick
+        { "constant 2 kHz", 50e-6f, [](float) { return 2000.0f; }, 1.0f },
+        // accelerate to 20 kHz, cruise
+        { "ramp", 10e-6f, [](float t) { return fminf(20000.0f * t, 20000.0f); }, 2.0f },
+        // forward, then backward
+        { "reversal", 20e-6f, [](float t) { return t < 0.5f ? 5000.0f : -5000.0f; }, 1.0f },
+    };
+    // During the ramp the error is the lag plus ripple, at constant rates
+    // only ripple. The reversal is checked once the estimate settled again.
+    return step_train_test(trains[0], bandwidth, 0.1f, 0.02f * 2000.0f)
+        && step_train_test(trains[1], bandwidth, 0.1f, 1.2f * lag)
+        && step_train_test({ "cruise after ramp", 10e-6f, trains[1].rate, 2.0f }, bandwidth, 1.2f, 0.01f * 20000.0f)
+        && step_train_test(trains[2], bandwidth, 0.7f, 0.02f * 5000.0f);
+}
@@ -0,0 +1,191 @@
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <math.h>
+#include <vector>
+
+#include "test_utils.hpp"
+#include <telemetry.hpp>
+
+// @brief Reference decoder, the same algorithm as tools/odrive/telemetry.py
+class TelemetryDecoder {
+public:
+    TelemetryDecoder(uint32_t n_channels, const float* resolution)
+        : n_channels_(n_channels), resolution_(resolution) {}
+
+    // @brief Decodes the frame at data and advances data past it
+    // @returns false if the frame was skipped because the decoder is not in sync
+    bool decode(const uint8_t** data, float* values) {
+        uint8_t header = *(*data)++;
+        bool keyframe = header & TelemetryEncoder::kKeyframeFlag;
+        uint8_t seq = header & 0x7f;
+        if (!keyframe && (!synced_ || seq != ((last_seq_ + 1) & 0x7f)))
+            synced_ = false;
+        else if (keyframe)
+            synced_ = true;
+        last_seq_ = seq;
+
+        if (keyframe) {
+            keyframe_time_us_ = 0;
+            for (uint32_t shift = 0; ; shift += 7) {
+                uint8_t byte = *(*data)++;
+                keyframe_time_us_ |= (uint64_t)(byte & 0x7f) << shift;
+                if (!(byte & 0x80))
+                    break;
+            }
+        }
+
+        for (uint32_t i = 0; i < n_channels_; ++i) {
+            uint32_t zigzag = 0;
+            for (uint32_t shift = 0; ; shift += 7) {
+                uint8_t byte = *(*data)++;
+                zigzag |= (uint32_t)(byte & 0x7f) << shift;
+                if (!(byte & 0x80))
+                    break;
+            }
+            int32_t diff = (int32_t)(zigzag >> 1) ^ -(int32_t)(zigzag & 1);
+            last_[i] = keyframe ? diff : (int32_t)((uint32_t)last_[i] + (uint32_t)diff);
+            values[i] = (float)last_[i] * resolution_[i];
+        }
+        return synced_;
+    }
+
+    uint64_t keyframe_time_us_ = 0; // [us] device time of the latest keyframe
+
+private:
+    uint32_t n_channels_;
+    const float* resolution_;
+    bool synced_ = false;
+    uint8_t last_seq_ = 0;
+    int32_t last_[TelemetryEncoder::kMaxChannels] = {};
+};
+
+// @brief Position, velocity and current of an axis moving back and forth,
+// with measurement noise
+static void make_sample(uint32_t i, float* values) {
+    float t = (float)i / 8000.0f;
+    float noise = (float)((i * 2654435761u) >> 24) / 256.0f - 0.5f;
+    values[0] = 20000.0f * sinf(2.0f * (float)M_PI * 0.5f * t) + noise;                        // [counts]
+    values[1] = 20000.0f * (float)M_PI * cosf(2.0f * (float)M_PI * 0.5f * t) + 50.0f * noise;  // [counts/s]
+    values[2] = 2.0f * sinf(2.0f * (float)M_PI * 0.5f * t) + 0.1f * noise;                     // [A]
+}
+
+static bool telemetry_roundtrip_test() {
+    TelemetryEncoder::Config_t config;
+    config.n_channels = 3;
+    config.keyframe_interval = 50;
+    config.resolution[0] = 0.1f;
+    config.resolution[1] = 1.0f;
+    config.resolution[2] = 0.001f;
+    TelemetryEncoder encoder;
+    TEST_ASSERT(encoder.start(config), "start failed");
+
+    TelemetryDecoder decoder(3, config.resolution);
+    uint8_t frame[TelemetryEncoder::kMaxFrameSize];
+    for (uint32_t i = 0; i < 1000; ++i) {
+        float values[3];
+        make_sample(i, values);
+        // beyond 32 bits, the device time is a uint64_t
+        uint64_t time_us = ((uint64_t)1 << 40) + (uint64_t)i * 125;
+        size_t length = encoder.encode(values, time_us, frame);
+        TEST_ASSERT(length <= sizeof(frame), "frame %u too long: %zu", i, length);
+
+        const uint8_t* data = frame;
+        float decoded[3];
+        TEST_ASSERT(decoder.decode(&data, decoded), "frame %u: not in sync", i);
+        TEST_ASSERT(data == frame + length, "frame %u: decoded %zu of %zu bytes", i, (size_t)(data - frame), length);
+        uint64_t keyframe_time_us = time_us - (uint64_t)(i % config.keyframe_interval) * 125;
+        TEST_ASSERT(decoder.keyframe_time_us_ == keyframe_time_us, "frame %u: keyframe time %llu us",
+                i, (unsigned long long)decoder.keyframe_time_us_);
+        for (uint32_t ch = 0; ch < 3; ++ch) {
+            TEST_ASSERT(fabsf(decoded[ch] - values[ch]) <= 0.5f * config.resolution[ch] * 1.01f + 1e-6f * fabsf(values[ch]),
+                    "frame %u channel %u: %f decoded as %f", i, ch, values[ch], decoded[ch]);
+        }
+    }
+
+    // values beyond the fixed point range saturate
+    float extreme[3] = { 1e30f, -1e30f, NAN };
+    encoder.force_keyframe();
+    encoder.encode(extreme, 0, frame);
+    const uint8_t* data = frame;
+    float decoded[3];
+    decoder.decode(&data, decoded);
+    TEST_ASSERT(decoded[0] > 2e8f && decoded[1] < -2e9f && decoded[2] == 0.0f,
+            "saturation: %f %f %f", decoded[0], decoded[1], decoded[2]);
+    return true;
+}
+
+static bool telemetry_stream_test() {
+    uint8_t buffer[256];
+    TelemetryStream stream(buffer, sizeof(buffer), 1.0f / 8000.0f);
+    stream.config_.n_channels = 2;
+    stream.config_.keyframe_interval = 100;
+    TEST_ASSERT(!stream.start(), "keyframes farther apart than half the buffer");
+    stream.config_.keyframe_interval = 4;
+    stream.config_.decimation = 2;
+    TEST_ASSERT(stream.start(), "start failed");
+
+    // The host falls behind: it continues at the latest keyframe
+    uint32_t counter = 0;
+    auto read = [&](uint32_t channel) { return channel ? -(float)counter : (float)counter; };
+    for (counter = 0; counter < 1000; ++counter)
+        stream.update(read, (uint64_t)counter * 125);
+    TEST_ASSERT(stream.frame_count_ == 500, "frames %u", stream.frame_count_);
+    TEST_ASSERT(stream.write_count_ - stream.last_keyframe_ < sizeof(buffer) / 2, "keyframe overwritten");
+
+    TelemetryDecoder decoder(2, stream.config_.resolution);
+    uint8_t data[256];
+    uint32_t n = stream.write_count_ - stream.last_keyframe_;
+    for (uint32_t i = 0; i < n; ++i)
+        data[i] = buffer[(stream.last_keyframe_ + i) % sizeof(buffer)];
+    const uint8_t* pos = data;
+    float values[2];
+    uint32_t n_frames = 0;
+    while (pos < data + n) {
+        TEST_ASSERT(decoder.decode(&pos, values), "not in sync");
+        ++n_frames;
+    }
+    TEST_ASSERT(pos == data + n, "frames don't end at write_count");
+    TEST_ASSERT(values[0] == 998.0f && values[1] == -998.0f, "last frame %f %f", values[0], values[1]);
+    TEST_ASSERT(n_frames >= 1 && n_frames <= 4, "%u frames since the keyframe", n_frames);
+    return true;
+}
+
+// @brief Compression ratio for typical signals and encoding time
+bool telemetry_benchmark() {
+    TelemetryEncoder::Config_t config;
+    config.n_channels = 3;
+    config.keyframe_interval = 100;
+    config.resolution[0] = 0.1f;
+    config.resolution[1] = 1.0f;
+    config.resolution[2] = 0.001f;
+    TelemetryEncoder encoder;
+    encoder.start(config);
+
+    const uint32_t n_samples = 8000;
+    std::vector<float> samples(3 * n_samples);
+    for (uint32_t i = 0; i < n_samples; ++i)
+        make_sample(i, &samples[3 * i]);
+
+    uint8_t frame[TelemetryEncoder::kMaxFrameSize];
+    const uint32_t n_repeat = 100;
+    size_t total = 0;
+    double t0 = test_time_s();
+    for (uint32_t repeat = 0; repeat < n_repeat; ++repeat) {
+        for (uint32_t i = 0; i < n_samples; ++i)
+            total += encoder.encode(&samples[3 * i], (uint64_t)i * 125, frame);
+    }
+    double t_frame = (test_time_s() - t0) * 1e9 / (n_repeat * n_samples);
+    double bytes_per_frame = (double)total / (n_repeat * n_samples);
+    double ratio = 3 * sizeof(float) / bytes_per_frame;
+
+    printf("telemetry benchmark: %.2f bytes/frame for 3 channels (%.1fx smaller than floats), %.1f ns/frame\n",
+            bytes_per_frame, ratio, t_frame);
+    TEST_ASSERT(ratio > 1.5, "compression ratio %.2f", ratio);
+    return true;
+}
+
+bool telemetry_test() {
+    return telemetry_roundtrip_test()
+        && telemetry_stream_test();
+}
@@ -0,0 +1,125 @@
+#include <stddef.h>
+#include <stdint.h>
+#include <stdlib.h>
+
+#include "test_utils.hpp"
+#include <timedSetpoint.hpp>
+
+static const float dt = 1.0f / 8000.0f; // control loop period
+static const uint32_t dt_us = 125;
+
+// @brief Sends a ramp at 200 Hz with the given host clock start and random
+// transport delays, and checks that the setpoint follows it smoothly.
+// @param host_t0: [us] host time of the first sample, 0 for device timestamps
+// @param max_delay: [us] transport delays are uniform in [0, max_delay]
+static bool timed_ramp_test(const char* name, uint32_t host_t0, uint32_t max_delay) {
+    const float vel = 2000.0f;          // [counts/s]
+    const uint32_t interval = 5000;     // [us] 200 Hz
+    const uint32_t n_ticks = 8000;      // 1 s
+    TimedSetpoint::Config_t config;
+    config.delay = 0.01f;
+    TimedSetpoint timed(config);
+    timed.start(0.0f, dt);
+
+    // samples in flight: host time and arrival tick
+    struct { float pos; uint32_t host_time; uint32_t arrival; } pending[8];
+    size_t n_pending = 0;
+    uint32_t next_send = 0;
+    srand(42);
+
+    TimedSetpoint::Step_t step;
+    float prev_Y = 0.0f;
+    float max_vel_err = 0.0f;
+    for (uint32_t tick = 0; tick < n_ticks; ++tick) {
+        uint32_t now = tick * dt_us;
+        if (now >= next_send) {
+            uint32_t delay = max_delay ? (uint32_t)rand() % (max_delay + 1) : 0;
+            pending[n_pending++] = { vel * (float)next_send * 1e-6f, next_send, next_send + delay };
+            next_send += interval;
+        }
+        for (size_t i = 0; i < n_pending; ) {
+            if (pending[i].arrival <= now) {
+                uint32_t timestamp = host_t0 ? host_t0 + pending[i].host_time : 0;
+                TEST_ASSERT(timed.push(pending[i].pos, timestamp), "%s: push failed", name);
+                pending[i] = pending[--n_pending];
+            } else {
+                ++i;
+            }
+        }
+        timed.step(&step);
+        TEST_ASSERT(fabsf(step.Y - prev_Y) <= vel * dt * 1.1f + 1e-3f,
+                "%s: tick %u: jump from %f to %f", name, tick, (double)prev_Y, (double)step.Y);
+        prev_Y = step.Y;
+        if (tick * dt_us > 500000) // after the clock mapping settled
+            max_vel_err = fmaxf(max_vel_err, fabsf(step.Yd - vel));
+    }
+    printf("timed setpoint %s: max velocity error %.2f counts/s, interval %.2f ms, jitter %.3f ms (max %.3f ms)\n",
+            name, (double)max_vel_err, (double)timed.interval_ * 1e3, (double)timed.jitter_ * 1e3, (double)timed.max_jitter_ * 1e3);
+    TEST_ASSERT(timed.underflow_count_ == 0 && timed.late_count_ == 0,
+            "%s: %u underflows, %u late", name, timed.underflow_count_, timed.late_count_);
+    // the last sample may still be in flight
+    TEST_ASSERT(timed.sample_count_ + 1 >= n_ticks * dt_us / interval, "%s: %u samples", name, timed.sample_count_);
+    TEST_ASSERT(timed.max_jitter_ <= (float)max_delay * 1e-6f + 1e-6f, "%s: max jitter", name);
+    if (host_t0) {
+        // Without the timestamps, the velocity would be off by up to 60% (3 ms
+        // of 5 ms). What remains are small corrections of the clock mapping.
+        TEST_ASSERT(max_vel_err < 0.03f * vel, "%s: velocity error %f", name, (double)max_vel_err);
+    } else {
+        TEST_ASSERT(fabsf(timed.interval_ * 1e6f - (float)interval) < 1.0f, "%s: interval %f", name, (double)timed.interval_);
+        TEST_ASSERT(max_vel_err < 0.01f * vel, "%s: velocity error %f", name, (double)max_vel_err);
+    }
+    return true;
+}
+
+// When the samples stop, the last slope is continued for max_extrapolation,
+// then the position is held. Late samples are approached without a jump.
+static bool timed_underflow_test() {
+    TimedSetpoint::Config_t config;
+    config.delay = 0.005f;
+    config.max_extrapolation = 0.01f;
+    TimedSetpoint timed(config);
+    timed.start(100.0f, dt);
+    TimedSetpoint::Step_t step;
+
+    auto run = [&](uint32_t n_ticks, float* max_step) {
+        float prev = step.Y;
+        for (uint32_t i = 0; i < n_ticks; ++i) {
+            timed.step(&step);
+            *max_step = fmaxf(*max_step, fabsf(step.Y - prev));
+            prev = step.Y;
+        }
+    };
+
+    float max_step = 0.0f;
+    timed.step(&step);
+    TEST_ASSERT(step.Y == 100.0f && step.Yd == 0.0f, "initial step %f %f", (double)step.Y, (double)step.Yd);
+    // 1000 counts/s for 10 samples at 1 ms
+    for (int i = 0; i <= 10; ++i) {
+        timed.push(100.0f + (float)i, 0);
+        run(8, &max_step);
+    }
+    run(40 + 80, &max_step); // past the delay and the extrapolation
+    TEST_ASSERT(timed.underflow_count_ == 1, "underflow count %u", timed.underflow_count_);
+    TEST_ASSERT(fabsf(step.Y - 120.0f) < 0.01f && step.Yd == 0.0f, "holding at %f, %f", (double)step.Y, (double)step.Yd);
+    TEST_ASSERT(max_step <= 1000.0f * dt * 1.1f, "jump of %f counts", (double)max_step);
+
+    // A sample arriving long after the stream stopped is approached from the
+    // held position within the delay, without a jump.
+    max_step = 0.0f;
+    timed.push(110.0f, 0);
+    run(200, &max_step);
+    TEST_ASSERT(fabsf(step.Y - 110.0f) < 1e-3f, "ends at %f", (double)step.Y);
+    TEST_ASSERT(max_step <= 10.0f / config.delay * dt * 1.1f, "jump of %f counts", (double)max_step);
+
+    // restarting resets the statistics
+    timed.start(step.Y, dt);
+    TEST_ASSERT(timed.underflow_count_ == 0 && timed.sample_count_ == 0, "statistics not reset");
+    return true;
+}
+
+bool timed_setpoint_test() {
+    return timed_ramp_test("device timestamps", 0, 0)
+        && timed_ramp_test("host timestamps", 1000000, 3000)
+        && timed_ramp_test("host timestamps wrapping", 0xFFF00000u, 3000)
+        && timed_underflow_test();
+}
@@ -0,0 +1,54 @@
+#include <stddef.h>
+#include <stdint.h>
+
+#include "test_utils.hpp"
+#include <timingStats.hpp>
+
+static bool timing_buckets_test() {
+    TEST_ASSERT(TimingStats::get_bucket(0) == 0 && TimingStats::get_bucket(127) == 0, "first bucket");
+    TEST_ASSERT(TimingStats::get_bucket(0xFFFFFFFFu) == TimingStats::kNumBuckets - 1, "last bucket");
+
+    // consecutive buckets, each one covering [lower bound, next lower bound)
+    for (uint32_t bucket = 0; bucket < TimingStats::kNumBuckets - 1; ++bucket) {
+        uint32_t lower = TimingStats::get_bucket_lower_bound(bucket);
+        uint32_t next = TimingStats::get_bucket_lower_bound(bucket + 1);
+        TEST_ASSERT(next > lower, "bucket %u: bounds %u, %u", bucket, lower, next);
+        TEST_ASSERT(TimingStats::get_bucket(lower) == bucket && TimingStats::get_bucket(next - 1) == bucket,
+                "bucket %u: [%u, %u) maps to %u, %u", bucket, lower, next,
+                TimingStats::get_bucket(lower), TimingStats::get_bucket(next - 1));
+        if (bucket > 0)
+            TEST_ASSERT((float)next / (float)lower <= 1.26f, "bucket %u too wide: [%u, %u)", bucket, lower, next);
+    }
+    return true;
+}
+
+static bool timing_record_test() {
+    TimingStats stats;
+    TEST_ASSERT(stats.get_mean() == 0 && stats.count_ == 0, "not empty");
+
+    // a control loop that takes 5000 cycles and overruns once
+    for (uint32_t i = 0; i < 999; ++i)
+        stats.record(5000 + i % 10);
+    stats.record(30000);
+    TEST_ASSERT(stats.count_ == 1000, "count %u", stats.count_);
+    TEST_ASSERT(stats.min_ == 5000 && stats.max_ == 30000, "min %u, max %u", stats.min_, stats.max_);
+    TEST_ASSERT(stats.get_mean() == 5029, "mean %u", stats.get_mean());
+    TEST_ASSERT(stats.get_bucket_count(TimingStats::get_bucket(5000)) == 999, "typical bucket");
+    TEST_ASSERT(stats.get_bucket_count(TimingStats::get_bucket(30000)) == 1, "overrun bucket");
+
+    uint32_t total = 0;
+    for (uint32_t bucket = 0; bucket < TimingStats::kNumBuckets; ++bucket)
+        total += stats.get_bucket_count(bucket);
+    TEST_ASSERT(total == 1000, "histogram total %u", total);
+
+    stats.reset();
+    stats.record(7000);
+    TEST_ASSERT(stats.min_ == 7000 && stats.max_ == 7000 && stats.get_mean() == 7000 && stats.count_ == 1,
+            "after reset: min %u, max %u, mean %u", stats.min_, stats.max_, stats.get_mean());
+    return true;
+}
+
+bool timing_stats_test() {
+    return timing_buckets_test()
+        && timing_record_test();
+}
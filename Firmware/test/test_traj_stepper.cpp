@@ -0,0 +1,129 @@
+#include <stddef.h>
+#include <stdint.h>
+
+#include "test_utils.hpp"
+#include <scurveTraj.hpp>
+#include <trajStepper.hpp>
+
+static const float dt = 1.0f / 8000.0f; // control loop period
+
+// @brief Steps through a planned S-curve and compares every tick with the
+// closed form evaluation at t = tick * dt.
+static bool stepper_regression_test(float Xf, float Xi, float Vi, float Vmax, float Amax, float Jmax) {
+    SCurveTrajectory traj;
+    TEST_ASSERT(traj.plan(Xf, Xi, Vi, Vmax, Amax, Amax, Jmax), "plan failed");
+    TrajectoryStepper stepper;
+    traj.load(stepper, dt);
+
+    // the closed form computes the time as a float, so allow for its rounding
+    float pos_tol = 1e-6f * (fabsf(Xi) + fabsf(Xf)) + 2e-7f * Vmax * traj.Tf_ + 1e-3f;
+    TrajectoryStepper::Step_t step;
+    uint32_t n = 0;
+    while (stepper.step(&step)) {
+        float t = (float)((double)n * (double)dt);
+        SCurveTrajectory::Step_t ref = traj.eval(t);
+        TEST_ASSERT(t <= traj.Tf_, "tick %u after the end", n);
+        TEST_ASSERT(fabsf(step.Y - ref.Y) <= pos_tol, "tick %u: Y %f expected %f", n, (double)step.Y, (double)ref.Y);
+        TEST_ASSERT(fabsf(step.Yd - ref.Yd) <= 1e-3f * Vmax, "tick %u: Yd %f expected %f", n, (double)step.Yd, (double)ref.Yd);
+        TEST_ASSERT(fabsf(step.Ydd - ref.Ydd) <= 1e-3f * Amax + 2.0f * Jmax * dt,
+                "tick %u: Ydd %f expected %f", n, (double)step.Ydd, (double)ref.Ydd);
+        ++n;
+    }
+    TEST_ASSERT(n == (uint32_t)floorf(traj.Tf_ / dt) + 1, "%u ticks for Tf %f", n, (double)traj.Tf_);
+    TEST_ASSERT(step.Y == Xf && step.Yd == 0.0f && step.Ydd == 0.0f, "final step");
+
+    // restarting replays the same trajectory
+    stepper.restart();
+    TEST_ASSERT(stepper.step(&step) && step.Y == traj.eval(0.0f).Y, "restart failed");
+    return true;
+}
+
+// @brief A long cruise followed by a deceleration. The stepper stays within
+// a few float ulps of a double precision reference however long the move
+// is, and the velocity ramps down evenly. A float time base quantizes the
+// time to its resolution at t = 1000 s (61 us), so its velocity steps by
+// zero, one or two ticks' worth.
+static bool stepper_long_move_test() {
+    const float vel = 1000.0f;      // [counts/s]
+    const float decel = 5000.0f;    // [counts/s^2]
+    const float t_cruise = 1000.0f; // [s], 8M ticks
+    const float t_decel = vel / decel;
+    const float x_decel = vel * t_cruise;
+    const float Tf = t_cruise + t_decel;
+    const float cruise[4] = { 0.0f, vel, 0.0f, 0.0f };
+    const float decelerate[4] = { x_decel, vel, -0.5f * decel, 0.0f };
+    TrajectoryStepper stepper;
+    stepper.begin(dt);
+    stepper.add_segment(0.0f, cruise);
+    stepper.add_segment(t_cruise, decelerate);
+    stepper.finish(Tf, x_decel + 0.5f * vel * t_decel);
+
+    double max_err = 0.0;
+    float max_jitter = 0.0f;
+    float max_jitter_float_time = 0.0f;
+    float prev_vel = vel;
+    float prev_vel_float_time = vel;
+    TrajectoryStepper::Step_t step;
+    for (uint32_t n = 0; stepper.step(&step); ++n) {
+        double t = (double)n * (double)dt;
+        double ref = t < (double)t_cruise ? (double)vel * t
+                : (double)x_decel + (double)vel * (t - t_cruise) - 0.5 * decel * (t - t_cruise) * (t - t_cruise);
+        max_err = fmax(max_err, fabs((double)step.Y - ref));
+
+        float t_float = (float)n * dt; // what a float time base would produce
+        if (t_float > t_cruise + dt && t < (double)(Tf - dt)) {
+            float vel_float_time = decel * (Tf - t_float); // as in TrapezoidalTrajectory::eval
+            max_jitter = fmaxf(max_jitter, fabsf(prev_vel - step.Yd - decel * dt));
+            max_jitter_float_time = fmaxf(max_jitter_float_time, fabsf(prev_vel_float_time - vel_float_time - decel * dt));
+            prev_vel_float_time = vel_float_time;
+        } else {
+            prev_vel_float_time = step.Yd;
+        }
+        prev_vel = step.Yd;
+    }
+    printf("trajectory stepper: max error over %.0f s: %.4f counts, velocity step jitter %.4f counts/s (float time base: %.4f counts/s)\n",
+            (double)Tf, max_err, (double)max_jitter, (double)max_jitter_float_time);
+    double ulp = (double)x_decel * 1.2e-7;
+    TEST_ASSERT(max_err <= 2.0 * ulp, "max error %f", max_err);
+    TEST_ASSERT(max_jitter < 0.01f * decel * dt, "velocity jitter %f", (double)max_jitter);
+    return true;
+}
+
+bool traj_stepper_test() {
+    return stepper_regression_test(100000.0f, 0.0f, 0.0f, 20000.0f, 5000.0f, 100000.0f)
+        && stepper_regression_test(-20000.0f, 30000.0f, 0.0f, 20000.0f, 8000.0f, 100000.0f)
+        && stepper_regression_test(500.0f, 0.0f, 0.0f, 20000.0f, 5000.0f, 100000.0f)
+        && stepper_regression_test(80000.0f, 1000.0f, 10000.0f, 20000.0f, 5000.0f, 100000.0f)
+        && stepper_regression_test(100.0f, 0.0f, 10000.0f, 20000.0f, 5000.0f, 100000.0f)
+        && stepper_regression_test(123.0f, 123.0f, 0.0f, 20000.0f, 5000.0f, 100000.0f)
+        && stepper_long_move_test();
+}
+
+bool traj_stepper_benchmark() {
+    SCurveTrajectory traj;
+    traj.plan(1e6f, 0.0f, 0.0f, 20000.0f, 5000.0f, 5000.0f, 100000.0f);
+    TrajectoryStepper stepper;
+    traj.load(stepper, dt);
+    uint32_t n_steps = stepper.end_tick_;
+
+    float sum_eval = 0.0f;
+    double t0 = test_time_s();
+    for (uint32_t i = 0; i < n_steps; ++i) {
+        SCurveTrajectory::Step_t step = traj.eval((float)i * dt);
+        sum_eval += step.Y + step.Yd + step.Ydd;
+    }
+    double t_eval = (test_time_s() - t0) * 1e9 / n_steps;
+
+    float sum_step = 0.0f;
+    TrajectoryStepper::Step_t step;
+    t0 = test_time_s();
+    while (stepper.step(&step))
+        sum_step += step.Y + step.Yd + step.Ydd;
+    double t_step = (test_time_s() - t0) * 1e9 / n_steps;
+
+    printf("trajectory stepper benchmark: eval(t) %.1f ns/cycle (sum %.1f), step() %.1f ns/cycle (sum %.1f)\n",
+            t_eval, (double)sum_eval, t_step, (double)sum_step);
+    // generous margin, this is only meant to catch gross regressions
+    TEST_ASSERT(t_step < 2.0 * t_eval, "step() is much slower than eval()");
+    return true;
+}
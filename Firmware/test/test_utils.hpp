@@ -0,0 +1,26 @@
+#ifndef __TEST_UTILS_HPP
+#define __TEST_UTILS_HPP
+
+#include <stdio.h>
+#include <math.h>
+#include <time.h>
+
+// @brief Prints a message and makes the enclosing test function return false
+// if the condition does not hold.
+#define TEST_ASSERT(cond, ...) do { \
+        if (!(cond)) { \
+            printf("%s:%d: assertion failed: %s: ", __FILE__, __LINE__, #cond); \
+            printf(__VA_ARGS__); \
+            printf("\n"); \
+            return false; \
+        } \
+    } while (0)
+
+// @brief Monotonic time in seconds, for the rough benchmarks
+static inline double test_time_s() {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (double)ts.tv_sec + 1e-9 * (double)ts.tv_nsec;
+}
+
+#endif // __TEST_UTILS_HPP
@@ -0,0 +1,125 @@
+"""
+Relates the host clock to the device clock of an ODrive.
+"""
+
+from __future__ import print_function
+
+import time
+
+class ClockSync(object):
+    """
+    Estimates the offset and drift between the host clock and the
+    microsecond clock of an ODrive (odrv.get_timestamp_us()).
+
+    Each sample is a round trip: the device timestamp is assumed to be taken
+    halfway between sending the request and receiving the response. Round
+    trips that took longer than usual are mostly due to queueing somewhere
+    on the way and carry an unknown asymmetry, so only the fastest samples
+    of the window are used for a least squares fit of
+    device_time = offset + (1 + drift) * host_time.
+
+    Usage:
+        sync = ClockSync(odrv0)
+        sync.update(32)
+        t_device = sync.to_device(time.perf_counter())
+    """
+
+    def __init__(self, odrv, window=128, clock=None):
+        """
+        odrv: The device, or anything with a get_timestamp_us() function
+        window: Number of recent samples to keep
+        clock: Host clock in seconds, time.perf_counter by default
+        """
+        self._odrv = odrv
+        self._window = window
+        self._clock = clock or getattr(time, 'perf_counter', time.time)
+        self._samples = [] # (host time [s], device time [s], round trip time [s])
+        self._host_ref = None
+        self.offset = 0.0   # [s] device time at host time _host_ref
+        self.drift = 0.0    # device seconds per host second - 1
+
+    def sample(self):
+        """
+        Takes one round trip sample.
+        Returns the round trip time in seconds.
+        """
+        t_send = self._clock()
+        device_us = self._odrv.get_timestamp_us()
+        t_recv = self._clock()
+        self.add_sample(t_send, device_us, t_recv)
+        return t_recv - t_send
+
+    def add_sample(self, t_send, device_us, t_recv):
+        """
+        Adds a round trip that was measured elsewhere, e.g. together with a
+        command. t_send and t_recv are host times [s], device_us is the
+        device timestamp [us] taken in between.
+        """
+        self._samples.append(((t_send + t_recv) / 2.0, device_us * 1e-6, t_recv - t_send))
+        del self._samples[:-self._window]
+        if self._host_ref is None:
+            self._host_ref = self._samples[0][0]
+        self._fit()
+
+    def update(self, n_samples=16):
+        """
+        Takes n_samples round trips and refits the clock mapping.
+        """
+        for _ in range(n_samples):
+            self.sample()
+
+    def to_device(self, host_time):
+        """
+        Converts a host time [s] to device time [s]
+        """
+        return self.offset + (1.0 + self.drift) * (host_time - self._host_ref)
+
+    def to_host(self, device_time):
+        """
+        Converts a device time [s] (e.g. timestamp_us * 1e-6) to host time [s]
+        """
+        return self._host_ref + (device_time - self.offset) / (1.0 + self.drift)
+
+    def now(self):
+        """
+        Current device time [s] according to the host clock
+        """
+        return self.to_device(self._clock())
+
+    def get_round_trip_stats(self):
+        """
+        Returns (min, mean, max) round trip time [s] over the window
+        """
+        rtts = [s[2] for s in self._samples]
+        return min(rtts), sum(rtts) / len(rtts), max(rtts)
+
+    def get_uncertainty(self):
+        """
+        Half the fastest round trip time [s]: the device timestamp may lie
+        anywhere within the round trip, so this bounds the offset error.
+        """
+        return min(s[2] for s in self._samples) / 2.0
+
+    def _fit(self):
+        # use the fastest half of the samples
+        rtts = sorted(s[2] for s in self._samples)
+        threshold = rtts[(len(rtts) - 1) // 2]
+        points = [(s[0] - self._host_ref, s[1]) for s in self._samples if s[2] <= threshold]
+
+        n = float(len(points))
+        mean_x = sum(p[0] for p in points) / n
+        mean_y = sum(p[1] for p in points) / n
+        sxx = sum((p[0] - mean_x) ** 2 for p in points)
+        sxy = sum((p[0] - mean_x) * (p[1] - mean_y) for p in points)
+        # The drift is only observable over a longer time span. Until then,
+        # assume that the clocks run at the same rate.
+        if sxx > 1.0:
+            self.drift = sxy / sxx - 1.0
+        self.offset = mean_y - (1.0 + self.drift) * mean_x
+
+    def __str__(self):
+        if not self._samples:
+            return "no samples"
+        rtt_min, rtt_mean, rtt_max = self.get_round_trip_stats()
+        return ("offset {:.6f} s, drift {:.1f} ppm, round trip {:.3f}/{:.3f}/{:.3f} ms (min/mean/max)"
+                .format(self.offset, self.drift * 1e6, rtt_min * 1e3, rtt_mean * 1e3, rtt_max * 1e3))
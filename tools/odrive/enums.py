@@ -52,6 +52,7 @@ class errors:
     class controller:
         ERROR_NONE = 0
         ERROR_OVERSPEED = 0x01
+        ERROR_INVALID_LEADER_AXIS = 0x02
 
 MOTOR_TYPE_HIGH_CURRENT = 0
 #MOTOR_TYPE_LOW_CURRENT = 1
@@ -61,6 +62,20 @@ CTRL_MODE_VOLTAGE_CONTROL = 0
 CTRL_MODE_CURRENT_CONTROL = 1
 CTRL_MODE_VELOCITY_CONTROL = 2
 CTRL_MODE_POSITION_CONTROL = 3
+CTRL_MODE_TRAJECTORY_CONTROL = 4
+CTRL_MODE_PVT_CONTROL = 5
+CTRL_MODE_TIMED_POSITION_CONTROL = 6
+CTRL_MODE_FOLLOWER_CONTROL = 7
 
 ENCODER_MODE_INCREMENTAL = 0
 ENCODER_MODE_HALL = 1
+
+OSCILLOSCOPE_STATE_IDLE = 0
+OSCILLOSCOPE_STATE_ARMED = 1
+OSCILLOSCOPE_STATE_TRIGGERED = 2
+OSCILLOSCOPE_STATE_DONE = 3
+
+TRIGGER_MODE_IMMEDIATE = 0
+TRIGGER_MODE_RISING = 1
+TRIGGER_MODE_FALLING = 2
+TRIGGER_MODE_NONZERO = 3
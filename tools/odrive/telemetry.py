@@ -0,0 +1,172 @@
+"""
+Decodes the compact telemetry frames of an ODrive (odrv.telemetry).
+"""
+
+from __future__ import print_function
+
+import time
+
+KEYFRAME_FLAG = 0x80
+
+class TelemetryDecoder(object):
+    """
+    Decodes a stream of telemetry frames (see Firmware/MotorControl/telemetry.hpp).
+
+    A frame is a header byte (bit 7 set for keyframes, bits 0-6 a frame
+    counter), in keyframes the device time in microseconds as a varint, and
+    one zigzag varint per channel: the value in keyframes, the difference to
+    the previous frame otherwise. Values are multiplied by the resolution of
+    their channel.
+
+    The device time of a frame is the time of the latest keyframe plus the
+    frame period (odrv.telemetry.frame_period) for each frame since then.
+    ClockSync.to_host() maps it to the host clock.
+
+    Frames that can't be decoded because a keyframe is missing are skipped.
+    The stream must start at a frame boundary but may be fed in arbitrary chunks.
+    """
+
+    def __init__(self, resolution, frame_period=None):
+        """
+        resolution: value of one LSB of each channel, the length is the number of channels
+        frame_period: time between two frames [s], only needed for the sample times
+        """
+        self._resolution = list(resolution)
+        self._frame_period = frame_period
+        self._keyframe_time = None
+        self._frames_since_keyframe = 0
+        self._last = [0] * len(self._resolution)
+        self._last_seq = None
+        self._synced = False
+        self._pending = bytearray()
+        self.skipped_frames = 0
+
+    def reset(self):
+        """
+        Discards partial frames and waits for the next keyframe,
+        e.g. after bytes of the stream were lost
+        """
+        self._pending = bytearray()
+        self._synced = False
+
+    def feed(self, data, with_time=False):
+        """
+        Decodes as many complete frames as possible.
+        Returns a list of samples, each a list of channel values, or with
+        with_time a list of (device time [s], channel values) tuples.
+        """
+        if with_time and self._frame_period is None:
+            raise ValueError("the sample times need the frame period")
+        self._pending += bytearray(data)
+        samples = []
+        pos = 0
+        while True:
+            frame = self._parse_frame(pos)
+            if frame is None:
+                break
+            (pos, header, time_us, diffs) = frame
+            sample = self._apply(header, time_us, diffs)
+            if sample is None:
+                self.skipped_frames += 1
+            elif with_time:
+                t = self._keyframe_time + self._frames_since_keyframe * self._frame_period
+                samples.append((t, sample))
+            else:
+                samples.append(sample)
+        del self._pending[:pos]
+        return samples
+
+    def _parse_varint(self, pos):
+        value = 0
+        shift = 0
+        while True:
+            if pos >= len(self._pending):
+                return None # incomplete frame
+            byte = self._pending[pos]
+            pos += 1
+            value |= (byte & 0x7f) << shift
+            shift += 7
+            if not (byte & 0x80):
+                return (pos, value)
+
+    def _parse_frame(self, pos):
+        if pos >= len(self._pending):
+            return None
+        header = self._pending[pos]
+        pos += 1
+        time_us = None
+        if header & KEYFRAME_FLAG:
+            varint = self._parse_varint(pos)
+            if varint is None:
+                return None
+            (pos, time_us) = varint
+        diffs = []
+        for _ in self._resolution:
+            varint = self._parse_varint(pos)
+            if varint is None:
+                return None
+            (pos, zigzag) = varint
+            diffs.append((zigzag >> 1) ^ -(zigzag & 1))
+        return (pos, header, time_us, diffs)
+
+    def _apply(self, header, time_us, diffs):
+        keyframe = bool(header & KEYFRAME_FLAG)
+        seq = header & 0x7f
+        if keyframe:
+            self._synced = True
+            self._keyframe_time = time_us * 1e-6
+            self._frames_since_keyframe = 0
+        elif self._last_seq is None or seq != ((self._last_seq + 1) & 0x7f):
+            self._synced = False
+        else:
+            self._frames_since_keyframe += 1
+        self._last_seq = seq
+        for i, diff in enumerate(diffs):
+            value = diff if keyframe else self._last[i] + diff
+            self._last[i] = ((value + 2**31) % 2**32) - 2**31 # wraps around like int32
+        if not self._synced:
+            return None
+        return [value * resolution for (value, resolution) in zip(self._last, self._resolution)]
+
+
+def read_telemetry(odrv, duration, poll_interval=0.01, with_time=False):
+    """
+    Reads the telemetry stream of a running capture (odrv.telemetry.start())
+    for duration seconds and returns the decoded samples, each a list of
+    channel values, or with with_time a (device time [s], channel values)
+    tuple. ClockSync.to_host() maps the device time to the host clock.
+    If the host falls behind by more than the buffer size, it continues at
+    the latest keyframe and the samples in between are lost.
+    """
+    telemetry = odrv.telemetry
+    config = telemetry.config
+    n_channels = config.n_channels
+    resolution = [getattr(config, 'resolution{}'.format(i)) for i in range(n_channels)]
+    decoder = TelemetryDecoder(resolution, telemetry.frame_period)
+    buffer_size = len(telemetry.buffer)
+
+    samples = []
+    read_count = None
+    t_end = time.time() + duration
+    while time.time() < t_end:
+        write_count = telemetry.write_count
+        if read_count is None or (write_count - read_count) % 2**32 > buffer_size:
+            # (re)start at the latest keyframe
+            read_count = telemetry.last_keyframe
+            decoder.reset()
+            continue # write_count must be read after last_keyframe
+        n_bytes = (write_count - read_count) % 2**32
+        if not n_bytes:
+            time.sleep(poll_interval)
+            continue
+        start = read_count % buffer_size
+        data = telemetry.buffer.read(start, min(n_bytes, buffer_size - start))
+        if len(data) < n_bytes:
+            data += telemetry.buffer.read(0, n_bytes - len(data))
+        # the bytes are only valid if they weren't overwritten while reading
+        if (telemetry.write_count - read_count) % 2**32 > buffer_size:
+            read_count = None
+            continue
+        samples += decoder.feed(data, with_time)
+        read_count = write_count
+    return samples
@@ -59,6 +59,56 @@ def dump_errors(odrv, clear=False):
             else:
                 print(prefix + _VT100Colors['green'] + "no error" + _VT100Colors['default'])
 
+# Motor::TimingLog_t
+TIMING_LOG_SLOTS = ['GENERAL', 'ADC_CB_I', 'ADC_CB_DC', 'MEAS_R', 'MEAS_L', 'ENC_CALIB', 'IDX_SEARCH',
+                    'FOC_VOLTAGE', 'FOC_CURRENT', 'ENCODER', 'SENSORLESS', 'CONTROLLER']
+CPU_CLOCK_HZ = 168e6
+
+def dump_timing(odrv, histogram=False, reset=False):
+    """
+    Prints how far into the control period [us] each timing point of each
+    motor was reached: minimum, mean and maximum since the last reset.
+    With histogram=True the non-empty histogram buckets are listed as well.
+    The last line is the deadline slack of the PWM timings.
+    """
+    axes = [axis for name, axis in odrv._remote_attributes.items() if 'axis' in name]
+    for num, axis in enumerate(axes):
+        stats = axis.motor.timing_stats
+        print('Axis{}:'.format(num))
+        print('  {:<12} {:>9} {:>9} {:>9} {:>9}'.format('slot', 'count', 'min', 'mean', 'max'))
+        for slot, name in enumerate(TIMING_LOG_SLOTS):
+            count = stats.get_count(slot)
+            if not count:
+                continue
+            print('  {:<12} {:>9} {:>9.2f} {:>9.2f} {:>9.2f}'.format(name, count,
+                  stats.get_min(slot) * 1e6 / CPU_CLOCK_HZ,
+                  stats.get_mean(slot) * 1e6 / CPU_CLOCK_HZ,
+                  stats.get_max(slot) * 1e6 / CPU_CLOCK_HZ))
+            if histogram:
+                bucket = 0
+                while True:
+                    lower = stats.get_bucket_lower_bound(bucket)
+                    upper = stats.get_bucket_lower_bound(bucket + 1)
+                    n = stats.get_histogram(slot, bucket)
+                    if upper == lower:
+                        # the last bucket has no upper bound
+                        if n:
+                            print('    {:>9.2f} .. {:>9} us: {}'.format(lower * 1e6 / CPU_CLOCK_HZ, '', n))
+                        break
+                    if n:
+                        print('    {:>9.2f} .. {:>9.2f} us: {}'.format(
+                              lower * 1e6 / CPU_CLOCK_HZ, upper * 1e6 / CPU_CLOCK_HZ, n))
+                    bucket += 1
+        slack = axis.motor.deadline_slack
+        if slack.count:
+            print('  {:<12} {:>9} {:>9.2f} {:>9.2f} {:>9.2f}  ({} below {:.2f} us)'.format('slack', slack.count,
+                  slack.min * 1e6 / CPU_CLOCK_HZ, slack.get_mean() * 1e6 / CPU_CLOCK_HZ,
+                  slack.max * 1e6 / CPU_CLOCK_HZ, slack.warning_count,
+                  axis.motor.config.deadline_slack_warning * 1e6 / CPU_CLOCK_HZ))
+        if reset:
+            stats.reset()
+            slack.reset()
+
 data_rate = 10
 plot_rate = 10
 num_samples = 1000
@@ -137,14 +187,48 @@ def print_drv_regs(name, motor):
     print("Control Reg 1: " + str(ctrl_reg_1) + " (" + format(ctrl_reg_1, '#013b') + ")")
     print("Control Reg 2: " + str(ctrl_reg_2) + " (" + format(ctrl_reg_2, '#09b') + ")")
 
+def read_oscilloscope(odrv):
+    """
+    Returns the last capture of the oscilloscope as a list of channels,
+    each a list of values in chronological order. The trigger is at index
+    odrv.oscilloscope.config.pre_trigger.
+    """
+    scope = odrv.oscilloscope
+    n_frames = scope.get_frame_count()
+    n_channels = scope.get_channel_count()
+    # the buffer is a ring of frames, the oldest frame is at get_first_frame()
+    values = scope.buffer.read(0, n_frames * n_channels)
+    first = scope.get_first_frame() * n_channels
+    values = values[first:] + values[:first]
+    return [values[channel::n_channels] for channel in range(n_channels)]
+
+def get_oscilloscope_times(odrv):
+    """
+    Returns the device time [s] of each frame of the last capture, in the
+    order of read_oscilloscope(). ClockSync.to_host() maps them to the host clock.
+    """
+    scope = odrv.oscilloscope
+    trigger_time = scope.trigger_time_us * 1e-6
+    frame_period = scope.frame_period
+    pre_trigger = scope.config.pre_trigger
+    return [trigger_time + (i - pre_trigger) * frame_period for i in range(scope.get_frame_count())]
+
 def show_oscilloscope(odrv):
-    size = 18000
-    values = []
-    for i in range(size):
-        values.append(odrv.get_oscilloscope_val(i))
+    """
+    Plots the last capture of the oscilloscope, one line per channel.
+    The time axis is in control cycles relative to the trigger.
+    """
+    channels = read_oscilloscope(odrv)
+    decimation = odrv.oscilloscope.config.decimation
+    pre_trigger = odrv.oscilloscope.config.pre_trigger
 
     import matplotlib.pyplot as plt
-    plt.plot(values)
+    for num, values in enumerate(channels):
+        t = [(i - pre_trigger) * decimation for i in range(len(values))]
+        plt.plot(t, values, label='channel{}'.format(num))
+    plt.axvline(0, color='gray', linestyle=':')
+    plt.xlabel('control cycles')
+    plt.legend()
     plt.show()
 
 def rate_test(device):